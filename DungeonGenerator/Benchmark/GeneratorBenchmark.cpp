@@ -0,0 +1,622 @@
+/*
+ * Description :
+ *   Headless benchmark for DungeonGenerator.
+ *   Loads area files, sweeps the area size and reports the wall time
+ *   of each Generate() phase over a range of seeds, then the memory and
+ *   scan time of the last floor packed into a PackedTileGrid.
+ *
+ *   With -threads the same seeds are also run through DungeonBatch on one
+ *   thread and on n threads to report throughput and check the floors match.
+ *
+ *   With -stream the area is instead streamed as a ChunkedDungeon of that many
+ *   cells a side while a player walks corner to corner.
+ *
+ *   With -cache every seed is generated twice through a FloorCache in that
+ *   directory, timing the save on a miss and the load on a hit, then one
+ *   FloorFile is timed saving, opening and applying on its own.
+ *
+ *   The last seed is also generated in 1 ms slices with Step() to report
+ *   how long the slices really ran and check the floor matches, and every
+ *   seed again with only the layout to check it matches the full floor.
+ *   That floor is then filled in and rerolled with RerollSpawns().
+ *
+ *   With -budget every seed is generated again within that many milliseconds
+ *   to report how often the budget holds and what the floors gave up for it.
+ *
+ *   -layout picks the LayoutStrategy, grow (default), bsp or graph. The
+ *   batch and stream runs always grow rooms.
+ *
+ *   Usage: GeneratorBenchmark [-data dir] [-seeds n] [-rooms n] [-sizes a,b,c] [-threads n]
+ *                             [-stream cells] [-chunk cells] [-cache dir] [-budget ms]
+ *                             [-layout grow|bsp|graph] [area.xml ...]
+ */
+
+#include "DungeonGenerator.h"
+#include "DungeonArea.h"
+#include "DungeonBatch.h"
+#include "ChunkedDungeon.h"
+#include "FloorCache.h"
+#include "FloorFile.h"
+#include "PackedTileGrid.h"
+#include "DistanceField.h"
+#include "LayoutStrategy.h"
+#include "SpawnManifest.h"
+#include "HashUtil.h"
+#include "Logger.h"
+#include "StringUtil.h"
+#include "Timer.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+//---------------------------------------
+// Swallows generator output so it does not skew timings
+class NullConsole
+	: public Console
+{
+public:
+	void SetDefaultStyle( uint16 style ) {}
+	void SetStyle( uint16 style ) {}
+	void Printf( uint16 style, const char* fmt, va_list vargs ) {}
+	void Printf( const char* fmt, va_list vargs ) {}
+	bool OnInput( int code, int mod ) { return false; }
+	void Clear() {}
+	void OnDraw() const {}
+	void OnUpdate( float dt ) {}
+};
+//---------------------------------------
+// Min/mean/max of one phase over all seeds
+struct PhaseStats
+{
+	PhaseStats()
+		: mMin( 0 ), mMax( 0 ), mSum( 0 ), mCount( 0 )
+	{}
+
+	void Add( double ms )
+	{
+		if ( mCount == 0 || ms < mMin ) mMin = ms;
+		if ( mCount == 0 || ms > mMax ) mMax = ms;
+		mSum += ms;
+		++mCount;
+	}
+
+	double GetMean() const { return mCount ? mSum / mCount : 0; }
+
+	double mMin, mMax, mSum;
+	int mCount;
+};
+//---------------------------------------
+enum
+{
+	PHASE_PLACE_ROOMS,
+	PHASE_GATHER_DOORS,
+	PHASE_PLACE_ENTRANCE,
+	PHASE_CALCULATE_SECTORS,
+	PHASE_PLACE_EXIT,
+	PHASE_GENERATE_SPAWN_DATA,
+	PHASE_TOTAL,
+	PHASE_COUNT
+};
+static const char* PHASE_NAMES[ PHASE_COUNT ] =
+{
+	"PlaceRooms",
+	"GatherDoors",
+	"PlaceEntrance",
+	"CalculateSectors",
+	"PlaceExit",
+	"GenerateSpawnData",
+	"Total",
+};
+//---------------------------------------
+// Hash of everything generation decides about each tile
+// Without spawns only the layout, what a layout only Generate() decides
+static uint64_t GetFloorChecksum( DungeonGenerator& generator, bool withSpawns=true )
+{
+	uint64_t hash = HASH64_INITIAL;
+	auto add = [&hash]( const void* data, size_t size )
+	{
+		hash = GenerateHash64( data, size, hash );
+	};
+
+	for ( int x = 0; x < generator.GetWidth(); ++x )
+	{
+		for ( int y = 0; y < generator.GetHeight(); ++y )
+		{
+			const Tile& tile = generator.GetTileAt( x, y );
+			add( &tile.mType, sizeof( tile.mType ) );
+			add( &tile.z, sizeof( tile.z ) );
+			add( &tile.mSectorId, sizeof( tile.mSectorId ) );
+			add( &tile.mLocked, sizeof( tile.mLocked ) );
+			if ( !withSpawns )
+				continue;
+			if ( tile.mStyle )
+				add( tile.mStyle->mName.data(), tile.mStyle->mName.size() );
+			if ( tile.mObject )
+				add( tile.mObject->mName.data(), tile.mObject->mName.size() );
+			if ( tile.mDoorStyle )
+				add( tile.mDoorStyle->mName.data(), tile.mDoorStyle->mName.size() );
+			add( &tile.mObjectVariant, sizeof( tile.mObjectVariant ) );
+		}
+	}
+	return hash;
+}
+//---------------------------------------
+// Settings and results for one DungeonBatch run
+struct BatchRun
+{
+	BatchRun( int size, int maxRooms )
+		: mSize( size )
+		, mMaxRooms( maxRooms )
+	{}
+
+	int mSize;
+	int mMaxRooms;
+	std::vector< uint64_t > mChecksums;
+};
+//---------------------------------------
+static void SetupBatchGenerator( DungeonGenerator& generator, void* userData )
+{
+	const BatchRun* run = (const BatchRun*) userData;
+	generator.Resize( run->mSize, run->mSize );
+	if ( run->mMaxRooms >= 0 )
+		generator.SetMaxRoomCount( run->mMaxRooms );
+}
+//---------------------------------------
+static void OnBatchFloor( size_t seedIndex, uint64_t seed, DungeonGenerator& generator, void* userData )
+{
+	BatchRun* run = (BatchRun*) userData;
+	run->mChecksums[ seedIndex ] = GetFloorChecksum( generator );
+}
+//---------------------------------------
+// Floors per second generating every seed with threadCount workers
+static double RunBatch( const std::string& filename, const std::vector< uint64_t >& seeds, unsigned threadCount, BatchRun& run )
+{
+	DungeonBatch batch( filename );
+	batch.SetThreadCount( threadCount );
+	batch.SetSetupCallback( &SetupBatchGenerator );
+	run.mChecksums.assign( seeds.size(), 0 );
+
+	Timer timer;
+	if ( !batch.Generate( seeds, &OnBatchFloor, &run ) )
+		return 0;
+	const double ms = timer.GetElapsedMilliseconds();
+	return ms > 0 ? seeds.size() * 1000.0 / ms : 0;
+}
+//---------------------------------------
+// Packs the current floor and compares memory and a full grid scan against the Tile grid
+static void RunPacked( DungeonGenerator& generator )
+{
+	PackedTileGrid packed;
+	Timer timer;
+	const bool packedOk = packed.Pack( generator );
+	const double packMs = timer.Lap();
+
+	// Count walkable tiles per sector, as a minimap or spawn pass would
+	const int tileCount = generator.GetWidth() * generator.GetHeight();
+	std::vector< int > tileCounts( 0x10000 ), packedCounts( 0x10000 );
+	timer.Lap();
+	for ( int x = 0; x < generator.GetWidth(); ++x )
+	{
+		for ( int y = 0; y < generator.GetHeight(); ++y )
+		{
+			const Tile& tile = generator.GetTileAt( x, y );
+			if ( tile.mType > Tile::Tile_NONE && tile.mType < Tile::Tile_WALL )
+				++tileCounts[ tile.mSectorId & 0xFFFF ];
+		}
+	}
+	const double tileScanMs = timer.Lap();
+	const uint8* types = packed.GetTypePlane();
+	const uint16* sectors = packed.GetSectorPlane();
+	for ( int i = 0; i < tileCount; ++i )
+	{
+		if ( types[i] > Tile::Tile_NONE && types[i] < Tile::Tile_WALL )
+			++packedCounts[ sectors[i] ];
+	}
+	const double packedScanMs = timer.Lap();
+
+	DungeonGenerator unpacked;
+	packed.Unpack( unpacked );
+	const bool match = packedOk && tileCounts == packedCounts && GetFloorChecksum( unpacked ) == GetFloorChecksum( generator );
+
+	const double tileKB = tileCount * sizeof( Tile ) / 1024.0;
+	const double packedKB = packed.GetMemoryUsage() / 1024.0;
+	printf( "  packed %.1f KB vs %.1f KB (%.1fx), pack %.3f ms, scan %.3f ms vs %.3f ms, tiles %s\n",
+		packedKB, tileKB, packedKB > 0 ? tileKB / packedKB : 0, packMs, packedScanMs, tileScanMs, match ? "match" : "DIFFER" );
+}
+//---------------------------------------
+// Generates every seed through cache twice, checking the floors match checksums
+static void RunCache( DungeonGenerator& generator, const DungeonArea& area, const std::string& cacheDir, const std::vector< uint64_t >& checksums )
+{
+	FloorCache cache;
+	cache.SetDirectory( cacheDir );
+
+	PhaseStats passes[2];
+	bool match = true;
+	for ( int pass = 0; pass < 2; ++pass )
+	{
+		for ( int seed = 1; seed <= (int) checksums.size(); ++seed )
+		{
+			generator.SetRandomSeed( seed );
+			generator.SetCurrentDepth( 0 );
+
+			Timer timer;
+			cache.Generate( generator, area );
+			passes[ pass ].Add( timer.GetElapsedMilliseconds() );
+			match = match && GetFloorChecksum( generator ) == checksums[ seed - 1 ];
+		}
+	}
+
+	printf( "  cache first pass %.3f ms, second pass %.3f ms, %u hits %u misses, floors %s\n",
+		passes[0].GetMean(), passes[1].GetMean(), cache.GetHitCount(), cache.GetMissCount(), match ? "match" : "DIFFER" );
+
+	// Save the last floor on its own to time each step of a load
+	const std::string filename = cache.GetDirectory() + "benchmark.floor";
+	Timer timer;
+	if ( !FloorFile::Save( filename.c_str(), generator, 0 ) )
+		return;
+	const double saveMs = timer.Lap();
+	FloorFile file;
+	if ( !file.Open( filename.c_str() ) )
+		return;
+	const double openMs = timer.Lap();
+	const bool applied = file.ApplyTo( generator, area );
+	const double applyMs = timer.Lap();
+	printf( "  floor file %.1f KB, save %.3f ms, open %.3f ms, apply %.3f ms, floor %s\n",
+		file.GetHeader().mFileSize / 1024.0, saveMs, openMs, applyMs,
+		applied && GetFloorChecksum( generator ) == checksums.back() ? "match" : "DIFFER" );
+	file.Close();
+	remove( filename.c_str() );
+}
+//---------------------------------------
+// Generates seed again a slice at a time with Step()
+static void RunStep( DungeonGenerator& generator, int seed, uint64_t checksum )
+{
+	const int sliceMicroseconds = 1000;
+	generator.SetRandomSeed( seed );
+	generator.SetCurrentDepth( 0 );
+	generator.BeginGenerate();
+
+	PhaseStats slices;
+	bool done = false;
+	while ( !done )
+	{
+		Timer timer;
+		done = generator.Step( sliceMicroseconds );
+		slices.Add( timer.GetElapsedMilliseconds() );
+	}
+	printf( "  step %d us: %d slices, mean %.3f max %.3f ms, floor %s\n", sliceMicroseconds, (int) slices.mCount,
+		slices.GetMean(), slices.mMax, GetFloorChecksum( generator ) == checksum ? "match" : "DIFFER" );
+}
+//---------------------------------------
+// Generates every seed again within budgetMs
+static void RunBudget( DungeonGenerator& generator, int seedCount, double budgetMs )
+{
+	GenerationBudget budget;
+	budget.mMilliseconds = budgetMs;
+
+	PhaseStats total, rooms, fill;
+	int withinBudget = 0;
+	int stops[ GenerationTimings::Stop_BUDGET + 1 ] = { 0 };
+	for ( int seed = 1; seed <= seedCount; ++seed )
+	{
+		generator.SetRandomSeed( seed );
+		generator.SetCurrentDepth( 0 );
+		generator.Generate( budget );
+
+		const GenerationTimings& t = generator.GetLastTimings();
+		total.Add( t.GetTotal() );
+		rooms.Add( t.mRoomsPlaced );
+		fill.Add( t.mFillRatio );
+		if ( t.mWithinBudget )
+			++withinBudget;
+		++stops[ t.mPlacementStop ];
+	}
+	printf( "  budget %.1f ms: total mean %.3f max %.3f ms, %d/%d within, rooms=%.1f fill=%.3f, %d stopped early\n",
+		budgetMs, total.GetMean(), total.mMax, withinBudget, seedCount, rooms.GetMean(), fill.GetMean(), stops[ GenerationTimings::Stop_BUDGET ] );
+}
+//---------------------------------------
+// Generates every seed again with only the layout and checks it against the full floors
+static void RunLayoutOnly( DungeonGenerator& generator, int seedCount, const std::vector< uint64_t >& layoutChecksums )
+{
+	generator.SetLayoutOnly( true );
+
+	PhaseStats total, connections;
+	int matches = 0;
+	for ( int seed = 1; seed <= seedCount; ++seed )
+	{
+		generator.SetRandomSeed( seed );
+		generator.SetCurrentDepth( 0 );
+		generator.Generate();
+
+		total.Add( generator.GetLastTimings().GetTotal() );
+		if ( GetFloorChecksum( generator, false ) == layoutChecksums[ seed - 1 ] )
+			++matches;
+
+		Timer graphTimer;
+		connections.Add( (double) generator.GetRoomConnections().size() );
+		if ( seed == seedCount )
+			printf( "  room graph %.0f openings, %.3f ms\n", connections.mMax, graphTimer.GetElapsedMilliseconds() );
+	}
+	printf( "  layout only: total mean %.3f max %.3f ms, %d/%d layouts match\n",
+		total.GetMean(), total.mMax, matches, seedCount );
+
+	generator.SetLayoutOnly( false );
+}
+//---------------------------------------
+// Fills in the layout only floor of seed with RerollSpawns(), then rerolls it with another seed
+static void RunRerollSpawns( DungeonGenerator& generator, int seed, uint64_t checksum, uint64_t layoutChecksum, double generateMs )
+{
+	Timer fillTimer;
+	generator.RerollSpawns( seed );
+	const double fillMs = fillTimer.GetElapsedMilliseconds();
+	const bool filled = GetFloorChecksum( generator ) == checksum;
+
+	Timer rerollTimer;
+	generator.RerollSpawns( seed + 1 );
+	const double rerollMs = rerollTimer.GetElapsedMilliseconds();
+	const bool kept = GetFloorChecksum( generator, false ) == layoutChecksum && GetFloorChecksum( generator ) != checksum;
+
+	printf( "  reroll spawns %.3f ms (%.0f%% of Generate), fill %.3f ms, fills layout only floor %s, new seed keeps layout %s\n",
+		rerollMs, generateMs > 0 ? 100 * rerollMs / generateMs : 0, fillMs,
+		filled ? "match" : "DIFFER", kept ? "match" : "DIFFER" );
+}
+//---------------------------------------
+// Generates every seed again checking each Rule through IsValid() instead of the compiled rules
+static void RunUncompiledRules( DungeonGenerator& generator, int seedCount, const std::vector< uint64_t >& checksums, double compiledMs )
+{
+	RuledObject::SetUseCompiledRules( false );
+
+	PhaseStats spawnData;
+	int matches = 0;
+	for ( int seed = 1; seed <= seedCount; ++seed )
+	{
+		generator.SetRandomSeed( seed );
+		generator.SetCurrentDepth( 0 );
+		generator.Generate();
+
+		spawnData.Add( generator.GetLastTimings().mGenerateSpawnData );
+		if ( GetFloorChecksum( generator ) == checksums[ seed - 1 ] )
+			++matches;
+	}
+	printf( "  uncompiled rules: spawn data mean %.3f ms vs %.3f ms compiled, %d/%d floors match\n",
+		spawnData.GetMean(), compiledMs, matches, seedCount );
+
+	RuledObject::SetUseCompiledRules( true );
+}
+//---------------------------------------
+static void RunArea( const std::string& filename, const std::vector< int >& sizes, int seedCount, int maxRooms, unsigned threadCount, const std::string& cacheDir, double budgetMs, LayoutStrategy* layout )
+{
+	for ( auto sizeItr = sizes.begin(); sizeItr != sizes.end(); ++sizeItr )
+	{
+		const int size = *sizeItr;
+
+		// Reload so every size starts from a fresh set of templates
+		DungeonGenerator generator;
+		DungeonArea area;
+		if ( !area.Load( filename.c_str(), generator ) )
+		{
+			fprintf( stderr, "Failed to load '%s'\n", filename.c_str() );
+			return;
+		}
+		generator.Resize( size, size );
+		if ( maxRooms >= 0 )
+			generator.SetMaxRoomCount( maxRooms );
+		generator.SetLayoutStrategy( layout );
+
+		PhaseStats stats[ PHASE_COUNT ];
+		PhaseStats roomsPlaced;
+		PhaseStats roomAttempts;
+		PhaseStats criticalPath;
+		int unsolvable = 0;
+		std::vector< uint64_t > checksums;
+		std::vector< uint64_t > layoutChecksums;
+
+		for ( int seed = 1; seed <= seedCount; ++seed )
+		{
+			generator.SetRandomSeed( seed );
+			generator.SetCurrentDepth( 0 );
+			generator.Generate();
+
+			const GenerationTimings& t = generator.GetLastTimings();
+			stats[ PHASE_PLACE_ROOMS ].Add( t.mPlaceRooms );
+			stats[ PHASE_GATHER_DOORS ].Add( t.mGatherDoors );
+			stats[ PHASE_PLACE_ENTRANCE ].Add( t.mPlaceEntrance );
+			stats[ PHASE_CALCULATE_SECTORS ].Add( t.mCalculateSectors );
+			stats[ PHASE_PLACE_EXIT ].Add( t.mPlaceExit );
+			stats[ PHASE_GENERATE_SPAWN_DATA ].Add( t.mGenerateSpawnData );
+			stats[ PHASE_TOTAL ].Add( t.GetTotal() );
+			roomsPlaced.Add( t.mRoomsPlaced );
+			roomAttempts.Add( t.mRoomAttempts );
+			if ( generator.IsSolvable() )
+				criticalPath.Add( generator.GetCriticalPathLength() );
+			else
+				++unsolvable;
+			checksums.push_back( GetFloorChecksum( generator ) );
+			layoutChecksums.push_back( GetFloorChecksum( generator, false ) );
+		}
+
+		printf( "%s %dx%d seeds=%d rooms=%.1f attempts=%.1f\n", area.mName.c_str(), size, size, seedCount, roomsPlaced.GetMean(), roomAttempts.GetMean() );
+		printf( "  %-20s %12s %12s %12s\n", "phase", "min ms", "mean ms", "max ms" );
+		for ( int i = 0; i < PHASE_COUNT; ++i )
+		{
+			printf( "  %-20s %12.3f %12.3f %12.3f\n", PHASE_NAMES[i], stats[i].mMin, stats[i].GetMean(), stats[i].mMax );
+		}
+		printf( "  critical path %.0f-%.0f doors, mean %.1f, %d unsolvable\n", criticalPath.mMin, criticalPath.mMax, criticalPath.GetMean(), unsolvable );
+
+		RunPacked( generator );
+
+		// Walking distance from the exit of the last floor, what a rule or key placement pays the first time it asks
+		{
+			const glm::vec3 exit = generator.GetExitLocation();
+			std::vector< int > sources( 1, (int) exit.x * size + (int) exit.z );
+			DistanceField field;
+			Timer fieldTimer;
+			field.Build( generator, sources );
+			printf( "  exit distance field %.3f ms, farthest tile %d steps\n", fieldTimer.GetElapsedMilliseconds(), field.GetMaxDistance() );
+		}
+
+		// What the game would be asked to spawn for the last floor
+		{
+			SpawnManifest manifest;
+			Timer manifestTimer;
+			generator.BuildSpawnManifest( manifest );
+			printf( "  spawn manifest %.3f ms: %d keys, %d tiles, %d objects, %d doors\n", manifestTimer.GetElapsedMilliseconds(),
+				(int) manifest.mKeys.size(), (int) manifest.mTiles.size(), (int) manifest.mObjects.size(), (int) manifest.mDoors.size() );
+		}
+
+		// Re-roll every room of the last floor in place
+		if ( generator.GetRoomCount() > 0 )
+		{
+			Timer rerollTimer;
+			for ( int i = 0; i < generator.GetRoomCount(); ++i )
+				generator.RerollRoom( i );
+			printf( "  reroll room mean %.3f ms\n", rerollTimer.GetElapsedMilliseconds() / generator.GetRoomCount() );
+		}
+
+		RunStep( generator, seedCount, checksums.back() );
+		RunLayoutOnly( generator, seedCount, layoutChecksums );
+		RunRerollSpawns( generator, seedCount, checksums.back(), layoutChecksums.back(), stats[ PHASE_TOTAL ].GetMean() );
+		RunUncompiledRules( generator, seedCount, checksums, stats[ PHASE_GENERATE_SPAWN_DATA ].GetMean() );
+
+		if ( !cacheDir.empty() )
+			RunCache( generator, area, cacheDir, checksums );
+
+		if ( threadCount > 0 )
+		{
+			std::vector< uint64_t > seeds;
+			for ( int seed = 1; seed <= seedCount; ++seed )
+				seeds.push_back( seed );
+
+			BatchRun sequential( size, maxRooms );
+			BatchRun parallel( size, maxRooms );
+			const double sequentialRate = RunBatch( filename, seeds, 1, sequential );
+			const double parallelRate = RunBatch( filename, seeds, threadCount, parallel );
+			printf( "  batch 1 thread %.1f floors/s, %u threads %.1f floors/s (%.2fx), floors %s\n",
+				sequentialRate, threadCount, parallelRate, sequentialRate > 0 ? parallelRate / sequentialRate : 0,
+				sequential.mChecksums == parallel.mChecksums ? "match" : "DIFFER" );
+		}
+
+		if ( budgetMs > 0 )
+			RunBudget( generator, seedCount, budgetMs );
+		fflush( stdout );
+	}
+}
+//---------------------------------------
+static void RunStream( const std::string& filename, int worldSize, int chunkSize )
+{
+	const int chunks = ( worldSize + chunkSize - 1 ) / chunkSize;
+	ChunkedDungeon dungeon;
+	if ( !dungeon.Init( filename.c_str(), chunkSize, chunks, chunks, 1, 1 ) )
+	{
+		fprintf( stderr, "Failed to load '%s'\n", filename.c_str() );
+		return;
+	}
+
+	Timer timer;
+	dungeon.Update( 0, 0 );
+	const double initialMs = timer.Lap();
+
+	// Walk corner to corner a fraction of a chunk at a time
+	PhaseStats updates;
+	int chunksGenerated = 0;
+	int maxResident = dungeon.GetResidentChunkCount();
+	const int step = std::max( chunkSize / 8, 1 );
+	for ( int p = step; p < dungeon.GetWorldWidth(); p += step )
+	{
+		chunksGenerated += dungeon.Update( p, p );
+		updates.Add( timer.Lap() );
+		maxResident = std::max( maxResident, dungeon.GetResidentChunkCount() );
+	}
+
+	printf( "%s streamed %dx%d in %dx%d chunks\n", filename.c_str(), dungeon.GetWorldWidth(), dungeon.GetWorldHeight(), chunkSize, chunkSize );
+	printf( "  initial window %.3f ms, update mean %.3f ms max %.3f ms, %d chunks generated, %d of %d chunks resident at most, %.1f KB\n",
+		initialMs, updates.GetMean(), updates.mMax, chunksGenerated, maxResident, dungeon.GetPoolSize(), dungeon.GetMemoryUsage() / 1024.0 );
+	fflush( stdout );
+}
+//---------------------------------------
+int main( int argc, char** argv )
+{
+	std::string dataPath = DungeonArea::DATA_PATH;
+	int seedCount = 20;
+	int maxRooms = -1;	// Use the value in the area file
+	unsigned threadCount = 0;	// 0 -> skip the batch comparison
+	int streamSize = 0;			// 0 -> benchmark whole floors
+	int chunkSize = 100;
+	std::string cacheDir;		// Empty -> skip the cache comparison
+	double budgetMs = 0;		// 0 -> skip the budgeted run
+	BSPLayout bspLayout;
+	GraphLayout graphLayout;
+	LayoutStrategy* layout = 0;	// Grow rooms
+	std::vector< int > sizes;
+	std::vector< std::string > areas;
+
+	for ( int i = 1; i < argc; ++i )
+	{
+		if ( !strcmp( argv[i], "-data" ) && i + 1 < argc )
+			dataPath = std::string( argv[++i] ) + "/";
+		else if ( !strcmp( argv[i], "-seeds" ) && i + 1 < argc )
+			seedCount = atoi( argv[++i] );
+		else if ( !strcmp( argv[i], "-rooms" ) && i + 1 < argc )
+			maxRooms = atoi( argv[++i] );
+		else if ( !strcmp( argv[i], "-threads" ) && i + 1 < argc )
+			threadCount = (unsigned) atoi( argv[++i] );
+		else if ( !strcmp( argv[i], "-stream" ) && i + 1 < argc )
+			streamSize = atoi( argv[++i] );
+		else if ( !strcmp( argv[i], "-chunk" ) && i + 1 < argc )
+			chunkSize = std::max( atoi( argv[++i] ), 1 );
+		else if ( !strcmp( argv[i], "-cache" ) && i + 1 < argc )
+			cacheDir = argv[++i];
+		else if ( !strcmp( argv[i], "-budget" ) && i + 1 < argc )
+			budgetMs = atof( argv[++i] );
+		else if ( !strcmp( argv[i], "-layout" ) && i + 1 < argc )
+		{
+			++i;
+			if ( !strcmp( argv[i], "bsp" ) )
+				layout = &bspLayout;
+			else if ( !strcmp( argv[i], "graph" ) )
+				layout = &graphLayout;
+		}
+		else if ( !strcmp( argv[i], "-sizes" ) && i + 1 < argc )
+		{
+			std::vector< std::string > tokens;
+			StringUtil::Tokenize( argv[++i], tokens, "," );
+			for ( auto itr = tokens.begin(); itr != tokens.end(); ++itr )
+			{
+				int size = 0;
+				StringUtil::StringToType( *itr, &size );
+				sizes.push_back( size );
+			}
+		}
+		else
+			areas.push_back( argv[i] );
+	}
+
+	if ( areas.empty() )
+	{
+		areas.push_back( "TestDungeon.xml" );
+		areas.push_back( "CaveOfTorment.xml" );
+		areas.push_back( "BossLevel1.xml" );
+	}
+	if ( sizes.empty() )
+	{
+		const int defaultSizes[] = { 50, 100, 200, 500, 1000 };
+		sizes.assign( defaultSizes, defaultSizes + sizeof( defaultSizes ) / sizeof( defaultSizes[0] ) );
+	}
+
+	NullConsole console;
+	SetGameConsole( &console );
+
+	for ( auto itr = areas.begin(); itr != areas.end(); ++itr )
+	{
+		if ( streamSize > 0 )
+			RunStream( dataPath + *itr, streamSize, chunkSize );
+		else
+			RunArea( dataPath + *itr, sizes, seedCount, maxRooms, threadCount, cacheDir, budgetMs, layout );
+	}
+
+	SetGameConsole( 0 );
+	return 0;
+}
@@ -0,0 +1,300 @@
+#include "CandidateMasks.h"
+#include "DungeonGenerator.h"
+#include "RuleProgram.h"
+#include "MathUtil.h"
+
+#include <string.h>
+
+namespace
+{
+	//---------------------------------------
+	inline void SetBit( uint64* bits, int i )
+	{
+		bits[ i >> 6 ] |= 1ULL << ( i & 63 );
+	}
+	//---------------------------------------
+	inline void ClearBit( uint64* bits, int i )
+	{
+		bits[ i >> 6 ] &= ~( 1ULL << ( i & 63 ) );
+	}
+	//---------------------------------------
+	inline bool TestBit( const uint64* bits, int i )
+	{
+		return ( bits[ i >> 6 ] >> ( i & 63 ) ) & 1;
+	}
+	//---------------------------------------
+	// mask &= src, or ~src when invert is set
+	// Plain word loops so the compiler can vectorize them
+	void AndBits( uint64* mask, const uint64* src, int words, bool invert )
+	{
+		const uint64 flip = invert ? ~0ULL : 0;
+		for ( int i = 0; i < words; ++i )
+			mask[i] &= src[i] ^ flip;
+	}
+	//---------------------------------------
+	// dest bit i |= src bit i + shift, bits shifted in from outside are clear
+	void ShiftOr( uint64* dest, const uint64* src, int words, int shift )
+	{
+		const int wordShift = ( shift < 0 ? -shift : shift ) >> 6;
+		const int bitShift = ( shift < 0 ? -shift : shift ) & 63;
+		if ( shift >= 0 )
+		{
+			for ( int i = 0; i + wordShift < words; ++i )
+			{
+				uint64 w = src[ i + wordShift ] >> bitShift;
+				if ( bitShift && i + wordShift + 1 < words )
+					w |= src[ i + wordShift + 1 ] << ( 64 - bitShift );
+				dest[i] |= w;
+			}
+		}
+		else
+		{
+			for ( int i = wordShift; i < words; ++i )
+			{
+				uint64 w = src[ i - wordShift ] << bitShift;
+				if ( bitShift && i - wordShift - 1 >= 0 )
+					w |= src[ i - wordShift - 1 ] >> ( 64 - bitShift );
+				dest[i] |= w;
+			}
+		}
+	}
+	//---------------------------------------
+	bool Contains( const int32* values, int count, int32 value )
+	{
+		for ( int i = 0; i < count; ++i )
+		{
+			if ( values[i] == value )
+				return true;
+		}
+		return false;
+	}
+}
+
+//---------------------------------------
+CandidateMasks::CandidateMasks()
+	: mGenerator( 0 )
+	, mRoom( 0 )
+	, mLeft( 0 )
+	, mTop( 0 )
+	, mMargin( 0 )
+	, mWidth( 0 )
+	, mHeight( 0 )
+	, mStride( 0 )
+	, mWords( 0 )
+	, mCount( 0 )
+{}
+//---------------------------------------
+void CandidateMasks::Begin( DungeonGenerator& generator, const Room& room, int margin )
+{
+	mGenerator = &generator;
+	mRoom = &room;
+	mMargin = margin;
+	mWidth = room.GetWidth();
+	mHeight = room.GetHeight();
+	mLeft = room.x - margin;
+	mTop = room.y - margin;
+	mStride = mHeight + 2 * margin;
+	mCount = 0;
+
+	const int columns = mWidth + 2 * margin;
+	const int bits = columns * mStride;
+	mWords = ( bits + 63 ) / 64;
+	mUsages.resize( bits );
+	mRoomCells.assign( mWords, 0 );
+	mInRoom.assign( mWords, 0 );
+	mMatch.resize( mWords );
+	mFound.resize( mWords );
+
+	// Cells outside the room are read through GetTileAt() like the rules do
+	const TileGrid& grid = generator;
+	for ( int cx = 0; cx < columns; ++cx )
+	{
+		for ( int cy = 0; cy < mStride; ++cy )
+		{
+			const int bit = cx * mStride + cy;
+			const Tile& tile = grid.GetTileAt( mLeft + cx, mTop + cy );
+			mUsages[ bit ] = (int8) tile.GetUsageId();
+			if ( cx >= margin && cx < margin + mWidth && cy >= margin && cy < margin + mHeight )
+			{
+				SetBit( &mRoomCells[0], bit );
+				if ( tile.mRoom == &room )
+					SetBit( &mInRoom[0], bit );
+			}
+		}
+	}
+}
+//---------------------------------------
+int CandidateMasks::Add( const RuleProgram& program, const int32* state )
+{
+	if ( (int) mMasks.size() < ( mCount + 1 ) * mWords )
+		mMasks.resize( ( mCount + 1 ) * mWords );
+	uint64* mask = GetMask( mCount );
+	memcpy( mask, &mRoomCells[0], mWords * sizeof( uint64 ) );
+
+	const std::vector< RuleProgram::Instruction >& code = program.GetInstructions();
+	for ( auto itr = code.begin(); itr != code.end(); ++itr )
+	{
+		const RuleProgram::Instruction& inst = *itr;
+		const int32* values = program.GetValues( inst );
+		const bool pass = inst.mPass != 0;
+
+		// Past here Run() may draw random numbers, so the rest has to be run
+		if ( inst.mOp == RuleProgram::Op_RULE || inst.mOp == RuleProgram::Op_RANDOM )
+			break;
+
+		// Objects and styles are placed as the room fills in
+		if ( inst.mMatch == RuleProgram::Match_OBJECT || inst.mMatch == RuleProgram::Match_STYLE )
+			continue;
+
+		switch ( inst.mOp )
+		{
+		case RuleProgram::Op_USAGE:
+			MatchUsages( values, inst.mValueCount, &mMatch[0] );
+			AndBits( mask, &mMatch[0], mWords, !pass );
+			break;
+
+		case RuleProgram::Op_MAX_COUNT:
+			// Counts only go down while a room is filled
+			if ( state[ inst.mState ] <= 0 )
+				memset( mask, 0, mWords * sizeof( uint64 ) );
+			break;
+
+		case RuleProgram::Op_ADJACENT:
+		{
+			// Begin() was given a margin of at least every program's reach
+			assertion( program.GetReach() <= mMargin, "Rule reach %d is over the margin %d\n", program.GetReach(), mMargin );
+			const int16* offsets = program.GetOffsets( inst );
+			MatchUsages( values, inst.mValueCount, &mMatch[0] );
+			memset( &mFound[0], 0, mWords * sizeof( uint64 ) );
+			for ( int i = 0; i < inst.mOffsetCount; ++i )
+				ShiftOr( &mFound[0], &mMatch[0], mWords, offsets[ i * 2 ] * mStride + offsets[ i * 2 + 1 ] );
+			AndBits( mask, &mFound[0], mWords, !pass );
+			break;
+		}
+
+		case RuleProgram::Op_DEPTH:
+		{
+			const int depth = mGenerator->GetCurrentDepth();
+			bool valid = false;
+			for ( int i = 0; i + 1 < inst.mValueCount && !valid; i += 2 )
+				valid = depth >= values[i] && depth <= values[ i + 1 ];
+			if ( !valid )
+				memset( mask, 0, mWords * sizeof( uint64 ) );
+			break;
+		}
+
+		case RuleProgram::Op_DISTANCE_FIELD:
+			ApplyDistanceField( values, inst.mValueCount, inst.mMin, inst.mMax, mask );
+			break;
+
+		case RuleProgram::Op_DISTANCE:
+			ApplyDistance( values, inst.mValueCount, inst.mMin, inst.mMax, mask );
+			break;
+
+		case RuleProgram::Op_ROOM_CONTAINS:
+			ApplyRoomContains( values, inst.mValueCount, pass, mask );
+			break;
+		}
+	}
+	return mCount++;
+}
+//---------------------------------------
+bool CandidateMasks::Test( int id, const Tile& tile ) const
+{
+	const int cx = tile.x - mLeft;
+	const int cy = tile.y - mTop;
+	if ( cx < mMargin || cx >= mMargin + mWidth || cy < mMargin || cy >= mMargin + mHeight )
+		return true;
+	return TestBit( &mMasks[ id * mWords ], cx * mStride + cy );
+}
+//---------------------------------------
+void CandidateMasks::MatchUsages( const int32* values, int count, uint64* out ) const
+{
+	memset( out, 0, mWords * sizeof( uint64 ) );
+	const int bits = (int) mUsages.size();
+	for ( int i = 0; i < bits; ++i )
+	{
+		if ( Contains( values, count, mUsages[i] ) )
+			SetBit( out, i );
+	}
+}
+//---------------------------------------
+void CandidateMasks::ApplyDistance( const int32* values, int count, float min, float max, uint64* mask )
+{
+	// Same as the room scan of Op_DISTANCE, for cells whose tile is in this room
+	std::vector< int >& points = mPoints;
+	points.clear();
+	for ( int cx = mMargin; cx < mMargin + mWidth; ++cx )
+	{
+		for ( int cy = mMargin; cy < mMargin + mHeight; ++cy )
+		{
+			if ( Contains( values, count, mUsages[ cx * mStride + cy ] ) )
+			{
+				points.push_back( cx );
+				points.push_back( cy );
+			}
+		}
+	}
+
+	for ( int cx = mMargin; cx < mMargin + mWidth; ++cx )
+	{
+		for ( int cy = mMargin; cy < mMargin + mHeight; ++cy )
+		{
+			const int bit = cx * mStride + cy;
+			if ( !TestBit( mask, bit ) || !TestBit( &mInRoom[0], bit ) )
+				continue;
+
+			bool ok = mUsages[ bit ] != Tile::Tile_NONE && !points.empty();
+			for ( size_t i = 0; ok && i < points.size(); i += 2 )
+			{
+				const float d = (float) GetManhattanDistance( cx, cy, points[i], points[ i + 1 ] );
+				ok = d >= min && ( max == 0 || d <= max );
+			}
+			if ( !ok )
+				ClearBit( mask, bit );
+		}
+	}
+}
+//---------------------------------------
+void CandidateMasks::ApplyRoomContains( const int32* values, int count, bool pass, uint64* mask ) const
+{
+	bool found = false;
+	for ( int cx = mMargin; cx < mMargin + mWidth && !found; ++cx )
+	{
+		for ( int cy = mMargin; cy < mMargin + mHeight && !found; ++cy )
+			found = Contains( values, count, mUsages[ cx * mStride + cy ] );
+	}
+
+	// Only cells whose tile is in this room scan this room
+	if ( found != pass )
+		AndBits( mask, &mInRoom[0], mWords, true );
+}
+//---------------------------------------
+void CandidateMasks::ApplyDistanceField( const int32* values, int count, float min, float max, uint64* mask ) const
+{
+	for ( int cx = mMargin; cx < mMargin + mWidth; ++cx )
+	{
+		for ( int cy = mMargin; cy < mMargin + mHeight; ++cy )
+		{
+			const int bit = cx * mStride + cy;
+			if ( !TestBit( mask, bit ) )
+				continue;
+
+			bool ok = false;
+			if ( mUsages[ bit ] != Tile::Tile_NONE )
+			{
+				int nearest = -1;
+				for ( int i = 0; i < count; ++i )
+				{
+					const int d = mGenerator->GetDistanceField( (DistanceFieldId) values[i] ).GetNearDistance( mLeft + cx, mTop + cy );
+					if ( d >= 0 && ( nearest < 0 || d < nearest ) )
+						nearest = d;
+				}
+				ok = nearest >= 0 && nearest >= min && ( max == 0 || nearest <= max );
+			}
+			if ( !ok )
+				ClearBit( mask, bit );
+		}
+	}
+}
+//---------------------------------------
@@ -0,0 +1,68 @@
+/*
+ * Description :
+ *   Evaluates RulePrograms over a whole room at once as bitsets, one bit
+ *   per cell of the room grown by a margin on every side, in the grid's
+ *   column major order. Usage tests are masks, adjacency is the usage
+ *   mask shifted by each offset, depth and max count fill or clear the
+ *   whole mask, and the remaining usage rules are worked out per cell.
+ *
+ *   Only the instructions before the first one that draws a random number
+ *   are used, so a clear bit means RuleProgram::Run() would fail at that
+ *   cell without any side effect and can be skipped. A set bit still has
+ *   to be run, rules on objects and styles change as the room fills in.
+ */
+
+#pragma once
+
+#include "Types.h"
+
+#include <vector>
+
+class DungeonGenerator;
+class Room;
+class RuleProgram;
+struct Tile;
+
+class CandidateMasks
+{
+public:
+	CandidateMasks();
+
+	// Lay the masks over room, margin is the farthest a rule looks from a cell
+	// The masks of the last room are dropped
+	void Begin( DungeonGenerator& generator, const Room& room, int margin );
+
+	// Mask of the cells where program could pass, returns its id
+	// state is the first slot of the program's rules, see RuleState
+	int Add( const RuleProgram& program, const int32* state );
+
+	// False if the program of mask id is certain to fail at tile
+	bool Test( int id, const Tile& tile ) const;
+
+	int GetMaskCount() const { return mCount; }
+
+private:
+	uint64* GetMask( int id ) { return &mMasks[ id * mWords ]; }
+	// Bits of every cell whose usage is in values
+	void MatchUsages( const int32* values, int count, uint64* out ) const;
+	// Keep only cells where the room scan of a distance or contains instruction passes
+	void ApplyDistance( const int32* values, int count, float min, float max, uint64* mask );
+	void ApplyRoomContains( const int32* values, int count, bool pass, uint64* mask ) const;
+	void ApplyDistanceField( const int32* values, int count, float min, float max, uint64* mask ) const;
+
+	DungeonGenerator* mGenerator;
+	const Room* mRoom;
+	int mLeft, mTop;		// Grid location of bit 0, the room's corner minus the margin
+	int mMargin;
+	int mWidth, mHeight;	// Of the room
+	int mStride;			// Bits per column, room height plus both margins
+	int mWords;				// Words per mask
+	int mCount;
+	std::vector< int8 > mUsages;		// Usage of every cell
+	std::vector< uint64 > mRoomCells;	// Cells inside the room's bounds
+	std::vector< uint64 > mInRoom;		// Cells whose tile belongs to the room
+	std::vector< uint64 > mMasks;
+	std::vector< uint64 > mMatch;		// Scratch
+	std::vector< uint64 > mFound;
+	std::vector< int > mPoints;
+};
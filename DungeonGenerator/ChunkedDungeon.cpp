@@ -0,0 +1,191 @@
+#include "ChunkedDungeon.h"
+
+#include <stdlib.h>
+#include <algorithm>
+
+//---------------------------------------
+ChunkedDungeon::ChunkedDungeon()
+	: mChunkSize( 0 )
+	, mChunksX( 0 )
+	, mChunksY( 0 )
+	, mWindowRadius( 0 )
+{}
+//---------------------------------------
+ChunkedDungeon::~ChunkedDungeon()
+{
+	Free();
+}
+//---------------------------------------
+bool ChunkedDungeon::Init( const char* areaFilename, int chunkSize, int chunksX, int chunksY, int windowRadius, uint64_t seed )
+{
+	Free();
+
+	mChunkSize = chunkSize;
+	mChunksX = chunksX;
+	mChunksY = chunksY;
+	mWindowRadius = windowRadius;
+	mWorldRNG.SetRandomSeed( seed );
+
+	if ( !mArea.Load( areaFilename, mGenerator ) )
+		return false;
+	mGenerator.Resize( chunkSize, chunkSize );
+	mGenerator.SetDoorLockChance( 0 );
+
+	// Enough chunks to fill the window
+	const int windowSize = 2 * windowRadius + 1;
+	const int poolSize = std::min( windowSize, chunksX ) * std::min( windowSize, chunksY );
+	for ( int i = 0; i < poolSize; ++i )
+	{
+		Chunk* chunk = new Chunk();
+		mPool.push_back( chunk );
+		chunk->mResident = false;
+	}
+	return true;
+}
+//---------------------------------------
+void ChunkedDungeon::Free()
+{
+	for ( auto itr = mPool.begin(); itr != mPool.end(); ++itr )
+		delete *itr;
+	mPool.clear();
+	mArea.Free();
+}
+//---------------------------------------
+int ChunkedDungeon::Update( int worldX, int worldY, int maxNewChunks )
+{
+	if ( mPool.empty() )
+		return 0;
+
+	const int centerX = std::min( std::max( worldX / mChunkSize, 0 ), mChunksX - 1 );
+	const int centerY = std::min( std::max( worldY / mChunkSize, 0 ), mChunksY - 1 );
+
+	// Window is clamped to the world so it always has the same number of chunks
+	const int windowSize = 2 * mWindowRadius + 1;
+	const int minX = std::max( 0, std::min( centerX - mWindowRadius, mChunksX - windowSize ) );
+	const int minY = std::max( 0, std::min( centerY - mWindowRadius, mChunksY - windowSize ) );
+	const int maxX = std::min( minX + windowSize, mChunksX );
+	const int maxY = std::min( minY + windowSize, mChunksY );
+
+	// Free chunks that left the window
+	for ( auto itr = mPool.begin(); itr != mPool.end(); ++itr )
+	{
+		Chunk& chunk = **itr;
+		if ( chunk.mResident && ( chunk.mChunkX < minX || chunk.mChunkX >= maxX || chunk.mChunkY < minY || chunk.mChunkY >= maxY ) )
+			chunk.mResident = false;
+	}
+
+	// Missing chunks, nearest first
+	std::vector< std::pair< int, int > > missing;
+	for ( int cy = minY; cy < maxY; ++cy )
+	{
+		for ( int cx = minX; cx < maxX; ++cx )
+		{
+			if ( !FindChunk( cx, cy ) )
+				missing.push_back( std::make_pair( abs( cx - centerX ) + abs( cy - centerY ), cy * mChunksX + cx ) );
+		}
+	}
+	std::sort( missing.begin(), missing.end() );
+
+	int generated = 0;
+	for ( auto itr = missing.begin(); itr != missing.end(); ++itr )
+	{
+		if ( maxNewChunks > 0 && generated == maxNewChunks )
+			break;
+
+		for ( auto poolItr = mPool.begin(); poolItr != mPool.end(); ++poolItr )
+		{
+			Chunk& chunk = **poolItr;
+			if ( !chunk.mResident )
+			{
+				GenerateChunk( chunk, itr->second % mChunksX, itr->second / mChunksX );
+				++generated;
+				break;
+			}
+		}
+	}
+	return generated;
+}
+//---------------------------------------
+Tile ChunkedDungeon::GetTileAt( int worldX, int worldY ) const
+{
+	if ( worldX < 0 || worldY < 0 || mChunkSize == 0 )
+		return Tile::NULL_TILE;
+
+	const Chunk* chunk = FindChunk( worldX / mChunkSize, worldY / mChunkSize );
+	if ( !chunk )
+		return Tile::NULL_TILE;
+
+	Tile tile = chunk->mTiles.GetTileAt( worldX % mChunkSize, worldY % mChunkSize );
+	tile.SetLocation( worldX, worldY );
+	return tile;
+}
+//---------------------------------------
+const PackedTileGrid* ChunkedDungeon::GetChunk( int chunkX, int chunkY ) const
+{
+	const Chunk* chunk = FindChunk( chunkX, chunkY );
+	return chunk ? &chunk->mTiles : 0;
+}
+//---------------------------------------
+int ChunkedDungeon::GetResidentChunkCount() const
+{
+	int count = 0;
+	for ( auto itr = mPool.begin(); itr != mPool.end(); ++itr )
+	{
+		if ( (*itr)->mResident )
+			++count;
+	}
+	return count;
+}
+//---------------------------------------
+size_t ChunkedDungeon::GetMemoryUsage() const
+{
+	size_t bytes = 0;
+	for ( auto itr = mPool.begin(); itr != mPool.end(); ++itr )
+	{
+		if ( (*itr)->mResident )
+			bytes += (*itr)->mTiles.GetMemoryUsage();
+	}
+	return bytes;
+}
+//---------------------------------------
+ChunkedDungeon::Chunk* ChunkedDungeon::FindChunk( int chunkX, int chunkY ) const
+{
+	for ( auto itr = mPool.begin(); itr != mPool.end(); ++itr )
+	{
+		Chunk* chunk = *itr;
+		if ( chunk->mResident && chunk->mChunkX == chunkX && chunk->mChunkY == chunkY )
+			return chunk;
+	}
+	return 0;
+}
+//---------------------------------------
+void ChunkedDungeon::GenerateChunk( Chunk& chunk, int chunkX, int chunkY )
+{
+	chunk.mChunkX = chunkX;
+	chunk.mChunkY = chunkY;
+	chunk.mResident = true;
+
+	// Open the edges that have a neighbor
+	int edges = 0;
+	if ( chunkY > 0 )
+		edges |= DungeonGenerator::Edge_NORTH;
+	if ( chunkY < mChunksY - 1 )
+		edges |= DungeonGenerator::Edge_SOUTH;
+	if ( chunkX > 0 )
+		edges |= DungeonGenerator::Edge_WEST;
+	if ( chunkX < mChunksX - 1 )
+		edges |= DungeonGenerator::Edge_EAST;
+
+	// Same chunk, same floor no matter the order chunks are visited in
+	RNG chunkRNG = mWorldRNG.Split( (uint64_t) chunkY * mChunksX + chunkX );
+	const uint64_t seedHigh = chunkRNG.Rand();
+	const uint64_t seedLow = chunkRNG.Rand();
+
+	mGenerator.SetEdgeExits( edges );
+	mGenerator.SetRandomSeed( ( seedHigh << 32 ) | seedLow );
+	mGenerator.SetCurrentDepth( 0 );
+	mGenerator.Generate();
+	if ( !chunk.mTiles.Pack( mGenerator ) )
+		WarnFail( "Chunk %d,%d has tiles that do not fit a PackedTileGrid\n", chunkX, chunkY );
+}
+//---------------------------------------
@@ -0,0 +1,74 @@
+/*
+ * Description :
+ *   Streams a very large area as a grid of fixed size chunks.
+ *   Each chunk is its own DungeonGenerator floor, seeded from the world
+ *   seed and the chunk's location, with corridors to the middle of every
+ *   edge shared with another chunk so neighbors join up.
+ *   Only the chunks within a window around the player are kept, packed into
+ *   a fixed pool of PackedTileGrids, so memory does not depend on world size.
+ *   One generator makes every chunk and is reused.
+ *   Leaving and coming back regenerates the same chunk.
+ *
+ *   Doors are never locked since a key could end up in a chunk that is
+ *   no longer resident.
+ */
+ 
+#pragma once
+
+#include "DungeonGenerator.h"
+#include "DungeonArea.h"
+#include "PackedTileGrid.h"
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+class ChunkedDungeon
+{
+public:
+	ChunkedDungeon();
+	~ChunkedDungeon();
+
+	// chunksX * chunksY chunks of chunkSize cells
+	// windowRadius chunks around the player are kept resident
+	bool Init( const char* areaFilename, int chunkSize, int chunksX, int chunksY, int windowRadius, uint64_t seed );
+	// Free all chunks and the area
+	void Free();
+
+	// Generate missing chunks around the world cell and free the ones that left the window
+	// maxNewChunks limits the work done in one call, nearest chunks first, 0 -> no limit
+	// Returns the number of chunks generated
+	int Update( int worldX, int worldY, int maxNewChunks=0 );
+
+	// Tile at the world cell, NULL_TILE if its chunk is not resident
+	Tile GetTileAt( int worldX, int worldY ) const;
+	// Tiles of a chunk, null if it is not resident
+	const PackedTileGrid* GetChunk( int chunkX, int chunkY ) const;
+
+	int GetChunkSize() const { return mChunkSize; }
+	int GetWorldWidth() const { return mChunksX * mChunkSize; }
+	int GetWorldHeight() const { return mChunksY * mChunkSize; }
+	int GetResidentChunkCount() const;
+	int GetPoolSize() const { return (int) mPool.size(); }
+	// Bytes held by the resident chunk grids
+	size_t GetMemoryUsage() const;
+
+private:
+	struct Chunk
+	{
+		PackedTileGrid mTiles;
+		int mChunkX, mChunkY;
+		bool mResident;
+	};
+
+	Chunk* FindChunk( int chunkX, int chunkY ) const;
+	void GenerateChunk( Chunk& chunk, int chunkX, int chunkY );
+
+	DungeonArea mArea;
+	DungeonGenerator mGenerator;
+	std::vector< Chunk* > mPool;
+	int mChunkSize;
+	int mChunksX, mChunksY;
+	int mWindowRadius;
+	RNG mWorldRNG;		// Only used to Split() a stream per chunk
+};
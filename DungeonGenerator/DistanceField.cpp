@@ -0,0 +1,99 @@
+#include "DistanceField.h"
+#include "SectorGraph.h"
+#include "DungeonGenerator.h"
+
+//---------------------------------------
+DistanceField::DistanceField()
+	: mWidth( 0 )
+	, mHeight( 0 )
+	, mBuilt( false )
+{}
+//---------------------------------------
+void DistanceField::Build( const TileGrid& grid, const std::vector< int >& sources )
+{
+	const int w = grid.GetWidth();
+	const int h = grid.GetHeight();
+
+	// Only reset the tiles the last build reached
+	if ( w != mWidth || h != mHeight || mDistances.size() != (size_t) w * h )
+	{
+		mWidth = w;
+		mHeight = h;
+		mDistances.assign( (size_t) w * h, -1 );
+	}
+	else
+	{
+		for ( auto itr = mReached.begin(); itr != mReached.end(); ++itr )
+			mDistances[ *itr ] = -1;
+	}
+	mReached.clear();
+
+	for ( auto itr = sources.begin(); itr != sources.end(); ++itr )
+	{
+		const int i = *itr;
+		if ( i < 0 || i >= w * h || mDistances[i] == 0 )
+			continue;
+		mDistances[i] = 0;
+		mReached.push_back( i );
+	}
+
+	for ( size_t head = 0; head < mReached.size(); ++head )
+	{
+		const int i = mReached[ head ];
+		const int x = i / h;
+		const int y = i % h;
+		const int nx[4] = { x - 1, x + 1, x, x };
+		const int ny[4] = { y, y, y - 1, y + 1 };
+		for ( int n = 0; n < 4; ++n )
+		{
+			if ( nx[n] < 0 || nx[n] >= w || ny[n] < 0 || ny[n] >= h )
+				continue;
+			const int j = nx[n] * h + ny[n];
+			if ( mDistances[j] >= 0 || !SectorGraph::IsWalkable( grid.GetTileAt( nx[n], ny[n] ) ) )
+				continue;
+			mDistances[j] = mDistances[i] + 1;
+			mReached.push_back( j );
+		}
+	}
+
+	mBuilt = true;
+}
+//---------------------------------------
+int DistanceField::GetNearDistance( int x, int y ) const
+{
+	const int d = GetDistance( x, y );
+	if ( d >= 0 || !mBuilt || x < 0 || y < 0 || x >= mWidth || y >= mHeight )
+		return d;
+
+	int nearest = -1;
+	const int nx[4] = { x - 1, x + 1, x, x };
+	const int ny[4] = { y, y, y - 1, y + 1 };
+	for ( int n = 0; n < 4; ++n )
+	{
+		const int nd = GetDistance( nx[n], ny[n] );
+		if ( nd >= 0 && ( nearest < 0 || nd + 1 < nearest ) )
+			nearest = nd + 1;
+	}
+	return nearest;
+}
+//---------------------------------------
+bool DistanceField::GetNextStep( int x, int y, int& nextX, int& nextY ) const
+{
+	const int d = GetDistance( x, y );
+	if ( d <= 0 )
+		return false;
+
+	const int nx[4] = { x - 1, x + 1, x, x };
+	const int ny[4] = { y, y, y - 1, y + 1 };
+	for ( int n = 0; n < 4; ++n )
+	{
+		if ( GetDistance( nx[n], ny[n] ) == d - 1 )
+		{
+			nextX = nx[n];
+			nextY = ny[n];
+			return true;
+		}
+	}
+	return false;
+}
+//---------------------------------------
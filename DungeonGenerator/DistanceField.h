@@ -0,0 +1,49 @@
+/*
+ * Description :
+ *   Walking distance from every tile of a TileGrid to the nearest of a set
+ *   of source tiles. Steps go between walkable tiles, floors and unlocked
+ *   doors, so walls and locked doors are respected. Built with one multi
+ *   source breadth first search, after which each lookup is O(1).
+ */
+
+#pragma once
+
+#include <vector>
+
+class TileGrid;
+
+class DistanceField
+{
+public:
+	DistanceField();
+
+	// Distances from sources, tile indices x * height + y
+	// Sources themselves need not be walkable, i.e. a locked door reaches both of its sides
+	void Build( const TileGrid& grid, const std::vector< int >& sources );
+	// Drop the distances, the memory is kept for the next Build()
+	void Invalidate() { mBuilt = false; }
+	bool IsBuilt() const { return mBuilt; }
+
+	// Steps to the nearest source, -1 if none can be reached or x, y is out of bounds
+	int GetDistance( int x, int y ) const
+	{
+		if ( !mBuilt || x < 0 || y < 0 || x >= mWidth || y >= mHeight )
+			return -1;
+		return mDistances[ x * mHeight + y ];
+	}
+	// Same as GetDistance() but a tile that can not be walked on, i.e. a wall,
+	// is one step further than its nearest walkable neighbor
+	int GetNearDistance( int x, int y ) const;
+	// Farthest reachable tile
+	int GetMaxDistance() const { return mBuilt && !mReached.empty() ? mDistances[ mReached.back() ] : -1; }
+
+	// Neighbor of x, y one step closer to a source, for steering toward it
+	// Returns false if x, y is a source or can not reach one
+	bool GetNextStep( int x, int y, int& nextX, int& nextY ) const;
+
+private:
+	int mWidth, mHeight;
+	bool mBuilt;
+	std::vector< int > mDistances;		// Per tile, -1 if not reached
+	std::vector< int > mReached;		// Tiles with a distance, nearest first
+};
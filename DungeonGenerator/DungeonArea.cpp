@@ -0,0 +1,391 @@
+#include "DungeonArea.h"
+#include "HashUtil.h"
+#include "Logger.h"
+
+#include <stdio.h>
+
+const std::string DungeonArea::DATA_PATH = "../data/";
+
+//---------------------------------------
+DungeonArea::DungeonArea()
+	: mContentHash( 0 )
+	, mEndDepth( 0 )
+	, mAmbientLightIntensity( 1.0f )
+	, mAreaWidth( 0 )
+	, mAreaHeight( 0 )
+	, mMaxRooms( 0 )
+	, mMinRoomWidth( 0 )
+	, mMaxRoomWidth( 0 )
+	, mMinRoomHeight( 0 )
+	, mMaxRoomHeight( 0 )
+	, mVerticalness( 0.5f )
+	, mVerticalBiasUp( 0.5f )
+	, mVerticalBiasDown( 0.5f )
+	, mDoorChance( 0.5f )
+	, mDoorLockChance( 0.5f )
+{}
+//---------------------------------------
+DungeonArea::~DungeonArea()
+{
+	Free();
+}
+//---------------------------------------
+// Hash of the raw bytes of a file, 0 if it can not be read
+static uint64_t HashFile( const char* filename )
+{
+	FILE* file = fopen( filename, "rb" );
+	if ( !file )
+		return 0;
+
+	uint64_t hash = HASH64_INITIAL;
+	char buffer[4096];
+	size_t count;
+	while ( ( count = fread( buffer, 1, sizeof( buffer ), file ) ) > 0 )
+		hash = GenerateHash64( buffer, count, hash );
+	fclose( file );
+	return hash;
+}
+//---------------------------------------
+bool DungeonArea::Load( const char* filename, DungeonGenerator& generator, MeshLoader meshLoader )
+{
+	if ( !Load( filename, meshLoader ) )
+		return false;
+
+	Apply( generator );
+	return true;
+}
+//---------------------------------------
+bool DungeonArea::Load( const char* filename, MeshLoader meshLoader )
+{
+	XmlReader reader( filename );
+	mContentHash = HashFile( filename );
+
+	// <Area>
+	XmlReader::XmlReaderIterator itr = reader.ReadRoot();
+	if ( itr.IsValid() )
+	{
+		const char* areaName = itr.GetAttributeAsCString( "name", "Dungeon" );
+		int areaMaxRooms = itr.GetAttributeAsInt( "maxRooms", 0 );
+		std::vector< int > minRoomSize, maxRoomSize, areaSize;
+		itr.GetAttributeAsCSV( "minRoomSize", minRoomSize );
+		itr.GetAttributeAsCSV( "maxRoomSize", maxRoomSize );
+		itr.GetAttributeAsCSV( "areaSize", areaSize );
+		float verticalness = itr.GetAttributeAsFloat( "verticalness", 0.5f );
+		float verticalBiasUp = itr.GetAttributeAsFloat( "verticalness", 0.5f );
+		float verticalBiasDown = itr.GetAttributeAsFloat( "verticalBiasDown", 0.5f );
+		float doorChance = itr.GetAttributeAsFloat( "doorChance", 0.5f );
+		float doorLockChance = itr.GetAttributeAsFloat( "doorLockChance", 0.5f );
+		std::vector< float > ambientColor;
+		itr.GetAttributeAsCSV( "ambientLightColor", ambientColor, "1,1,1" );
+		float ambientIntensity = itr.GetAttributeAsFloat( "ambientLightIntensity", 1.0f );
+		mEndDepth = itr.GetAttributeAsInt( "endDepth", 0 );
+		mNextArea = itr.GetAttributeAsString( "nextArea", "" );
+
+		if ( mNextArea.empty() )
+			mEndDepth = 0;
+		else
+			mNextArea = DATA_PATH + mNextArea;
+
+		mAreaWidth = areaSize[0];
+		mAreaHeight = areaSize[1];
+		mMaxRooms = areaMaxRooms;
+		mMinRoomWidth = minRoomSize[0];
+		mMaxRoomWidth = maxRoomSize[0];
+		mMinRoomHeight = minRoomSize[1];
+		mMaxRoomHeight = maxRoomSize[1];
+		mVerticalness = verticalness;
+		mVerticalBiasUp = verticalBiasUp;
+		mVerticalBiasDown = verticalBiasDown;
+		mDoorChance = doorChance;
+		mDoorLockChance = doorLockChance;
+
+		mName = areaName;
+		mAmbientLightColor = Color( ambientColor[0], ambientColor[1], ambientColor[2] );
+		mAmbientLightIntensity = ambientIntensity;
+
+		// Free old mappings of styles and object templates
+		Free();
+
+		// <Styles>
+		XmlReader::XmlReaderIterator styleslItr = itr.NextChild( "Styles" );
+		if ( styleslItr.IsValid() )
+		{
+			std::string prefix = DATA_PATH;
+			for ( XmlReader::XmlReaderIterator styleItr = styleslItr.NextChild( "Style" );
+				styleItr.IsValid(); styleItr = styleItr.NextSibling() )
+			{
+				TileStyle* style = new TileStyle;
+				style->mUsageId = TileStyle::GetUsageIdFromString( styleItr.GetAttributeAsString( "usage", "none" ) );
+				style->mMesh = meshLoader ? meshLoader( prefix + styleItr.GetAttributeAsString( "file" ) ) : 0;
+				style->mName = styleItr.GetAttributeAsString( "name" );
+				style->mNameId = SymbolTable::Intern( style->mName );
+				style->mCanBeLocked = styleItr.GetAttributeAsBool( "canBeLocked", true );
+				style->mForceLocked = styleItr.GetAttributeAsBool( "forceLocked", false );
+				style->LoadRulesFromXML( styleItr, mStyleMap );
+				style->LoadEventsFromXML( styleItr );
+				mStyleMap.Add( style->mNameId, style );
+			}
+		}
+
+		// <SpawnList>
+		XmlReader::XmlReaderIterator spawnListsItr = itr.NextChild( "SpawnLists" );
+		if ( spawnListsItr.IsValid() )
+		{
+			for ( XmlReader::XmlReaderIterator spawnListItr = spawnListsItr.NextChild( "SpawnList" );
+				spawnListItr.IsValid(); spawnListItr = spawnListItr.NextSibling() )
+			{
+				std::string listName = spawnListItr.GetAttributeAsString( "name" );
+				SpawnList* spawnList = new SpawnList;
+				std::vector< std::string > list;
+				spawnListItr.GetAttributeAsCSV( "list", list );
+				SymbolTable::Intern( list, spawnList->mList );
+				mSpawnListMap.Add( listName, spawnList );
+
+				// Copy from another list
+				std::vector< std::string > listToExtendFrom;
+				spawnListItr.GetAttributeAsCSV( "extendsLists", listToExtendFrom );
+				for ( auto listItr = listToExtendFrom.begin(); listItr != listToExtendFrom.end(); ++listItr )
+				{
+					SpawnList* list = mSpawnListMap.Find( *listItr );
+					if ( list )
+					{
+						spawnList->mList.insert( spawnList->mList.end(), list->mList.begin(), list->mList.end() );
+					}
+					else
+					{
+						WarnFail( "Could not find SpawnList of name '%s'. Did you define it after this SpawnList?\n", listItr->c_str() );
+					}
+				}
+			}
+		}
+
+		// <Objects>
+		XmlReader::XmlReaderIterator objectslItr = itr.NextChild( "Objects" );
+		if ( objectslItr.IsValid() )
+		{
+			std::string prefix = DATA_PATH;
+			for ( XmlReader::XmlReaderIterator objectItr = objectslItr.NextChild( "Object" );
+				objectItr.IsValid(); objectItr = objectItr.NextSibling() )
+			{
+				std::string name = objectItr.GetAttributeAsString( "name" );
+				int usage = TileObject::GetUsageIdFromString( objectItr.GetAttributeAsString( "usage", "none" ) );
+				TileObject* object = 0;
+
+				// Object specific properties
+				if ( usage == TileObject::Usage_STATIC )
+				{
+					object = new TileObject();
+					object->mMesh = meshLoader ? meshLoader( prefix + objectItr.GetAttributeAsString( "file" ) ) : 0;
+				}
+				else if ( usage == TileObject::Usage_PICKUP )
+				{
+					object = new TileObject_Pickup();
+					object->mUsageId = usage;
+					//object->mMesh = Mesh::CreateMesh( prefix + objectItr.GetAttributeAsString( "file" ) );
+
+					TileObject_Pickup* pickupObject = (TileObject_Pickup*) object;
+					pickupObject->mPickupName = SymbolTable::Intern( objectItr.GetAttributeAsString( "pickupName" ) );
+				}
+				else if ( usage == TileObject::Usage_LIGHT )
+				{
+					object = new TileObject_Light();
+					TileObject_Light* lightObject = (TileObject_Light*) object;
+
+					std::vector< float > color;
+					objectItr.GetAttributeAsCSV( "lightColor", color, "1,1,1" );
+					if ( color.size() == 3 )
+						lightObject->mLightColor = Color( color[0], color[1], color[2] );
+					else
+						DebugPrintf( "TileObject: invalid color - must be 'r,g,b'\n" );
+					lightObject->mIntensity = objectItr.GetAttributeAsFloat( "lightIntensity", 0.5f );
+					lightObject->mRadius = objectItr.GetAttributeAsFloat( "lightRadius", 1.0f );
+					lightObject->mFalloff = objectItr.GetAttributeAsFloat( "lightFalloff", 0.5f );
+				}
+				else if ( usage == TileObject::Usage_ENEMY )
+				{
+					object = new TileObject_Enemy();
+					TileObject_Enemy* enemyObject = (TileObject_Enemy*) object;
+					enemyObject->mEnemyClass = SymbolTable::Intern( objectItr.GetAttributeAsString( "enemyType" ) );
+				}
+				else if ( usage == TileObject::Usage_SPAWNER )
+				{
+					object = new TileObject_Spawner();
+					TileObject_Spawner* spawner = (TileObject_Spawner*) object;
+					std::string listName = objectItr.GetAttributeAsString( "spawnList" );
+					spawner->mList = mSpawnListMap.Find( listName );
+					if ( !spawner->mList )
+					{
+						WarnFail( "Cannot find SpawnList '%s'\n", listName.c_str() );
+					}
+				}
+				else
+				{
+					WarnFail( "<Object name='%s'>: Unknown usage '%s'\n", name.c_str(), objectItr.GetAttributeAsString( "usage", "none" ).c_str() );
+					continue;
+				}
+
+				// General properties
+				object->mName = name;
+				object->mNameId = SymbolTable::Intern( name );
+				object->mUsageId = usage;
+				object->mAttachment = mObjectMap.Find( objectItr.GetAttributeAsString( "attachment", "" ) );
+				// Only the object on a tile picks what it spawns
+				if ( object->mAttachment && object->mAttachment->mUsageId == TileObject::Usage_SPAWNER )
+					WarnFail( "<Object name='%s'>: Spawner '%s' is an attachment and will spawn nothing\n", name.c_str(), object->mAttachment->mName.c_str() );
+				object->LoadRulesFromXML( objectItr, mObjectMap );
+				object->LoadEventsFromXML( objectItr );
+				std::vector< float > v;
+				objectItr.GetAttributeAsCSV( "localSpawnOffset", v, "0,0,0" );
+				if ( v.size() == 3 )
+					object->mLocalSpawnOffset = glm::vec3( v[0], v[1], v[2] );
+				else
+					DebugPrintf( "TileObject: invalid local spawn offset - must be 'x,y,z'\n" );
+				mObjectMap.Add( object->mNameId, object );
+			}
+		}
+
+
+		// <Rooms>
+		SymbolMap< RoomTemplate > roomMap;
+		XmlReader::XmlReaderIterator roomTmplItr = itr.NextChild( "Rooms" );
+		if ( roomTmplItr.IsValid() )
+		{
+			for ( XmlReader::XmlReaderIterator roomItr = roomTmplItr.NextChild( "Room" );
+				roomItr.IsValid(); roomItr = roomItr.NextSibling() )
+			{
+				mRoomTemplates.push_back( new RoomTemplate() );
+				RoomTemplate& roomTmpl = *mRoomTemplates.back();
+				const char* name = roomItr.GetAttributeAsCString( "name", 0 );
+				// Rooms are only mapped if they are named
+				if ( name )
+				{
+					roomMap.Add( name, &roomTmpl );
+				}
+				// Load rules
+				roomTmpl.LoadRulesFromXML( roomItr, roomMap );
+				// Copy base rooms
+				std::vector< std::string > roomsToCopyFrom;
+				roomItr.GetAttributeAsCSV( "extendsRooms", roomsToCopyFrom );
+				for ( auto roomCopyItr = roomsToCopyFrom.begin(); roomCopyItr != roomsToCopyFrom.end(); ++roomCopyItr )
+				{
+					RoomTemplate* roomToCopy = roomMap.Find( *roomCopyItr );
+					if ( roomToCopy )
+					{
+						roomTmpl.CopyDataFrom( roomToCopy );
+					}
+					else
+					{
+						WarnFail( "Could not find room of name '%s'. Did you define it after this room?\n", roomCopyItr->c_str() );
+					}
+				}
+
+				if ( roomItr.HasAttribute( "minRoomSize" ) )
+				{
+					std::vector< int > minRoomSize;
+					roomItr.GetAttributeAsCSV( "minRoomSize", minRoomSize );
+					roomTmpl.SetMinSize( minRoomSize[0], minRoomSize[1] );
+				}
+				if ( roomItr.HasAttribute( "maxRoomSize" ) )
+				{
+					std::vector< int > maxRoomSize;
+					roomItr.GetAttributeAsCSV( "maxRoomSize", maxRoomSize );
+					roomTmpl.SetMaxSize( maxRoomSize[0], maxRoomSize[1] );
+				}
+
+				SymbolMap< Useable > usableMap;
+				SymbolMap< Useable > usableStyleMap;
+				for ( XmlReader::XmlReaderIterator roomJtr = roomItr.NextChild();
+					roomJtr.IsValid(); roomJtr = roomJtr.NextSibling() )
+				{
+					if ( roomJtr.ElementNameEquals( "UseStyle" ) )
+					{
+						std::string styleName = roomJtr.GetAttributeAsString( "uses" );
+						Useable* useStyle = new Useable;
+						mUseableObjects.push_back( useStyle );
+						useStyle->mObject = mStyleMap.Find( styleName );
+						useStyle->LoadRulesFromXML( roomJtr, usableStyleMap );
+						
+						roomTmpl.AddStyle( useStyle );
+
+						const char* name = roomJtr.GetAttributeAsCString( "name", 0 );
+						// Useables are only mapped if they are named
+						if ( name )
+						{
+							usableStyleMap.Add( name, useStyle );
+						}	
+					}
+					else if ( roomJtr.ElementNameEquals( "UsesObject" ) )
+					{
+						std::string objectName = roomJtr.GetAttributeAsString( "uses" );
+						TileObject* object = mObjectMap.Find( objectName );
+						if ( !object )
+						{
+							WarnFail( "<Room name='%s'> <UsesObject uses='%s'>: No object named '%s'\n", name, objectName.c_str(), objectName.c_str() );
+							continue;
+						}
+						Useable* useObject = new Useable;
+						mUseableObjects.push_back( useObject );
+						useObject->mObject = object;
+						useObject->LoadRulesFromXML( roomJtr, usableMap );
+						roomTmpl.AddObject( useObject );
+
+						const char* name = roomJtr.GetAttributeAsCString( "name", 0 );
+						// Useables are only mapped if they are named
+						if ( name )
+						{
+							usableMap.Add( name, useObject );
+						}
+					}
+				}
+			}
+		}
+	}
+	else
+	{
+		WarnFail( "Failed to open '%s'\n", filename );
+		return false;
+	}
+
+	CompileRules();
+	return true;
+}
+//---------------------------------------
+void DungeonArea::Apply( DungeonGenerator& generator ) const
+{
+	generator.Init( mAreaWidth, mAreaHeight, mMaxRooms, mMinRoomWidth, mMaxRoomWidth, mMinRoomHeight, mMaxRoomHeight );
+	generator.SetVerticalness( mVerticalness );
+	generator.SetVerticalBias( mVerticalBiasUp, mVerticalBiasDown );
+	generator.SetDoorChance( mDoorChance );
+	generator.SetDoorLockChance( mDoorLockChance );
+	generator.SetName( mName.c_str() );
+	generator.SetRoomTemplates( mRoomTemplates, mRuleState );
+}
+//---------------------------------------
+void DungeonArea::CompileRules()
+{
+	// Every slot is given out again, objects must not keep the old ones
+	for ( auto itr = mRoomTemplates.begin(); itr != mRoomTemplates.end(); ++itr )
+		(*itr)->ReleaseAllState();
+	mRuleState.Clear();
+	for ( auto itr = mRoomTemplates.begin(); itr != mRoomTemplates.end(); ++itr )
+		(*itr)->CompileAllRules( mRuleState );
+}
+//---------------------------------------
+void DungeonArea::Free()
+{
+	mStyleMap.DeleteAll();
+	mObjectMap.DeleteAll();
+	mSpawnListMap.DeleteAll();
+
+	for ( auto itr = mRoomTemplates.begin(); itr != mRoomTemplates.end(); ++itr )
+		delete *itr;
+	mRoomTemplates.clear();
+	mRuleState.Clear();
+	
+	for ( auto i = mUseableObjects.begin(); i != mUseableObjects.end(); ++i )
+	{
+		delete *i;
+	}
+	mUseableObjects.clear();
+}
+//---------------------------------------
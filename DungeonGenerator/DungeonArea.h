@@ -0,0 +1,73 @@
+/*
+ * Description :
+ *   Loads an <Area> xml file and sets up DungeonGenerators to use it.
+ *   Owns the room templates and the styles, objects and spawn lists
+ *   they reference. Generators only read them so one loaded area can
+ *   be applied to any number of generators, see DungeonBatch.
+ */
+ 
+#pragma once
+
+#include "DungeonGenerator.h"
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+class DungeonArea
+{
+public:
+	// Used to create meshes for styles and objects
+	// Pass null to load without meshes, i.e. when generating headless
+	typedef Mesh* (*MeshLoader)( const std::string& filename );
+
+	// Directory area files and the assets they reference are relative to
+	static const std::string DATA_PATH;
+
+	DungeonArea();
+	~DungeonArea();
+
+	// Load an area and setup generator to use it
+	// Any previously loaded area is freed
+	bool Load( const char* filename, DungeonGenerator& generator, MeshLoader meshLoader=0 );
+	// Load an area without setting up a generator, use Apply() for that
+	// Any previously loaded area is freed, generators using it must be given a new one first
+	bool Load( const char* filename, MeshLoader meshLoader=0 );
+
+	// Setup generator to use this area, i.e. size, chances and room templates
+	// Only reads the area, safe to call for several generators at once
+	void Apply( DungeonGenerator& generator ) const;
+
+	// Free all room templates, styles, objects and spawn lists
+	void Free();
+
+	std::string mName;
+	uint64_t mContentHash;			// Hash of the area file, identifies the area in FloorCache
+	int mEndDepth;					// Depth after which mNextArea is loaded, 0 -> never
+	std::string mNextArea;
+	Color mAmbientLightColor;
+	float mAmbientLightIntensity;
+
+	SymbolMap< TileStyle > mStyleMap;
+	SymbolMap< TileObject > mObjectMap;
+	SymbolMap< SpawnList > mSpawnListMap;
+	std::vector< Useable* > mUseableObjects;
+	std::vector< RoomTemplate* > mRoomTemplates;
+
+private:
+	// Compile every room template's rules, see RuleProgram, and give them their slots in mRuleState
+	// Done once the area is loaded so generation never compiles
+	void CompileRules();
+
+	// Generator settings, see Apply()
+	int mAreaWidth, mAreaHeight;
+	int mMaxRooms;
+	int mMinRoomWidth, mMaxRoomWidth;
+	int mMinRoomHeight, mMaxRoomHeight;
+	float mVerticalness;
+	float mVerticalBiasUp, mVerticalBiasDown;
+	float mDoorChance;
+	float mDoorLockChance;
+
+	RuleState mRuleState;			// Layout and starting values of the rules' slots, copied by every generator
+};
@@ -0,0 +1,94 @@
+#include "DungeonBatch.h"
+#include "DungeonArea.h"
+
+#include <atomic>
+#include <thread>
+
+//---------------------------------------
+// State shared by the workers of one Generate() call
+struct DungeonBatch::Job
+{
+	const DungeonArea* mArea;
+	const std::vector< uint64_t >* mSeeds;
+	FloorCallback mOnFloor;
+	void* mUserData;
+	std::atomic< size_t > mNextSeed;
+};
+//---------------------------------------
+DungeonBatch::DungeonBatch( const std::string& areaFilename )
+	: mAreaFilename( areaFilename )
+	, mThreadCount( 0 )
+	, mDepth( 0 )
+	, mSetup( 0 )
+{}
+//---------------------------------------
+unsigned DungeonBatch::GetThreadCount() const
+{
+	if ( mThreadCount > 0 )
+		return mThreadCount;
+
+	// May be 0 if it can not be detected
+	const unsigned hardwareThreads = std::thread::hardware_concurrency();
+	return hardwareThreads > 0 ? hardwareThreads : 1;
+}
+//---------------------------------------
+bool DungeonBatch::Generate( const std::vector< uint64_t >& seeds, FloorCallback onFloor, void* userData )
+{
+	// Parsed once, workers only read it
+	DungeonArea area;
+	if ( !area.Load( mAreaFilename.c_str() ) )
+		return false;
+
+	Job job;
+	job.mArea = &area;
+	job.mSeeds = &seeds;
+	job.mOnFloor = onFloor;
+	job.mUserData = userData;
+	job.mNextSeed = 0;
+
+	// No point having more workers than seeds
+	unsigned threadCount = GetThreadCount();
+	if ( threadCount > seeds.size() )
+		threadCount = (unsigned) seeds.size();
+
+	// The calling thread does the work when there is only one worker
+	if ( threadCount <= 1 )
+	{
+		RunWorker( this, &job );
+		return true;
+	}
+
+	std::vector< std::thread > workers;
+	workers.reserve( threadCount );
+	for ( unsigned i = 0; i < threadCount; ++i )
+		workers.push_back( std::thread( &DungeonBatch::RunWorker, this, &job ) );
+	for ( auto itr = workers.begin(); itr != workers.end(); ++itr )
+		itr->join();
+
+	return true;
+}
+//---------------------------------------
+void DungeonBatch::RunWorker( DungeonBatch* batch, Job* job )
+{
+	DungeonGenerator generator;
+	job->mArea->Apply( generator );
+
+	if ( batch->mSetup )
+		batch->mSetup( generator, job->mUserData );
+
+	const std::vector< uint64_t >& seeds = *job->mSeeds;
+	for ( ;; )
+	{
+		const size_t index = job->mNextSeed++;
+		if ( index >= seeds.size() )
+			break;
+
+		generator.SetRandomSeed( seeds[ index ] );
+		generator.SetCurrentDepth( batch->mDepth );
+		generator.Generate();
+
+		if ( job->mOnFloor )
+			job->mOnFloor( index, seeds[ index ], generator, job->mUserData );
+	}
+}
+//---------------------------------------
@@ -0,0 +1,54 @@
+/*
+ * Description :
+ *   Generates many floors of one area on a pool of worker threads.
+ *   The area is loaded once per Generate() call and shared by the
+ *   workers, each applies it to its own DungeonGenerator and then takes
+ *   seeds off a shared list until it is empty.
+ *   A floor only depends on its seed and depth so the result for a seed
+ *   is the same no matter which worker or how many workers made it.
+ *
+ *   Areas are loaded without meshes, the batch is for headless use only.
+ */
+ 
+#pragma once
+
+#include "DungeonGenerator.h"
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+class DungeonBatch
+{
+public:
+	// Called on the worker thread after the area has been applied to its generator
+	// Use it to override area settings, i.e. size or max room count
+	typedef void (*SetupCallback)( DungeonGenerator& generator, void* userData );
+	// Called on the worker thread after each floor is generated
+	// seedIndex is the index of seed in the list passed to Generate()
+	// The generator is reused for the next seed once this returns
+	typedef void (*FloorCallback)( size_t seedIndex, uint64_t seed, DungeonGenerator& generator, void* userData );
+
+	DungeonBatch( const std::string& areaFilename );
+
+	// Number of worker threads, 0 -> one per hardware thread
+	void SetThreadCount( unsigned count ) { mThreadCount = count; }
+	unsigned GetThreadCount() const;
+	// Depth floors are generated from, see DungeonGenerator::SetCurrentDepth()
+	void SetDepth( int depth ) { mDepth = depth; }
+	void SetSetupCallback( SetupCallback setup ) { mSetup = setup; }
+
+	// Generate a floor for every seed and pass it to onFloor
+	// Callbacks are made from several threads at once
+	// Returns false if the area could not be loaded
+	bool Generate( const std::vector< uint64_t >& seeds, FloorCallback onFloor, void* userData=0 );
+
+private:
+	struct Job;
+	static void RunWorker( DungeonBatch* batch, Job* job );
+
+	std::string mAreaFilename;
+	unsigned mThreadCount;
+	int mDepth;
+	SetupCallback mSetup;
+};
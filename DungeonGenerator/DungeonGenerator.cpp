@@ -1,18 +1,15 @@
 #include "DungeonGenerator.h"
-#include "Util.h"
-#include "Texture.h"
-#include "Window.h"
-#include "Mesh.h"
+#include "LayoutStrategy.h"
+#include "SpawnManifest.h"
+#include "MathUtil.h"
+#include "WeightedRandom.h"
 #include "StringUtil.h"
-#include "Game.h"
-#include "Door.h"
-#include "Key.h"
-#include "MapTile.h"
-#include "MapObject.h"
+#include "EventListener.h"
 #include "Logger.h"
-#include "Enemy.h"
+#include "Timer.h"
 
-#include <stack>
+#include <algorithm>
+#include <string.h>
 
 
 Tile Tile::NULL_TILE;
@@ -119,12 +116,18 @@ Rule_Random::Rule_Random( const XmlReader::XmlReaderIterator& xmlItr )
 	mPercentToBeTrue = xmlItr.GetAttributeAsInt( "percentToBeTrue" ) / 100.0f;
 }
 //---------------------------------------
-bool Rule_Random::IsValid( Tile* tile )
+bool Rule_Random::IsValid( Tile* /*tile*/, DungeonGenerator& generator, const int32* /*state*/ ) const
 {
-	const float r = RNG::RandomUnit();
+	const float r = generator.GetRuleRNG().RandomUnit();
 	return mPercentToBeTrue > 0 && r <= mPercentToBeTrue ? true : false;
 }
 //---------------------------------------
+void Rule_Random::Compile( RuleProgram& program ) const
+{
+	program.Emit( RuleProgram::Op_RANDOM, this );
+	program.SetRange( mPercentToBeTrue, 0 );
+}
+//---------------------------------------
 // Rule_UsageRule
 Rule_UsageRule::Rule_UsageRule( const XmlReader::XmlReaderIterator& xmlItr )
 {
@@ -139,13 +142,17 @@ Rule_UsageRule::Rule_UsageRule( const XmlReader::XmlReaderIterator& xmlItr )
 // Rule_ObjectRule
 Rule_ObjectRule::Rule_ObjectRule( const XmlReader::XmlReaderIterator& xmlItr )
 {
-	xmlItr.GetAttributeAsCSV( "objectNames", mObjectNames );
+	std::vector< std::string > names;
+	xmlItr.GetAttributeAsCSV( "objectNames", names );
+	SymbolTable::Intern( names, mObjectNames );
 }
 //---------------------------------------
 // Rule_StyleRule
 Rule_StyleRule::Rule_StyleRule( const XmlReader::XmlReaderIterator& xmlItr )
 {
-	xmlItr.GetAttributeAsCSV( "styleNames", mStyleNames );
+	std::vector< std::string > names;
+	xmlItr.GetAttributeAsCSV( "styleNames", names );
+	SymbolTable::Intern( names, mStyleNames );
 }
 //---------------------------------------
 // Rule_SpawnOn
@@ -158,7 +165,7 @@ Rule_CanSpawnOn::Rule_CanSpawnOn( const XmlReader::XmlReaderIterator& xmlItr )
 	: Rule_SpawnOn( xmlItr )
 {}
 //---------------------------------------
-bool Rule_CanSpawnOn::IsValid( Tile* tile )
+bool Rule_CanSpawnOn::IsValid( Tile* tile, DungeonGenerator& /*generator*/, const int32* /*state*/ ) const
 {
 	for ( auto itr = mUsages.begin(); itr != mUsages.end(); ++itr )
 	{
@@ -168,12 +175,18 @@ bool Rule_CanSpawnOn::IsValid( Tile* tile )
 	return false;
 }
 //---------------------------------------
+void Rule_CanSpawnOn::Compile( RuleProgram& program ) const
+{
+	program.Emit( RuleProgram::Op_USAGE, this, RuleProgram::Match_USAGE, true );
+	program.AddValues( mUsages );
+}
+//---------------------------------------
 // Rule_CanNotSpawnOn
 Rule_CanNotSpawnOn::Rule_CanNotSpawnOn( const XmlReader::XmlReaderIterator& xmlItr )
 	: Rule_SpawnOn( xmlItr )
 {}
 //---------------------------------------
-bool Rule_CanNotSpawnOn::IsValid( Tile* tile )
+bool Rule_CanNotSpawnOn::IsValid( Tile* tile, DungeonGenerator& /*generator*/, const int32* /*state*/ ) const
 {
 	for ( auto itr = mUsages.begin(); itr != mUsages.end(); ++itr )
 	{
@@ -183,21 +196,21 @@ bool Rule_CanNotSpawnOn::IsValid( Tile* tile )
 	return true;
 }
 //---------------------------------------
-// Rule_MaxCount
-Rule_MaxCount::Rule_MaxCount( const XmlReader::XmlReaderIterator& xmlItr )
+void Rule_CanNotSpawnOn::Compile( RuleProgram& program ) const
 {
-	mMaxCount = xmlItr.GetAttributeAsInt( "count" );
-	mCurrentCount = mMaxCount;
+	program.Emit( RuleProgram::Op_USAGE, this, RuleProgram::Match_USAGE, false );
+	program.AddValues( mUsages );
 }
 //---------------------------------------
-bool Rule_MaxCount::IsValid( Tile* tile )
+// Rule_MaxCount
+Rule_MaxCount::Rule_MaxCount( const XmlReader::XmlReaderIterator& xmlItr )
 {
-	return mCurrentCount > 0;
+	mMaxCount = xmlItr.GetAttributeAsInt( "count" );
 }
 //---------------------------------------
-void Rule_MaxCount::Reset()
+bool Rule_MaxCount::IsValid( Tile* /*tile*/, DungeonGenerator& /*generator*/, const int32* state ) const
 {
-	mCurrentCount = mMaxCount;
+	return state[0] > 0;
 }
 //---------------------------------------
 // Rule_AdjacentTo
@@ -230,32 +243,50 @@ Rule_AdjacentTo::Rule_AdjacentTo( const XmlReader::XmlReaderIterator& xmlItr )
 	}
 }
 //---------------------------------------
-void Rule_AdjacentTo::GetTilesToCheck( Tile* tile, std::vector< Tile* >& tilesToCheck )
+void Rule_AdjacentTo::GetTilesToCheck( Tile* tile, TileGrid& grid, std::vector< Tile* >& tilesToCheck ) const
 {
 	if ( mDirectionsToCheck[ AD_N ] )
 		for ( int i = 1; i <= mMargin; ++i )
-			tilesToCheck.push_back( &mGrid->GetTileAt( tile->x, tile->y - i ) );
+			tilesToCheck.push_back( &grid.GetTileAt( tile->x, tile->y - i ) );
 	if ( mDirectionsToCheck[ AD_S ] )
 		for ( int i = 1; i <= mMargin; ++i )
-			tilesToCheck.push_back( &mGrid->GetTileAt( tile->x, tile->y + i ) );
+			tilesToCheck.push_back( &grid.GetTileAt( tile->x, tile->y + i ) );
 	if ( mDirectionsToCheck[ AD_E ] )
 		for ( int i = 1; i <= mMargin; ++i )
-			tilesToCheck.push_back( &mGrid->GetTileAt( tile->x - i, tile->y ) );
+			tilesToCheck.push_back( &grid.GetTileAt( tile->x - i, tile->y ) );
 	if ( mDirectionsToCheck[ AD_W ] )
 		for ( int i = 1; i <= mMargin; ++i )
-			tilesToCheck.push_back( &mGrid->GetTileAt( tile->x + i, tile->y ) );
+			tilesToCheck.push_back( &grid.GetTileAt( tile->x + i, tile->y ) );
 	if ( mDirectionsToCheck[ AD_NE ] )
 		for ( int i = 1; i <= mMargin; ++i )
-			tilesToCheck.push_back( &mGrid->GetTileAt( tile->x - i, tile->y - i ) );
+			tilesToCheck.push_back( &grid.GetTileAt( tile->x - i, tile->y - i ) );
 	if ( mDirectionsToCheck[ AD_NW ] )
 		for ( int i = 1; i <= mMargin; ++i )
-			tilesToCheck.push_back( &mGrid->GetTileAt( tile->x + i, tile->y - i ) );
+			tilesToCheck.push_back( &grid.GetTileAt( tile->x + i, tile->y - i ) );
 	if ( mDirectionsToCheck[ AD_SE ] )
 		for ( int i = 1; i <= mMargin; ++i )
-			tilesToCheck.push_back( &mGrid->GetTileAt( tile->x - i, tile->y + i ) );
+			tilesToCheck.push_back( &grid.GetTileAt( tile->x - i, tile->y + i ) );
 	if ( mDirectionsToCheck[ AD_SW ] )
 		for ( int i = 1; i <= mMargin; ++i )
-			tilesToCheck.push_back( &mGrid->GetTileAt( tile->x + i, tile->y + i ) );
+			tilesToCheck.push_back( &grid.GetTileAt( tile->x + i, tile->y + i ) );
+}
+//---------------------------------------
+void Rule_AdjacentTo::CompileAdjacent( RuleProgram& program, int match ) const
+{
+	// Same directions and order as GetTilesToCheck()
+	static const int offsets[ AD_COUNT ][2] =
+	{
+		{ 0, -1 }, { 0, 1 }, { -1, 0 }, { 1, 0 },
+		{ -1, -1 }, { 1, -1 }, { -1, 1 }, { 1, 1 },
+	};
+
+	program.Emit( RuleProgram::Op_ADJACENT, this, match, mPassValue );
+	for ( int d = 0; d < AD_COUNT; ++d )
+	{
+		if ( mDirectionsToCheck[d] )
+			for ( int i = 1; i <= mMargin; ++i )
+				program.AddOffset( offsets[d][0] * i, offsets[d][1] * i );
+	}
 }
 //---------------------------------------
 // Rule_NotAdjacentToUsage
@@ -266,10 +297,10 @@ Rule_NotAdjacentToUsage::Rule_NotAdjacentToUsage( const XmlReader::XmlReaderIter
 	mPassValue = false;
 }
 //---------------------------------------
-bool Rule_NotAdjacentToUsage::IsValid( Tile* tile )
+bool Rule_NotAdjacentToUsage::IsValid( Tile* tile, DungeonGenerator& generator, const int32* /*state*/ ) const
 {
 	std::vector< Tile* > tilesToCheck;
-	GetTilesToCheck( tile, tilesToCheck );
+	GetTilesToCheck( tile, generator, tilesToCheck );
 
 	for ( auto itr = mUsages.begin(); itr != mUsages.end(); ++itr )
 	{
@@ -282,11 +313,17 @@ bool Rule_NotAdjacentToUsage::IsValid( Tile* tile )
 	return !mPassValue;
 }
 //---------------------------------------
-bool Rule_NotAdjacentToUsage::CheckTile( Tile* tile, int usage )
+bool Rule_NotAdjacentToUsage::CheckTile( Tile* tile, int usage ) const
 {
 	return tile->GetUsageId() == usage;
 }
 //---------------------------------------
+void Rule_NotAdjacentToUsage::Compile( RuleProgram& program ) const
+{
+	CompileAdjacent( program, RuleProgram::Match_USAGE );
+	program.AddValues( mUsages );
+}
+//---------------------------------------
 // Rule_NotAdjacentToObject
 Rule_NotAdjacentToObject::Rule_NotAdjacentToObject( const XmlReader::XmlReaderIterator& xmlItr )
 	: Rule_AdjacentTo( xmlItr )
@@ -295,10 +332,10 @@ Rule_NotAdjacentToObject::Rule_NotAdjacentToObject( const XmlReader::XmlReaderIt
 	mPassValue = false;
 }
 //---------------------------------------
-bool Rule_NotAdjacentToObject::IsValid( Tile* tile )
+bool Rule_NotAdjacentToObject::IsValid( Tile* tile, DungeonGenerator& generator, const int32* /*state*/ ) const
 {
 	std::vector< Tile* > tilesToCheck;
-	GetTilesToCheck( tile, tilesToCheck );
+	GetTilesToCheck( tile, generator, tilesToCheck );
 
 	for ( auto itr = mObjectNames.begin(); itr != mObjectNames.end(); ++itr )
 	{
@@ -311,11 +348,17 @@ bool Rule_NotAdjacentToObject::IsValid( Tile* tile )
 	return !mPassValue;
 }
 //---------------------------------------
-bool Rule_NotAdjacentToObject::CheckTile( Tile* tile, const std::string& objectName )
+bool Rule_NotAdjacentToObject::CheckTile( Tile* tile, Symbol objectName ) const
 {
 	return tile->HasObjectOfName( objectName );
 }
 //---------------------------------------
+void Rule_NotAdjacentToObject::Compile( RuleProgram& program ) const
+{
+	CompileAdjacent( program, RuleProgram::Match_OBJECT );
+	program.AddValues( mObjectNames );
+}
+//---------------------------------------
 // Rule_NotAdjacentToStyle
 Rule_NotAdjacentToStyle::Rule_NotAdjacentToStyle( const XmlReader::XmlReaderIterator& xmlItr )
 	: Rule_AdjacentTo( xmlItr )
@@ -324,10 +367,10 @@ Rule_NotAdjacentToStyle::Rule_NotAdjacentToStyle( const XmlReader::XmlReaderIter
 	mPassValue = false;
 }
 //---------------------------------------
-bool Rule_NotAdjacentToStyle::IsValid( Tile* tile )
+bool Rule_NotAdjacentToStyle::IsValid( Tile* tile, DungeonGenerator& generator, const int32* /*state*/ ) const
 {
 	std::vector< Tile* > tilesToCheck;
-	GetTilesToCheck( tile, tilesToCheck );
+	GetTilesToCheck( tile, generator, tilesToCheck );
 
 	for ( auto itr = mStyleNames.begin(); itr != mStyleNames.end(); ++itr )
 	{
@@ -340,11 +383,17 @@ bool Rule_NotAdjacentToStyle::IsValid( Tile* tile )
 	return !mPassValue;
 }
 //---------------------------------------
-bool Rule_NotAdjacentToStyle::CheckTile( Tile* tile, const std::string& styleName )
+bool Rule_NotAdjacentToStyle::CheckTile( Tile* tile, Symbol styleName ) const
 {
 	return tile->HasStyleOfName( styleName );
 }
 //---------------------------------------
+void Rule_NotAdjacentToStyle::Compile( RuleProgram& program ) const
+{
+	CompileAdjacent( program, RuleProgram::Match_STYLE );
+	program.AddValues( mStyleNames );
+}
+//---------------------------------------
 // Rule_AdjacentToUsage
 Rule_AdjacentToUsage::Rule_AdjacentToUsage( const XmlReader::XmlReaderIterator& xmlItr )
 	: Rule_NotAdjacentToUsage( xmlItr )
@@ -378,7 +427,7 @@ float Rule_DistanceTo::GetDistanceBetween( const Tile& startTile, const Tile& en
 	return (float) GetManhattanDistance( startTile.x, startTile.y, endTile.x, endTile.y );
 }
 //---------------------------------------
-bool Rule_DistanceTo::IsValid( Tile* tile )
+bool Rule_DistanceTo::IsValid( Tile* tile, DungeonGenerator& generator, const int32* /*state*/ ) const
 {
 	if ( tile->GetUsageId() == Tile::Tile_NONE )
 		return false;
@@ -393,7 +442,7 @@ bool Rule_DistanceTo::IsValid( Tile* tile )
 	{
 		for ( int x = startX; x < endX; ++ x )
 		{
-			Tile& t = mGrid->GetTileAt( x, y );
+			Tile& t = generator.GetTileAt( x, y );
 			bool doCheck = false;
 
 			// See if the tile should be checked
@@ -404,8 +453,7 @@ bool Rule_DistanceTo::IsValid( Tile* tile )
 			{
 				found = true;
 				float d = GetDistanceBetween( *tile, t );
-				bool valid = ( d >= mMinDist ) && ( mMaxDist == 0 || d <= mMaxDist );
-				if ( !valid )
+				if ( !IsInRange( d ) )
 					return false;
 			}
 		}
@@ -417,7 +465,62 @@ bool Rule_DistanceTo::IsValid( Tile* tile )
 Rule_DistanceToUsage::Rule_DistanceToUsage( const XmlReader::XmlReaderIterator& xmlItr )
 	: Rule_DistanceTo( xmlItr )
 	, Rule_UsageRule( xmlItr )
-{}
+{
+	// Walked distances are opt in, they pass without a matching tile in the room
+	if ( !xmlItr.GetAttributeAsBool( "walked", false ) )
+		return;
+
+	for ( auto itr = mUsages.begin(); itr != mUsages.end(); ++itr )
+	{
+		if ( *itr == Tile::Tile_ENTRANCE )
+			mFields.push_back( DistanceField_ENTRANCE );
+		else if ( *itr == Tile::Tile_EXIT )
+			mFields.push_back( DistanceField_EXIT );
+		else if ( *itr == Tile::Tile_DOOR_FRAME )
+			mFields.push_back( DistanceField_DOORS );
+		else
+		{
+			mFields.clear();
+			break;
+		}
+	}
+}
+//---------------------------------------
+bool Rule_DistanceToUsage::IsValid( Tile* tile, DungeonGenerator& generator, const int32* state ) const
+{
+	// With walked="true" and usages the generator keeps a distance field for, they are looked up
+	// Distance is walked to the nearest tile of any usage instead of measured to each in the room
+	if ( mFields.empty() )
+		return Rule_DistanceTo::IsValid( tile, generator, state );
+
+	if ( tile->GetUsageId() == Tile::Tile_NONE )
+		return false;
+
+	int nearest = -1;
+	for ( auto itr = mFields.begin(); itr != mFields.end(); ++itr )
+	{
+		const int d = generator.GetDistanceField( (DistanceFieldId) *itr ).GetNearDistance( tile->x, tile->y );
+		if ( d >= 0 && ( nearest < 0 || d < nearest ) )
+			nearest = d;
+	}
+	return nearest >= 0 && IsInRange( (float) nearest );
+}
+//---------------------------------------
+void Rule_DistanceToUsage::Compile( RuleProgram& program ) const
+{
+	if ( mFields.empty() )
+	{
+		program.Emit( RuleProgram::Op_DISTANCE, this, RuleProgram::Match_USAGE );
+		program.SetRange( mMinDist, mMaxDist );
+		program.AddValues( mUsages );
+	}
+	else
+	{
+		program.Emit( RuleProgram::Op_DISTANCE_FIELD, this );
+		program.SetRange( mMinDist, mMaxDist );
+		program.AddValues( mFields );
+	}
+}
 //---------------------------------------
 bool Rule_DistanceToUsage::ShouldCheck( const Tile& tile ) const
 {
@@ -459,6 +562,13 @@ float Rule_DistanceToObject::GetDistanceBetween( const Tile& startTile, const Ti
 	return Rule_DistanceTo::GetDistanceBetween( startTile, endTile );
 }
 //---------------------------------------
+void Rule_DistanceToObject::Compile( RuleProgram& program ) const
+{
+	program.Emit( RuleProgram::Op_DISTANCE, this, RuleProgram::Match_OBJECT );
+	program.SetRange( mMinDist, mMaxDist );
+	program.AddValues( mObjectNames );
+}
+//---------------------------------------
 // Rule_DistanceToStyle
 Rule_DistanceToStyle::Rule_DistanceToStyle( const XmlReader::XmlReaderIterator& xmlItr )
 	: Rule_DistanceTo( xmlItr )
@@ -482,6 +592,13 @@ float Rule_DistanceToStyle::GetDistanceBetween( const Tile& startTile, const Til
 	return Rule_DistanceTo::GetDistanceBetween( startTile, endTile );
 }
 //---------------------------------------
+void Rule_DistanceToStyle::Compile( RuleProgram& program ) const
+{
+	program.Emit( RuleProgram::Op_DISTANCE, this, RuleProgram::Match_STYLE );
+	program.SetRange( mMinDist, mMaxDist );
+	program.AddValues( mStyleNames );
+}
+//---------------------------------------
 // Rule_ValidDepths
 Rule_ValidDepths::Rule_ValidDepths( const XmlReader::XmlReaderIterator& xmlItr )
 {
@@ -584,7 +701,6 @@ Rule_ValidDepths::Rule_ValidDepths( const Rule_ValidDepths& other )
 {
 	for ( auto itr = other.mValidDepths.begin(); itr != other.mValidDepths.end(); ++itr )
 		mValidDepths.push_back( (*itr)->Copy() );
-	mGrid = other.mGrid;
 }
 //---------------------------------------
 Rule_ValidDepths::~Rule_ValidDepths()
@@ -593,9 +709,9 @@ Rule_ValidDepths::~Rule_ValidDepths()
 		delete *itr;
 }
 //---------------------------------------
-bool Rule_ValidDepths::IsValid( Tile* tile )
+bool Rule_ValidDepths::IsValid( Tile* /*tile*/, DungeonGenerator& generator, const int32* /*state*/ ) const
 {
-	return ValidateDepth( ( (DungeonGenerator*) mGrid )->GetCurrentDepth() );
+	return ValidateDepth( generator.GetCurrentDepth() );
 }
 //---------------------------------------
 void Rule_ValidDepths::AddValidDepth( DepthValue* depth )
@@ -613,13 +729,25 @@ bool Rule_ValidDepths::ValidateDepth( int currentDepth ) const
 	return false;
 }
 //---------------------------------------
+void Rule_ValidDepths::Compile( RuleProgram& program ) const
+{
+	program.Emit( RuleProgram::Op_DEPTH, this );
+	for ( auto itr = mValidDepths.begin(); itr != mValidDepths.end(); ++itr )
+	{
+		int min, max;
+		(*itr)->GetDepthRange( min, max );
+		program.AddValue( min );
+		program.AddValue( max );
+	}
+}
+//---------------------------------------
 // Rule_RoomContains
 Rule_RoomContains::Rule_RoomContains()
 	: Rule()
 	, mPassValue( true )
 {}
 //---------------------------------------
-bool Rule_RoomContains::IsValid( Tile* tile )
+bool Rule_RoomContains::IsValid( Tile* tile, DungeonGenerator& generator, const int32* /*state*/ ) const
 {
 	Room* room = tile->mRoom;
 	if ( room )
@@ -634,7 +762,7 @@ bool Rule_RoomContains::IsValid( Tile* tile )
 		{
 			for ( int x = startX; x < endX; ++ x )
 			{
-				Tile& t = mGrid->GetTileAt( x, y );
+				Tile& t = generator.GetTileAt( x, y );
 
 				if ( CheckTile( t ) )
 					return mPassValue;
@@ -652,7 +780,7 @@ Rule_RoomDoesNotHaveUsage::Rule_RoomDoesNotHaveUsage( const XmlReader::XmlReader
 	mPassValue = false;
 }
 //---------------------------------------
-bool Rule_RoomDoesNotHaveUsage::CheckTile( const Tile& tile )
+bool Rule_RoomDoesNotHaveUsage::CheckTile( const Tile& tile ) const
 {
 	for ( auto itr = mUsages.begin(); itr != mUsages.end(); ++itr )
 	{
@@ -664,6 +792,12 @@ bool Rule_RoomDoesNotHaveUsage::CheckTile( const Tile& tile )
 	return false;
 }
 //---------------------------------------
+void Rule_RoomDoesNotHaveUsage::Compile( RuleProgram& program ) const
+{
+	program.Emit( RuleProgram::Op_ROOM_CONTAINS, this, RuleProgram::Match_USAGE, mPassValue );
+	program.AddValues( mUsages );
+}
+//---------------------------------------
 // Rule_RoomDoesHaveUsage
 Rule_RoomDoesHaveUsage::Rule_RoomDoesHaveUsage( const XmlReader::XmlReaderIterator& xmlItr )
 	: Rule_RoomDoesNotHaveUsage( xmlItr )
@@ -679,7 +813,7 @@ Rule_RoomDoesNotHaveStyle::Rule_RoomDoesNotHaveStyle( const XmlReader::XmlReader
 	mPassValue = false;
 }
 //---------------------------------------
-bool Rule_RoomDoesNotHaveStyle::CheckTile( const Tile& tile )
+bool Rule_RoomDoesNotHaveStyle::CheckTile( const Tile& tile ) const
 {
 	for ( auto itr = mStyleNames.begin(); itr != mStyleNames.end(); ++itr )
 	{
@@ -691,6 +825,12 @@ bool Rule_RoomDoesNotHaveStyle::CheckTile( const Tile& tile )
 	return false;
 }
 //---------------------------------------
+void Rule_RoomDoesNotHaveStyle::Compile( RuleProgram& program ) const
+{
+	program.Emit( RuleProgram::Op_ROOM_CONTAINS, this, RuleProgram::Match_STYLE, mPassValue );
+	program.AddValues( mStyleNames );
+}
+//---------------------------------------
 // Rule_RoomDoesHaveStyle
 Rule_RoomDoesHaveStyle::Rule_RoomDoesHaveStyle( const XmlReader::XmlReaderIterator& xmlItr )
 	: Rule_RoomDoesNotHaveStyle( xmlItr )
@@ -706,7 +846,7 @@ Rule_RoomDoesNotHaveObject::Rule_RoomDoesNotHaveObject( const XmlReader::XmlRead
 	mPassValue = false;
 }
 //---------------------------------------
-bool Rule_RoomDoesNotHaveObject::CheckTile( const Tile& tile )
+bool Rule_RoomDoesNotHaveObject::CheckTile( const Tile& tile ) const
 {
 	for ( auto itr = mObjectNames.begin(); itr != mObjectNames.end(); ++itr )
 	{
@@ -718,6 +858,12 @@ bool Rule_RoomDoesNotHaveObject::CheckTile( const Tile& tile )
 	return false;
 }
 //---------------------------------------
+void Rule_RoomDoesNotHaveObject::Compile( RuleProgram& program ) const
+{
+	program.Emit( RuleProgram::Op_ROOM_CONTAINS, this, RuleProgram::Match_OBJECT, mPassValue );
+	program.AddValues( mObjectNames );
+}
+//---------------------------------------
 // Rule_RoomDoesHaveObject
 Rule_RoomDoesHaveObject::Rule_RoomDoesHaveObject( const XmlReader::XmlReaderIterator& xmlItr )
 	: Rule_RoomDoesNotHaveObject( xmlItr )
@@ -731,65 +877,124 @@ Rule_RoomDoesHaveObject::Rule_RoomDoesHaveObject( const XmlReader::XmlReaderIter
 // RuledObject
 RuledObject::~RuledObject()
 {
-	for ( auto itr = mRules.begin(); itr != mRules.end(); ++itr )
+	for ( auto itr = mOwnedRules.begin(); itr != mOwnedRules.end(); ++itr )
 		delete *itr;
 }
 //---------------------------------------
-void RuledObject::ResetRules()
+bool RuledObject::sUseCompiledRules = true;
+//---------------------------------------
+RuledObject::RuledObject()
+	: mRulesCompiled( false )
+	, mStateSlot( -1 )
+{}
+//---------------------------------------
+void RuledObject::ResetRules( RuleState& state )
 {
+	int32* slots = GetState( state );
 	for ( auto itr = mRules.begin(); itr != mRules.end(); ++itr )
-		(*itr)->Reset();
+	{
+		(*itr)->Reset( slots );
+		slots += (*itr)->GetStateSize();
+	}
 }
 //---------------------------------------
 void RuledObject::AddRule( Rule* rule )
 {
 	mRules.push_back( rule );
+	mOwnedRules.push_back( rule );
+	mRulesCompiled = false;
+	mStateSlot = -1;
 }
 //---------------------------------------
 void RuledObject::AddRules( const std::vector< Rule* >& rules )
 {
 	mRules.insert( mRules.end(), rules.begin(), rules.end() );
+	mOwnedRules.insert( mOwnedRules.end(), rules.begin(), rules.end() );
+	mRulesCompiled = false;
+	mStateSlot = -1;
+}
+//---------------------------------------
+void RuledObject::CompileRules()
+{
+	mProgram.Compile( mRules );
+	mRulesCompiled = true;
+}
+//---------------------------------------
+const RuleProgram& RuledObject::GetCompiledRules()
+{
+	if ( !mRulesCompiled )
+		CompileRules();
+	return mProgram;
+}
+//---------------------------------------
+void RuledObject::AllocateState( RuleState& state )
+{
+	if ( mStateSlot >= 0 )
+		return;
+
+	int size = 0;
+	for ( auto itr = mRules.begin(); itr != mRules.end(); ++itr )
+		size += (*itr)->GetStateSize();
+	mStateSlot = state.Allocate( size );
+	ResetRules( state );
+}
+//---------------------------------------
+int32* RuledObject::GetState( RuleState& state )
+{
+	if ( mStateSlot < 0 )
+		AllocateState( state );
+	return state.GetSlots( mStateSlot );
 }
 //---------------------------------------
-bool RuledObject::ValidateRules( Tile* tile )
+bool RuledObject::ValidateRules( Tile* tile, DungeonGenerator& generator, RuleState& state )
 {
+	const int32* slots = GetState( state );
+	if ( sUseCompiledRules )
+	{
+		if ( !mRulesCompiled )
+			CompileRules();
+		return mProgram.Run( tile, generator, slots );
+	}
+
 	bool ret = true;
 	for ( auto itr = mRules.begin(); itr != mRules.end(); ++itr )
 	{
-		Rule* r = *itr;
-		if ( r && !r->IsValid( tile ) )
+		const Rule* r = *itr;
+		if ( !r->IsValid( tile, generator, slots ) )
 		{
 			ret = false;
 			break;
 		}
+		slots += r->GetStateSize();
 	}
 	return ret;
 }
 //---------------------------------------
-void RuledObject::NotifySuccess()
+void RuledObject::NotifySuccess( RuleState& state )
 {
+	int32* slots = GetState( state );
 	for ( auto itr = mRules.begin(); itr != mRules.end(); ++itr )
 	{
-		(*itr)->NotifySuccess();
+		(*itr)->NotifySuccess( slots );
+		slots += (*itr)->GetStateSize();
 	}
 }
 //---------------------------------------
-/*void RuledObject::LoadRulesFromXML( const XmlReader::XmlReaderIterator& xmlItr, TileGrid* ownerGrid )
+void RuledObject::NotifyRemoved( RuleState& state )
 {
-	for ( XmlReader::XmlReaderIterator ruleItr = xmlItr.NextChild( "Rule" );
-		ruleItr.IsValid(); ruleItr = ruleItr.NextSibling( "Rule" ) )
+	int32* slots = GetState( state );
+	for ( auto itr = mRules.begin(); itr != mRules.end(); ++itr )
 	{
-		Rule* rule = Rule::CreateRule( ruleItr );
-		rule->mGrid = ownerGrid;
-		mRules.push_back( rule );
+		(*itr)->NotifyRemoved( slots );
+		slots += (*itr)->GetStateSize();
 	}
-}*/
+}
 //---------------------------------------
 void RuledObject::CopyRulesFrom( RuledObject* obj )
 {
-	for ( auto itr = obj->mRules.begin(); itr != obj->mRules.end(); ++itr )
-		mRules.push_back( (*itr)->Copy() );
-	//mRules.insert( mRules.end(), obj->mRules.begin(), obj->mRules.end() );
+	mRules.insert( mRules.end(), obj->mRules.begin(), obj->mRules.end() );
+	mRulesCompiled = false;
+	mStateSlot = -1;
 }
 //---------------------------------------
 
@@ -803,10 +1008,10 @@ void EventObject::LoadEventsFromXML( const XmlReader::XmlReaderIterator& xmlItr
 	{
 		std::string type = itr.GetAttributeAsString( "type" );
 		std::string tag = itr.GetAttributeAsString( "tag" );
-		unsigned int taghash = EventListener::TagFromString( tag );
+		EventTag tagId = EventListener::TagFromString( tag );
 		int eventType = EventListener::SignalFromString( type );
 		DebugPrintf( "Load signal: %s %s\n", type.c_str(), tag.c_str() );
-		mSignals[ eventType ].push_back( taghash );
+		mSignals[ eventType ].push_back( tagId );
 	}
 
 	for ( XmlReader::XmlReaderIterator itr = xmlItr.NextChild( "Slot" );
@@ -815,23 +1020,8 @@ void EventObject::LoadEventsFromXML( const XmlReader::XmlReaderIterator& xmlItr
 		std::string tag = itr.GetAttributeAsString( "tag" );
 		std::string commands = itr.GetAttributeAsString( "commands" );
 		DebugPrintf( "Load slot: %s %s\n", tag.c_str(), commands.c_str() );
-		unsigned int taghash = EventListener::TagFromString( tag );
-		mSlots[ taghash ].push_back( commands );
-	}
-}
-//---------------------------------------
-void EventObject::SetupEvents( Entity* entity ) const
-{
-	for ( auto itr = mSignals.begin(); itr != mSignals.end(); ++itr )
-	{
-		for ( auto jtr = itr->second.begin(); jtr != itr->second.end(); ++jtr )
-			entity->RegisterSignal( itr->first, *jtr );
-	}
-
-	for ( auto itr = mSlots.begin(); itr != mSlots.end(); ++itr )
-	{
-		for ( auto jtr = itr->second.begin(); jtr != itr->second.end(); ++jtr )
-			entity->RegisterSlot( itr->first, *jtr );
+		EventTag tagId = EventListener::TagFromString( tag );
+		mSlots[ tagId ].push_back( commands );
 	}
 }
 //---------------------------------------
@@ -863,18 +1053,9 @@ int TileObject::GetUsageIdFromString( const std::string& str )
 
 //---------------------------------------
 // SpawnList
-const std::string& SpawnList::GetRandomObject() const
+int SpawnList::GetRandomIndex( RNG& rng ) const
 {
-	return mList[ RNG::RandomIndex( mList.size() ) ];
-}
-//---------------------------------------
-
-
-//---------------------------------------
-// TileObject_Spawner
-const std::string& TileObject_Spawner::GetObjectToSpawn() const
-{
-	return mList->GetRandomObject();
+	return mList.empty() ? -1 : (int) rng.RandomIndex( (unsigned) mList.size() );
 }
 //---------------------------------------
 
@@ -910,10 +1091,10 @@ int TileStyle::GetUsageIdFromString( const std::string& str )
 
 //---------------------------------------
 // Useable
-void Useable::ResetRules()
+void Useable::ResetRules( RuleState& state )
 {
-	RuledObject::ResetRules();
-//	mObject->ResetRules();
+	RuledObject::ResetRules( state );
+//	mObject->ResetRules( mRuleState );
 }
 //---------------------------------------
 
@@ -941,21 +1122,34 @@ void RoomTemplate::CopyDataFrom( RoomTemplate* room )
 	mMaxRoomSizeY = room->mMaxRoomSizeY;
 }
 //---------------------------------------
-TileStyle* RoomTemplate::GetStyle( Tile* tile )
+TileStyle* RoomTemplate::GetStyle( Tile* tile, DungeonGenerator& generator, RuleState& state, const CandidateMasks* masks )
 {
-	std::vector< Useable* >& styles = mStyles[ tile->GetUsageId() ];
+	// Only look, adding an empty list would make HasStyleForUsage() true for usage
+	const int usage = tile->GetUsageId();
+	auto found = mStyles.find( usage );
+	if ( found == mStyles.end() )
+		return 0;
+
+	std::vector< Useable* >& styles = found->second;
 	if ( !styles.empty() )
 	{
-		for ( auto itr = styles.begin(); itr != styles.end(); ++itr )
+		// Masks of the styles follow the objects', in map order
+		int id = 2 * (int) mObjects.size();
+		for ( auto itr = mStyles.begin(); masks && itr->first != usage; ++itr )
+			id += 2 * (int) itr->second.size();
+
+		for ( auto itr = styles.begin(); itr != styles.end(); ++itr, id += 2 )
 		{
 			Useable* u = *itr;
-			if ( u->ValidateRules( tile ) )
+			if ( masks && !masks->Test( id, *tile ) )
+				continue;
+			if ( u->ValidateRules( tile, generator, state ) )
 			{
 				TileStyle* obj = (TileStyle*) u->mObject;
-				if ( obj->ValidateRules( tile ) )
+				if ( ( !masks || masks->Test( id + 1, *tile ) ) && obj->ValidateRules( tile, generator, state ) )
 				{
-					u->NotifySuccess();
-					obj->NotifySuccess();
+					u->NotifySuccess( state );
+					obj->NotifySuccess( state );
 					return obj;
 				}
 			}
@@ -975,18 +1169,21 @@ bool RoomTemplate::HasStyleForUsage( int usage ) const
 	return mStyles.find( usage ) != mStyles.end();
 }
 //---------------------------------------
-TileObject* RoomTemplate::GetObject( Tile* tile )
+TileObject* RoomTemplate::GetObject( Tile* tile, DungeonGenerator& generator, RuleState& state, const CandidateMasks* masks )
 {
-	for ( auto itr = mObjects.begin(); itr != mObjects.end(); ++itr )
+	int id = 0;
+	for ( auto itr = mObjects.begin(); itr != mObjects.end(); ++itr, id += 2 )
 	{
 		Useable* u = *itr;
-		if ( u->ValidateRules( tile ) )
+		if ( masks && !masks->Test( id, *tile ) )
+			continue;
+		if ( u->ValidateRules( tile, generator, state ) )
 		{
 			TileObject* obj = (TileObject*) u->mObject;
-			if ( obj->ValidateRules( tile ) )
+			if ( ( !masks || masks->Test( id + 1, *tile ) ) && obj->ValidateRules( tile, generator, state ) )
 			{
-				u->NotifySuccess();
-				obj->NotifySuccess();
+				u->NotifySuccess( state );
+				obj->NotifySuccess( state );
 				return obj;
 			}
 		}
@@ -1001,23 +1198,96 @@ void RoomTemplate::AddObject( Useable* object )
 		mObjects.push_back( object );
 }
 //---------------------------------------
-void RoomTemplate::ResetRules()
+void RoomTemplate::ResetRules( RuleState& state )
+{
+	RuledObject::ResetRules( state );
+	for ( auto itr = mObjects.begin(); itr != mObjects.end(); ++itr )
+		(*itr)->ResetRules( state );
+	for ( auto itr = mStyles.begin(); itr != mStyles.end(); ++itr )
+		for ( auto jtr = itr->second.begin(); jtr != itr->second.end(); ++jtr )
+			(*jtr)->ResetRules( state );
+}
+//---------------------------------------
+void RoomTemplate::ResetObjects( RuleState& state )
+{
+	for ( auto itr = mObjects.begin(); itr != mObjects.end(); ++itr )
+		(*itr)->mObject->ResetRules( state );
+	for ( auto itr = mStyles.begin(); itr != mStyles.end(); ++itr )
+		for ( auto jtr = itr->second.begin(); jtr != itr->second.end(); ++jtr )
+			(*jtr)->mObject->ResetRules( state );
+}
+//---------------------------------------
+void RoomTemplate::CompileAllRules( RuleState& state )
+{
+	// Objects used in more than one place are compiled and given slots the first time only
+	GetCompiledRules();
+	AllocateState( state );
+	for ( auto itr = mObjects.begin(); itr != mObjects.end(); ++itr )
+	{
+		(*itr)->GetCompiledRules();
+		(*itr)->AllocateState( state );
+		(*itr)->mObject->GetCompiledRules();
+		(*itr)->mObject->AllocateState( state );
+	}
+	for ( auto itr = mStyles.begin(); itr != mStyles.end(); ++itr )
+	{
+		for ( auto jtr = itr->second.begin(); jtr != itr->second.end(); ++jtr )
+		{
+			(*jtr)->GetCompiledRules();
+			(*jtr)->AllocateState( state );
+			(*jtr)->mObject->GetCompiledRules();
+			(*jtr)->mObject->AllocateState( state );
+		}
+	}
+}
+//---------------------------------------
+void RoomTemplate::ReleaseAllState()
 {
-	RuledObject::ResetRules();
+	ReleaseState();
 	for ( auto itr = mObjects.begin(); itr != mObjects.end(); ++itr )
-		(*itr)->ResetRules();
+	{
+		(*itr)->ReleaseState();
+		(*itr)->mObject->ReleaseState();
+	}
 	for ( auto itr = mStyles.begin(); itr != mStyles.end(); ++itr )
+	{
 		for ( auto jtr = itr->second.begin(); jtr != itr->second.end(); ++jtr )
-			(*jtr)->ResetRules();
+		{
+			(*jtr)->ReleaseState();
+			(*jtr)->mObject->ReleaseState();
+		}
+	}
 }
 //---------------------------------------
-void RoomTemplate::ResetObjects()
+void RoomTemplate::BuildCandidates( CandidateMasks& masks, DungeonGenerator& generator, RuleState& state, const Room& room )
 {
+	// Every useable and its object, objects first then styles in map order
+	std::vector< RuledObject* > objects;
 	for ( auto itr = mObjects.begin(); itr != mObjects.end(); ++itr )
-		(*itr)->mObject->ResetRules();
+	{
+		objects.push_back( *itr );
+		objects.push_back( (*itr)->mObject );
+	}
 	for ( auto itr = mStyles.begin(); itr != mStyles.end(); ++itr )
+	{
 		for ( auto jtr = itr->second.begin(); jtr != itr->second.end(); ++jtr )
-			(*jtr)->mObject->ResetRules();
+		{
+			objects.push_back( *jtr );
+			objects.push_back( (*jtr)->mObject );
+		}
+	}
+
+	int margin = 0;
+	for ( auto itr = objects.begin(); itr != objects.end(); ++itr )
+	{
+		margin = std::max( margin, (*itr)->GetCompiledRules().GetReach() );
+		(*itr)->GetState( state );
+	}
+
+	// Every slot is allocated by now so the state pointers stay good
+	masks.Begin( generator, room, margin );
+	for ( auto itr = objects.begin(); itr != objects.end(); ++itr )
+		masks.Add( (*itr)->GetCompiledRules(), (*itr)->GetState( state ) );
 }
 //---------------------------------------
 void RoomTemplate::SetMinSize( int x, int y )
@@ -1088,14 +1358,14 @@ float Tile::GetOrientation() const
 	return 0;
 }
 //---------------------------------------
-bool Tile::HasObjectOfName( const std::string& name ) const
+bool Tile::HasObjectOfName( Symbol name ) const
 {
-	return mObject && mObject->mName == name;
+	return mObject && mObject->mNameId == name;
 }
 //---------------------------------------
-bool Tile::HasStyleOfName( const std::string& name ) const
+bool Tile::HasStyleOfName( Symbol name ) const
 {
-	return mStyle && mStyle->mName == name;
+	return mStyle && mStyle->mNameId == name;
 }
 //---------------------------------------
 bool Tile::CanBeLocked() const
@@ -1119,10 +1389,26 @@ DungeonGenerator::DungeonGenerator()
 	, mChanceToLock( 0.5f )
 	, mDoorChance( 0.5f )
 	, DebugSectors( false )
+	, mEdgeExits( 0 )
+	, mLayout( 0 )
+	, mLayoutOnly( false )
+	, mGeneratingSpawns( false )
+	, mSolvable( false )
+	, mRoomConnectionsBuilt( false )
+	, mRoomArea( 0 )
+	, mPhase( Phase_DONE )
+	, mTileCursor( 0 )
+	, mPlacementAttempt( 0 )
+	, mDoorsPlaced( 0 )
+	, mSpawnRoomIndex( 0 )
+	, mWorkMilliseconds( 0 )
+	, mPlacedAt( 0 )
+	, mFinishEstimate( 0 )
 	, mCurrentDepth( 0 )
 {
 	mDirectionBias[0] = 0;
 	mDirectionBias[1] = 0;
+	mSpawnRNG = mRNG.Split( SPAWN_RNG_STREAM );
 }
 //---------------------------------------
 DungeonGenerator::DungeonGenerator( int width, int height, int maxRoomCount, int minRoomWidth, int maxRoomWidth, int minRoomHeight, int maxRoomHeight )
@@ -1138,10 +1424,26 @@ DungeonGenerator::DungeonGenerator( int width, int height, int maxRoomCount, int
 	, mChanceToLock( 0.5f )
 	, mDoorChance( 0.5f )
 	, DebugSectors( false )
+	, mEdgeExits( 0 )
+	, mLayout( 0 )
+	, mLayoutOnly( false )
+	, mGeneratingSpawns( false )
+	, mSolvable( false )
+	, mRoomConnectionsBuilt( false )
+	, mRoomArea( 0 )
+	, mPhase( Phase_DONE )
+	, mTileCursor( 0 )
+	, mPlacementAttempt( 0 )
+	, mDoorsPlaced( 0 )
+	, mSpawnRoomIndex( 0 )
+	, mWorkMilliseconds( 0 )
+	, mPlacedAt( 0 )
+	, mFinishEstimate( 0 )
 	, mCurrentDepth( 0 )
 {
 	mDirectionBias[0] = 0;
 	mDirectionBias[1] = 0;
+	mSpawnRNG = mRNG.Split( SPAWN_RNG_STREAM );
 }
 //---------------------------------------
 DungeonGenerator::~DungeonGenerator()
@@ -1162,116 +1464,284 @@ void DungeonGenerator::Init( int width, int height, int maxRoomCount, int minRoo
 
 	mDirectionBias[0] = 0;
 	mDirectionBias[1] = 0;
-
-	for ( auto itr = mRoomTemplates.begin(); itr != mRoomTemplates.end(); ++itr )
-		delete *itr;
-	mRoomTemplates.clear();
 }
 //---------------------------------------
 void DungeonGenerator::Generate()
 {
-	Clear();
+	Generate( GenerationBudget() );
+}
+//---------------------------------------
+void DungeonGenerator::Generate( const GenerationBudget& budget )
+{
+	BeginGenerate( budget );
+	Step( 0 );
+}
+//---------------------------------------
+void DungeonGenerator::BeginGenerate( const GenerationBudget& budget )
+{
+	mBudget = budget;
+	mPhase = Phase_CLEAR;
+	mTileCursor = 0;
+	mPlacementAttempt = 0;
+	mDoorsPlaced = 0;
+	mSpawnRoomIndex = 0;
+	mWorkMilliseconds = 0;
+	mPlacedAt = 0;
+}
+//---------------------------------------
+bool DungeonGenerator::Step( int budgetMicroseconds )
+{
+	Timer stepTimer;
+	const double stepMilliseconds = budgetMicroseconds / 1000.0;
+
+	// Every call gets at least one piece of work done so a tiny budget still finishes
+	bool progressed = false;
+	while ( mPhase != Phase_DONE )
+	{
+		if ( progressed && budgetMicroseconds > 0 && stepTimer.GetElapsedMilliseconds() >= stepMilliseconds )
+			break;
+		progressed = true;
+
+		Timer timer;
+		switch ( mPhase )
+		{
+		case Phase_CLEAR:
+		{
+			// Large grids take a while to reset so it is done a slice at a time
+			const int end = std::min( mTileCursor + STEP_TILE_COUNT, mWidth * mHeight );
+			ClearTiles( mTileCursor, end );
+			mTileCursor = end;
+			if ( end == mWidth * mHeight )
+			{
+				ClearFloorData();
+				mTimings = GenerationTimings();
+				mFloorName = mName + " Level " + StringUtil::ToString( ++mCurrentDepth );
+				mTileCursor = 0;
+				mPhase = Phase_PLACE_ROOMS;
+			}
+			break;
+		}
+
+		case Phase_PLACE_ROOMS:
+		{
+			bool placed = true;
+			if ( mLayout )
+			{
+				mLayout->PlaceRooms( *this );
+				mTimings.mRoomAttempts = (int) mRooms.size();
+				mTimings.mPlacementStop = GenerationTimings::Stop_LAYOUT;
+			}
+			else
+				placed = PlaceRooms( stepTimer, budgetMicroseconds > 0 ? stepMilliseconds : 0 );
+			mTimings.mPlaceRooms += timer.Lap();
+			if ( placed )
+			{
+				mTimings.mRoomsPlaced = (int) mRooms.size();
+				mTimings.mFillRatio = mWidth * mHeight > 0 ? mRoomArea / (float) ( mWidth * mHeight ) : 0;
+				mPlacedAt = mWorkMilliseconds + stepTimer.GetElapsedMilliseconds();
+				mPhase = Phase_GATHER_DOORS;
+			}
+			break;
+		}
+
+		case Phase_GATHER_DOORS:
+		{
+			const int end = std::min( mTileCursor + STEP_TILE_COUNT, mWidth * mHeight );
+			GatherDoors( mTileCursor, end );
+			mTileCursor = end;
+			mTimings.mGatherDoors += timer.Lap();
+			if ( end == mWidth * mHeight )
+			{
+				mTileCursor = 0;
+				mPhase = Phase_PLACE_ENTRANCE;
+			}
+			break;
+		}
+
+		case Phase_PLACE_ENTRANCE:
+			// Find a starting location
+			PlaceEntrance();
+			mTimings.mPlaceEntrance = timer.Lap();
+			mPhase = Phase_CALCULATE_SECTORS;
+			break;
+
+		case Phase_CALCULATE_SECTORS:
+			// Figure out a critical path through the level
+			CalculateSectors();
+			mTimings.mCalculateSectors = timer.Lap();
+			mPhase = Phase_PLACE_EXIT;
+			break;
+
+		case Phase_PLACE_EXIT:
+			// Find an ending location
+			PlaceExit();
+			ProveSolvable();
+			mTimings.mPlaceExit = timer.Lap();
+			mPhase = Phase_GENERATE_SPAWN_DATA;
+			break;
+
+		case Phase_GENERATE_SPAWN_DATA:
+			// Generate objects and world geometry to spawn, one room at a time
+			// It draws from its own stream so skipping it leaves the layout stream as it is
+			if ( !mLayoutOnly && mSpawnRoomIndex < (int) mRooms.size() )
+				GenerateRoomSpawnData( *mRooms[ mSpawnRoomIndex++ ] );
+			mTimings.mGenerateSpawnData += timer.Lap();
+			if ( mLayoutOnly || mSpawnRoomIndex >= (int) mRooms.size() )
+			{
+				FinishGenerate( mWorkMilliseconds + stepTimer.GetElapsedMilliseconds() );
+				mPhase = Phase_DONE;
+			}
+			break;
+
+		default:
+			mPhase = Phase_DONE;
+			break;
+		}
+	}
 
-	mFloorName = mName + " Level " + StringUtil::ToString( ++mCurrentDepth );
+	mWorkMilliseconds += stepTimer.GetElapsedMilliseconds();
+	return mPhase == Phase_DONE;
+}
+//---------------------------------------
+bool DungeonGenerator::PlaceRooms( const Timer& stepTimer, double stepMilliseconds )
+{
+	const bool hasTarget = mBudget.mRoomCount > 0 || mBudget.mFillRatio > 0 || mBudget.mMinSectorCount > 0;
 
 	// Make a central room to start with
-	mRooms.push_back( new Room() );
-	GenerateRoom( *mRooms.back() );
-	AddRoom( *mRooms.back(), mWidth / 2 - mRooms.back()->GetWidth() / 2, mHeight / 2 - mRooms.back()->GetHeight() / 2, 0 );
-
-	// Make a new room and try to randomly connect it to an existing room
-	// If the new room doesn't fit just throw it away and make another new room
-	//
-	// A possible improvement to this algorithm would be to figure out the available area
-	// for a new room and use that to ensure the generated room would fit. The main advantage
-	// of this approach would be reduced iterations which could potentially speed up the generation
-	// process.
+	if ( mRooms.empty() )
+	{
+		RoomTemplate* tmpl = GetValidRoomTemplate();
+		int minSizeX, maxSizeX, minSizeY, maxSizeY;
+		GetRoomSizeRange( *tmpl, minSizeX, maxSizeX, minSizeY, maxSizeY );
+		const int w = mRNG.RandomInRange( minSizeX, maxSizeX );
+		const int h = mRNG.RandomInRange( minSizeY, maxSizeY );
+
+		Room* room = new Room();
+		GenerateRoom( *room, tmpl, w, h );
+		AddRoom( *room, mWidth / 2 - w / 2, mHeight / 2 - h / 2, 0 );
+
+		if ( mEdgeExits != 0 )
+			AddEdgeExits( *room );
+	}
+
+	// Pick a door on an existing room and grow a new room out of it
+	// The room is sized against mFreeSpace before it is created so
+	// attempts that cannot fit are rejected without touching the grid
 	const int n = mWidth * mHeight * 2;
-	for ( int i = 0; i < n; ++i )
+	for ( ; mPlacementAttempt < n; ++mPlacementAttempt )
 	{
 		// Max of zero
 		if ( mMaxRoomCount != 0 )
 		{
 			// Check if we made enough rooms
 			if ( mRooms.size() == mMaxRoomCount )
-				break;
+			{
+				mTimings.mPlacementStop = GenerationTimings::Stop_MAX_ROOMS;
+				return true;
+			}
+		}
+
+		if ( hasTarget && IsTargetMet( mBudget, mDoorsPlaced ) )
+		{
+			mTimings.mPlacementStop = GenerationTimings::Stop_TARGET;
+			return true;
+		}
+
+		// Reading the clock costs more than an attempt on a small map so only check it every so often
+		if ( ( mPlacementAttempt & 31 ) == 0 && ( mBudget.mMilliseconds > 0 || stepMilliseconds > 0 ) )
+		{
+			const double elapsed = stepTimer.GetElapsedMilliseconds();
+
+			// Leave as much of the budget for the passes after placement as they took per room last time
+			if ( mBudget.mMilliseconds > 0 && mWorkMilliseconds + elapsed + mFinishEstimate * mRooms.size() >= mBudget.mMilliseconds )
+			{
+				mTimings.mPlacementStop = GenerationTimings::Stop_BUDGET;
+				return true;
+			}
+
+			// Out of time for this Step(), carry on from here next time
+			if ( stepMilliseconds > 0 && elapsed >= stepMilliseconds )
+				return false;
 		}
 
 		// Get a place to put a door
+		// If there are none left the map is full
 		int doorX, doorY, dir;
-		GetDoorLocation( doorX, doorY );
+		if ( !GetDoorLocation( doorX, doorY ) )
+		{
+			mTimings.mPlacementStop = GenerationTimings::Stop_FULL;
+			return true;
+		}
 		dir = GetDoorDirection( doorX, doorY );
 
 		if ( dir != Dir_INVALID )
 		{
-			int rx, ry;
+			RoomTemplate* tmpl = GetValidRoomTemplate();
+			int w, h;
+			++mTimings.mRoomAttempts;
 
-			Room* newRoom = new Room();
-			GenerateRoom( *newRoom );
-
-			if ( dir == Dir_NORTH )
-			{
-				rx = doorX - newRoom->GetWidth() / 2;
-				ry = doorY - newRoom->GetHeight();
-			}
-			else if ( dir == Dir_SOUTH )
-			{
-				rx = doorX - newRoom->GetWidth() / 2;
-				ry = doorY + 1;
-			}
-			else if ( dir == Dir_EAST )
-			{
-				rx = doorX - newRoom->GetWidth();
-				ry = doorY - newRoom->GetHeight() / 2;
-			}
-			else if ( dir == Dir_WEST )
+			// Size the room to the free space before creating it
+			if ( FitRoomToDoor( *tmpl, doorX, doorY, dir, w, h ) )
 			{
-				rx = doorX + 1;
-				ry = doorY - newRoom->GetHeight() / 2;
-			}
+				int rx, ry;
+				GetRoomLocationForDoor( doorX, doorY, dir, w, h, rx, ry );
 
-			if ( CanRoomFitHere( rx, ry, newRoom->GetWidth(), newRoom->GetHeight(), newRoom->GetTileAt( 0, 0 ).z ) )
-			{
-				float z = GetTileAt( doorX, doorY ).z;
-				float r = (float) RNG::RandomUnit();
-				if ( r <= mVerticalChance )
-				{
-					float up = mVerticalBiasUp - r;
-					float down = mVerticalBiasDown - r;
-					if ( up > down && mVerticalBiasUp != 0.0f )
-						z += 1.0f;
-					else if ( mVerticalBiasDown != 0.0f )
-						z -= 1.0f;
-				}
+				Room* newRoom = new Room();
+				GenerateRoom( *newRoom, tmpl, w, h );
+
+				const float z = GetAdjoiningRoomZ( GetTileAt( doorX, doorY ).z );
 				AddRoom( *newRoom, rx, ry, z );
-				ConnectRooms( doorX, doorY, dir );
-				mRooms.push_back( newRoom );
-			}
-			else
-			{
-				delete newRoom;
+				if ( ConnectRooms( doorX, doorY, dir ) )
+					++mDoorsPlaced;
 			}
 		}
 	}
 
-	GatherDoors();
-
-	// Find a starting location
-	PlaceEntrance();
-	
-	// Figure out a critical path through the level
-	CalculateSectors();
-
-	// Find an ending location
-	PlaceExit();
-
-	// Generate objects and world geometry to spawn
-	GenerateSpawnData();
-
+	mTimings.mPlacementStop = GenerationTimings::Stop_ATTEMPTS;
+	return true;
+}
+//---------------------------------------
+float DungeonGenerator::GetAdjoiningRoomZ( float z )
+{
+	float r = mRNG.RandomUnit();
+	if ( r <= mVerticalChance )
+	{
+		float up = mVerticalBiasUp - r;
+		float down = mVerticalBiasDown - r;
+		if ( up > down && mVerticalBiasUp != 0.0f )
+			z += 1.0f;
+		else if ( mVerticalBiasDown != 0.0f )
+			z -= 1.0f;
+	}
+	return z;
+}
+//---------------------------------------
+void DungeonGenerator::FinishGenerate( double finishedAt )
+{
 	// Clear temp cached data
-	mDoors.clear();
-	mSectorsToVisit.clear();
+	// mDoors is kept until the next Clear() for the door distance field
 	mOrderOfVisitation.clear();
+
+	// Costs vary from floor to floor so let the estimate rise at once and fall slowly
+	const double finishPerRoom = ( finishedAt - mPlacedAt ) / std::max( (int) mRooms.size(), 1 );
+	mFinishEstimate = std::max( finishPerRoom, mFinishEstimate * 0.75 );
+
+	const bool hasTarget = mBudget.mRoomCount > 0 || mBudget.mFillRatio > 0 || mBudget.mMinSectorCount > 0;
+	mTimings.mSectorCount = mSectorGraph.GetSectorCount();
+	mTimings.mTargetMet = hasTarget && IsTargetMet( mBudget, mDoorsPlaced ) && mTimings.mSectorCount >= mBudget.mMinSectorCount;
+	mTimings.mWithinBudget = mBudget.mMilliseconds <= 0 || finishedAt <= mBudget.mMilliseconds;
+}
+//---------------------------------------
+bool DungeonGenerator::IsTargetMet( const GenerationBudget& budget, int doorsPlaced ) const
+{
+	if ( budget.mRoomCount > 0 && (int) mRooms.size() < budget.mRoomCount )
+		return false;
+	if ( budget.mFillRatio > 0 && mRoomArea < budget.mFillRatio * mWidth * mHeight )
+		return false;
+	// Every locked door splits off a sector, assume SetDoorLockChance() of them will be
+	if ( budget.mMinSectorCount > 0 && 1 + doorsPlaced * mChanceToLock < budget.mMinSectorCount )
+		return false;
+	return true;
 }
 //---------------------------------------
 std::string DungeonGenerator::ToText()
@@ -1309,7 +1779,17 @@ std::string DungeonGenerator::ToText()
 	return level;
 }
 //---------------------------------------
-void DungeonGenerator::GenerateRoom( Room& room )
+void DungeonGenerator::SetRoomTemplates( const std::vector< RoomTemplate* >& templates, const RuleState& ruleState )
+{
+	mRoomTemplates = templates;
+	mRuleState = ruleState;
+
+	// The dummy template is this generator's own, its slots go after the shared ones
+	mDummyRoomTmpl.ReleaseAllState();
+	mDummyRoomTmpl.CompileAllRules( mRuleState );
+}
+//---------------------------------------
+RoomTemplate* DungeonGenerator::GetValidRoomTemplate()
 {
 	RoomTemplate* tmpl = 0;
 
@@ -1317,7 +1797,7 @@ void DungeonGenerator::GenerateRoom( Room& room )
 	for ( auto itr = mRoomTemplates.begin(); itr != mRoomTemplates.end(); ++itr )
 	{
 		RoomTemplate* roomTmpl = *itr;
-		if ( roomTmpl->ValidateRules( &Tile::NULL_TILE ) )
+		if ( roomTmpl->ValidateRules( &Tile::NULL_TILE, *this, mRuleState ) )
 		{
 			tmpl = roomTmpl;
 			break;
@@ -1331,22 +1811,106 @@ void DungeonGenerator::GenerateRoom( Room& room )
 		tmpl = &mDummyRoomTmpl;
 	}
 
-	int minSizeX = mMinRoomSizeX;
-	int maxSizeX = mMaxRoomSizeX;
-	int minSizeY = mMinRoomSizeY;
-	int maxSizeY = mMaxRoomSizeY;
+	return tmpl;
+}
+//---------------------------------------
+void DungeonGenerator::GetRoomSizeRange( const RoomTemplate& tmpl, int& minSizeX, int& maxSizeX, int& minSizeY, int& maxSizeY ) const
+{
+	minSizeX = mMinRoomSizeX;
+	maxSizeX = mMaxRoomSizeX;
+	minSizeY = mMinRoomSizeY;
+	maxSizeY = mMaxRoomSizeY;
+
+	if ( tmpl.mMinRoomSizeX > 0 )
+		minSizeX = tmpl.mMinRoomSizeX;
+	if ( tmpl.mMaxRoomSizeX > 0 )
+		maxSizeX = tmpl.mMaxRoomSizeX;
+	if ( tmpl.mMinRoomSizeY > 0 )
+		minSizeY = tmpl.mMinRoomSizeY;
+	if ( tmpl.mMaxRoomSizeY > 0 )
+		maxSizeY = tmpl.mMaxRoomSizeY;
+}
+//---------------------------------------
+void DungeonGenerator::GetRoomLocationForDoor( int doorX, int doorY, int dir, int w, int h, int& rx, int& ry ) const
+{
+	rx = doorX;
+	ry = doorY;
+
+	if ( dir == Dir_NORTH )
+	{
+		rx = doorX - w / 2;
+		ry = doorY - h;
+	}
+	else if ( dir == Dir_SOUTH )
+	{
+		rx = doorX - w / 2;
+		ry = doorY + 1;
+	}
+	else if ( dir == Dir_EAST )
+	{
+		rx = doorX - w;
+		ry = doorY - h / 2;
+	}
+	else if ( dir == Dir_WEST )
+	{
+		rx = doorX + 1;
+		ry = doorY - h / 2;
+	}
+}
+//---------------------------------------
+bool DungeonGenerator::FitRoomToDoor( const RoomTemplate& tmpl, int doorX, int doorY, int dir, int& w, int& h )
+{
+	int minSizeX, maxSizeX, minSizeY, maxSizeY;
+	GetRoomSizeRange( tmpl, minSizeX, maxSizeX, minSizeY, maxSizeY );
+
+	w = mRNG.RandomInRange( minSizeX, maxSizeX );
+	h = mRNG.RandomInRange( minSizeY, maxSizeY );
+
+	int rx, ry;
+
+	// Even the smallest room will not fit
+	GetRoomLocationForDoor( doorX, doorY, dir, minSizeX, minSizeY, rx, ry );
+	if ( !CanRoomFitHere( rx, ry, minSizeX, minSizeY ) )
+		return false;
+
+	GetRoomLocationForDoor( doorX, doorY, dir, w, h, rx, ry );
+	if ( CanRoomFitHere( rx, ry, w, h ) )
+		return true;
+
+	// Rooms grow away from the door and outward from its center so a room
+	// that fits stays fitting as it shrinks. That makes it safe to binary search
+	// for the largest width at the min height, then the largest height at that width.
+	int lo = minSizeX;
+	int hi = w;
+	while ( lo < hi )
+	{
+		const int mid = ( lo + hi + 1 ) / 2;
+		GetRoomLocationForDoor( doorX, doorY, dir, mid, minSizeY, rx, ry );
+		if ( CanRoomFitHere( rx, ry, mid, minSizeY ) )
+			lo = mid;
+		else
+			hi = mid - 1;
+	}
+	w = lo;
 
-	if ( tmpl->mMinRoomSizeX > 0 )
-		minSizeX = tmpl->mMinRoomSizeX;
-	if ( tmpl->mMaxRoomSizeX > 0 )
-		maxSizeX = tmpl->mMaxRoomSizeX;
-	if ( tmpl->mMinRoomSizeY > 0 )
-		minSizeY = tmpl->mMinRoomSizeY;
-	if ( tmpl->mMaxRoomSizeY > 0 )
-		maxSizeY = tmpl->mMaxRoomSizeY;
+	lo = minSizeY;
+	hi = h;
+	while ( lo < hi )
+	{
+		const int mid = ( lo + hi + 1 ) / 2;
+		GetRoomLocationForDoor( doorX, doorY, dir, w, mid, rx, ry );
+		if ( CanRoomFitHere( rx, ry, w, mid ) )
+			lo = mid;
+		else
+			hi = mid - 1;
+	}
+	h = lo;
 
-	int w = RNG::RandomInRange( minSizeX, maxSizeX );
-	int h = RNG::RandomInRange( minSizeY, maxSizeY );
+	return true;
+}
+//---------------------------------------
+void DungeonGenerator::GenerateRoom( Room& room, RoomTemplate* tmpl, int w, int h )
+{
 	room.Resize( w, h );
 	room.mTemplate = tmpl;
 
@@ -1398,11 +1962,60 @@ void DungeonGenerator::GenerateRoom( Room& room )
 	}
 }
 //---------------------------------------
+void DungeonGenerator::AddEdgeExits( const Room& firstRoom )
+{
+	// The first room is centered so it covers the middle row and column
+	const int midX = mWidth / 2;
+	const int midY = mHeight / 2;
+
+	struct EdgeExit
+	{
+		int mEdge;
+		int mDoorX, mDoorY, mDir;
+		int mLength;			// Distance from the first room to the edge
+		int mOpenX, mOpenY;		// Tile on the edge left open
+	};
+	const EdgeExit exits[] =
+	{
+		{ Edge_NORTH, midX, firstRoom.y, Dir_NORTH, firstRoom.y, midX, 0 },
+		{ Edge_SOUTH, midX, firstRoom.y + firstRoom.GetHeight() - 1, Dir_SOUTH, mHeight - firstRoom.y - firstRoom.GetHeight(), midX, mHeight - 1 },
+		{ Edge_WEST, firstRoom.x, midY, Dir_EAST, firstRoom.x, 0, midY },
+		{ Edge_EAST, firstRoom.x + firstRoom.GetWidth() - 1, midY, Dir_WEST, mWidth - firstRoom.x - firstRoom.GetWidth(), mWidth - 1, midY },
+	};
+
+	for ( int i = 0; i < 4; ++i )
+	{
+		const EdgeExit& exit = exits[i];
+
+		// Need room for two walls and a floor
+		if ( !( mEdgeExits & exit.mEdge ) || exit.mLength < 3 )
+			continue;
+
+		// 3 wide corridors
+		const bool vertical = exit.mDir == Dir_NORTH || exit.mDir == Dir_SOUTH;
+		const int w = vertical ? 3 : exit.mLength;
+		const int h = vertical ? exit.mLength : 3;
+		int rx, ry;
+		GetRoomLocationForDoor( exit.mDoorX, exit.mDoorY, exit.mDir, w, h, rx, ry );
+		if ( !CanRoomFitHere( rx, ry, w, h ) )
+			continue;
+
+		Room* corridor = new Room();
+		GenerateRoom( *corridor, GetValidRoomTemplate(), w, h );
+		AddRoom( *corridor, rx, ry, 0 );
+		ConnectRooms( exit.mDoorX, exit.mDoorY, exit.mDir );
+
+		SetTileAt( exit.mOpenX, exit.mOpenY, Tile::Tile_FLOOR );
+		GetTileAt( exit.mOpenX, exit.mOpenY ).mBlockObjectSpawn = true;
+	}
+}
+//---------------------------------------
 void DungeonGenerator::AddRoom( Room& room, int x, int y, float z )
 {
 	room.x = x;
 	room.y = y;
-	room.mTemplate->NotifySuccess();
+	room.mTemplate->NotifySuccess( mRuleState );
+	mFreeSpace.Occupy( x, y, room.GetWidth(), room.GetHeight() );
 
 	int rx = 0;
 	int ry = 0;
@@ -1418,27 +2031,60 @@ void DungeonGenerator::AddRoom( Room& room, int x, int y, float z )
 		rx = 0;
 		++ry;
 	}
+
+	room.mIndex = (int) mRooms.size();
+	mRooms.push_back( &room );
+	mRoomArea += room.GetWidth() * room.GetHeight();
+	InvalidateDistanceFields();
+	mRoomConnectionsBuilt = false;
+
+	// The room's own walls and any neighboring walls it now blocks
+	const int w = room.GetWidth();
+	const int h = room.GetHeight();
+	UpdateDoorCandidates( x - 1, y - 1, w + 2, 2 );
+	UpdateDoorCandidates( x - 1, y + h - 1, w + 2, 2 );
+	UpdateDoorCandidates( x - 1, y + 1, 2, h - 2 );
+	UpdateDoorCandidates( x + w - 1, y + 1, 2, h - 2 );
 }
 //---------------------------------------
 void DungeonGenerator::Clear()
+{
+	ClearTiles( 0, mWidth * mHeight );
+	ClearFloorData();
+}
+//---------------------------------------
+void DungeonGenerator::ClearTiles( int begin, int end )
 {
 	// Fill map with empty tiles
-	for ( int y = 0; y < mHeight; ++y )
-	{
-		for ( int x = 0; x < mWidth; ++x )	
-		{
-			mTiles[ x * mHeight + y ] = Tile();
-		}
-	}
+	for ( int i = begin; i < end; ++i )
+		mTiles[i] = Tile();
+}
+//---------------------------------------
+void DungeonGenerator::ClearFloorData()
+{
+	mFreeSpace.Resize( mWidth, mHeight );
+	mDoorCandidateSlots.assign( mWidth * mHeight, -1 );
+	mRoomArea = 0;
+	mRoomWeights.Clear();
+	mRoomsWithDoors.Clear();
 
 	mSectorColors.clear();
 	mTilesBySector.clear();
+	mSectorGraph.Clear();
+	mRoomsBySector.clear();
+	mLockPlanner.Clear();
+	mSolvable = false;
+	mKeysToSpawn.clear();
+	mDoors.clear();
+	InvalidateDistanceFields();
+	mRoomConnections.clear();
+	mRoomConnectionsBuilt = false;
 
 	for ( auto itr = mRoomTemplates.begin(); itr != mRoomTemplates.end(); ++itr )
 	{
 		RoomTemplate* tmpl = *itr;
-		tmpl->ResetRules();
-		tmpl->ResetObjects();
+		tmpl->ResetRules( mRuleState );
+		tmpl->ResetObjects( mRuleState );
 	}
 
 	for ( auto itr = mRooms.begin(); itr != mRooms.end(); ++itr )
@@ -1467,7 +2113,7 @@ void DungeonGenerator::PlaceEntrance()
 	}
 	else
 	{
-		std::random_shuffle( possibleStarts.begin(), possibleStarts.end() );
+		mRNG.Shuffle( possibleStarts.begin(), possibleStarts.end() );
 		entranceRoom = possibleStarts.front();
 
 		glm::vec3 pos( entranceRoom->x + entranceRoom->GetWidth() / 2.0f, 1.0f, entranceRoom->y + entranceRoom->GetHeight() / 2.0f );
@@ -1475,11 +2121,13 @@ void DungeonGenerator::PlaceEntrance()
 		t.mType = Tile::Tile_ENTRANCE;
 		pos.y = t.z;
 		mEntranceLocation = pos;
+		mDistanceFields[ DistanceField_ENTRANCE ].Invalidate();
 	}
 }
 //---------------------------------------
 void DungeonGenerator::PlaceExit()
 {
+	mDistanceFields[ DistanceField_EXIT ].Invalidate();
 	bool placedExit = false;
 	for ( auto itr = mOrderOfVisitation.rbegin(); itr != mOrderOfVisitation.rend(); ++itr )
 	{
@@ -1487,7 +2135,7 @@ void DungeonGenerator::PlaceExit()
 		const Room* exitRoom = GetRoomBySectorId( exitSector );
 		if ( exitRoom && exitRoom->mTemplate->HasStyleForUsage( Tile::Tile_EXIT ) )
 		{
-			Tile& t = *mTilesBySector[ exitSector ][ RNG::RandomIndex( mTilesBySector[ exitSector ].size() ) ];
+			Tile& t = *mTilesBySector[ exitSector ][ mRNG.RandomIndex( (unsigned) mTilesBySector[ exitSector ].size() ) ];
 			t.mType = Tile::Tile_EXIT;
 			mExitLocation = glm::vec3( t.x, t.z, t.y );
 			placedExit = true;
@@ -1501,39 +2149,31 @@ void DungeonGenerator::PlaceExit()
 
 		const int exitSector = mOrderOfVisitation.front();
 		const Room* exitRoom = GetRoomBySectorId( exitSector );
-		Tile& t = *mTilesBySector[ exitSector ][ RNG::RandomIndex( mTilesBySector[ exitSector ].size() ) ];
+		Tile& t = *mTilesBySector[ exitSector ][ mRNG.RandomIndex( (unsigned) mTilesBySector[ exitSector ].size() ) ];
 		t.mType = Tile::Tile_EXIT;
 		mExitLocation = glm::vec3( t.x, t.z, t.y );
 	}
 }
 //---------------------------------------
-void DungeonGenerator::GetDoorLocation( int& x, int& y )
+bool DungeonGenerator::GetDoorLocation( int& x, int& y )
 {
-	WeightedRandom< int > randRoom;
-	for ( size_t i = 0; i < mRooms.size(); ++i )
-	{
-		float weight = abs( mRooms[i]->x ) * mDirectionBias[0] + abs( mRooms[i]->y ) * mDirectionBias[1];
-		randRoom.Add( i, weight );
-	}
+	int index = mRoomWeights.Evaluate( mRNG );
+
+	// No direction bias, every room is as likely
+	if ( index < 0 )
+		index = mRoomsWithDoors.Evaluate( mRNG );
+
+	if ( index < 0 )
+		return false;
 
-	int index;
-	if ( randRoom.GetTotalWeight() == 0 )
-		index = RNG::RandomInRange( 0U, mRooms.size() - 1 );
-	else
-		index = randRoom.Evaluate();
 	const Room& room = *mRooms[ index ];
-	const int n = room.GetWidth() * room.GetHeight();
-	for ( int i = 0; i < n; ++i )
-	{
-		x = RNG::RandomInRange( room.x, room.x + room.GetWidth() );
-		y = RNG::RandomInRange( room.y, room.y + room.GetHeight() );
-		
-		if ( GetTileAt( x, y ).mType > Tile::Tile_WALL )
-			break;
-	}
+	const int tileIndex = room.mDoorCandidates[ mRNG.RandomIndex( (unsigned) room.mDoorCandidates.size() ) ];
+	x = tileIndex / mHeight;
+	y = tileIndex % mHeight;
+	return true;
 }
 //---------------------------------------
-int DungeonGenerator::GetDoorDirection( int x, int y )
+int DungeonGenerator::GetDoorDirection( int x, int y ) const
 {
 	int dir = Dir_INVALID;
 	const int tileType = GetTileAt( x, y ).mType;
@@ -1548,23 +2188,94 @@ int DungeonGenerator::GetDoorDirection( int x, int y )
 	return dir;
 }
 //---------------------------------------
-bool DungeonGenerator::CanRoomFitHere( int px, int py, int w, int h, float z )
+bool DungeonGenerator::IsDoorCandidate( int x, int y ) const
+{
+	if ( x < 0 || x >= mWidth || y < 0 || y >= mHeight )
+		return false;
+
+	const int dir = GetDoorDirection( x, y );
+	if ( dir == Dir_INVALID )
+		return false;
+
+	// The tile just outside the wall must be free for a room to grow there
+	int ox = x, oy = y;
+	if ( dir == Dir_NORTH )
+		--oy;
+	else if ( dir == Dir_SOUTH )
+		++oy;
+	else if ( dir == Dir_EAST )
+		--ox;
+	else if ( dir == Dir_WEST )
+		++ox;
+
+	return mFreeSpace.IsFree( ox, oy, 1, 1 );
+}
+//---------------------------------------
+void DungeonGenerator::UpdateDoorCandidates( int x, int y, int w, int h )
 {
-	for ( int y = py; y < py + h; ++y )
+	const int minX = std::max( x, 0 );
+	const int minY = std::max( y, 0 );
+	const int maxX = std::min( x + w, mWidth );
+	const int maxY = std::min( y + h, mHeight );
+
+	for ( int gx = minX; gx < maxX; ++gx )
 	{
-		for ( int x = px; x < px + w; ++x )
+		for ( int gy = minY; gy < maxY; ++gy )
 		{
-			if ( x < 0 || x >= mWidth || y < 0 || y >= mHeight )
-				return false;
-			if ( /*GetTileAt( x, y ).z == z &&*/ GetTileAt( x, y ).mType != Tile::Tile_NONE )
-				return false;
+			Room* room = GetTileAt( gx, gy ).mRoom;
+			if ( !room )
+				continue;
+
+			const int tileIndex = gx * mHeight + gy;
+			int& slot = mDoorCandidateSlots[ tileIndex ];
+			const bool isCandidate = IsDoorCandidate( gx, gy );
+
+			if ( isCandidate && slot < 0 )
+			{
+				slot = (int) room->mDoorCandidates.size();
+				room->mDoorCandidates.push_back( tileIndex );
+				if ( slot == 0 )
+					UpdateRoomWeight( *room );
+			}
+			else if ( !isCandidate && slot >= 0 )
+			{
+				// Swap with the last candidate so removal is O(1)
+				const int last = room->mDoorCandidates.back();
+				room->mDoorCandidates[ slot ] = last;
+				mDoorCandidateSlots[ last ] = slot;
+				room->mDoorCandidates.pop_back();
+				slot = -1;
+				if ( room->mDoorCandidates.empty() )
+					UpdateRoomWeight( *room );
+			}
 		}
 	}
-	return true;
 }
 //---------------------------------------
-void DungeonGenerator::ConnectRooms( int doorX, int doorY, int dir )
+void DungeonGenerator::UpdateRoomWeight( const Room& room )
 {
+	if ( room.mDoorCandidates.empty() )
+	{
+		mRoomWeights.Set( room.mIndex, 0 );
+		mRoomsWithDoors.Set( room.mIndex, 0 );
+	}
+	else
+	{
+		mRoomWeights.Set( room.mIndex, abs( room.x ) * mDirectionBias[0] + abs( room.y ) * mDirectionBias[1] );
+		mRoomsWithDoors.Set( room.mIndex, 1 );
+	}
+}
+//---------------------------------------
+bool DungeonGenerator::CanRoomFitHere( int px, int py, int w, int h ) const
+{
+	return mFreeSpace.IsFree( px, py, w, h );
+}
+//---------------------------------------
+bool DungeonGenerator::ConnectRooms( int doorX, int doorY, int dir )
+{
+	InvalidateDistanceFields();
+	mRoomConnectionsBuilt = false;
+	bool placedDoor = false;
 	SetTileAt( doorX, doorY, Tile::Tile_FLOOR );
 
 	if ( dir == Dir_NORTH )
@@ -1585,6 +2296,7 @@ void DungeonGenerator::ConnectRooms( int doorX, int doorY, int dir )
 			if ( GetTileAt( doorX, doorY - 1 ).mRoomTemplate->HasStyleForUsage( Tile::Tile_DOOR ) && RandomPercentCheck( mDoorChance ) )
 			{
 				SetTileAt( doorX, doorY - 1, Tile::Tile_DOOR_NORTH );
+				placedDoor = true;
 			}
 			else
 				SetTileAt( doorX, doorY - 1, Tile::Tile_FLOOR );
@@ -1628,6 +2340,7 @@ void DungeonGenerator::ConnectRooms( int doorX, int doorY, int dir )
 			if ( GetTileAt( doorX, doorY + 1 ).mRoomTemplate->HasStyleForUsage( Tile::Tile_DOOR ) && RandomPercentCheck( mDoorChance ) )
 			{
 				SetTileAt( doorX, doorY + 1, Tile::Tile_DOOR_SOUTH );
+				placedDoor = true;
 			}
 			else
 				SetTileAt( doorX, doorY + 1, Tile::Tile_FLOOR );
@@ -1671,6 +2384,7 @@ void DungeonGenerator::ConnectRooms( int doorX, int doorY, int dir )
 			if ( GetTileAt( doorX + 1, doorY ).mRoomTemplate->HasStyleForUsage( Tile::Tile_DOOR ) && RandomPercentCheck( mDoorChance ) )
 			{
 				SetTileAt( doorX + 1, doorY, Tile::Tile_DOOR_WEST );
+				placedDoor = true;
 			}
 			else
 				SetTileAt( doorX + 1, doorY, Tile::Tile_FLOOR );
@@ -1714,6 +2428,7 @@ void DungeonGenerator::ConnectRooms( int doorX, int doorY, int dir )
 			if ( GetTileAt( doorX - 1, doorY ).mRoomTemplate->HasStyleForUsage( Tile::Tile_DOOR ) && RandomPercentCheck( mDoorChance ) )
 			{
 				SetTileAt( doorX - 1, doorY, Tile::Tile_DOOR_EAST );
+				placedDoor = true;
 			}
 			else
 				SetTileAt( doorX - 1, doorY, Tile::Tile_FLOOR );
@@ -1739,478 +2454,536 @@ void DungeonGenerator::ConnectRooms( int doorX, int doorY, int dir )
 		else
 			SetTileAt( doorX, doorY + 1, Tile::Tile_WALL_NORTH );
 	}
+
+	// Walls around the door changed type
+	UpdateDoorCandidates( doorX - 2, doorY - 2, 5, 5 );
+	return placedDoor;
 }
 //---------------------------------------
-void DungeonGenerator::GenerateSpawnData()
+void DungeonGenerator::GenerateRoomSpawnData( Room& r, bool pickDoors )
 {
-	for ( auto itr = mRooms.begin(); itr != mRooms.end(); ++itr )
+	Tile& t0 = GetTileAt( r.x, r.y );
+	if ( t0.mRoomTemplate )
+		t0.mRoomTemplate->ResetRules( mRuleState );
+
+	std::vector< Tile* > roomTiles;
+
+	for ( int y = r.y; y < r.y + r.GetHeight(); ++y )
 	{
-		Room& r = **itr;
-		Tile& t0 = GetTileAt( r.x, r.y );
-		if ( t0.mRoomTemplate )
-			t0.mRoomTemplate->ResetRules();
+		for ( int x = r.x; x < r.x + r.GetWidth(); ++x )
+		{
+			roomTiles.push_back( &GetTileAt( x, y ) );
+		}
+	}
 
-		std::vector< Tile* > roomTiles;
+	// Shuffle the tiles of the room to remove left-to-right top-to-bottom bias
+	mSpawnRNG.Shuffle( roomTiles.begin(), roomTiles.end() );
 
-		for ( int y = r.y; y < r.y + r.GetHeight(); ++y )
+	// Rules of the room's tiles look up what the room holds from here
+	r.mOccupancy.Build( *this, r );
+
+	// Skip the useables that can not pass on a tile without running them
+	// The tiles are still visited in shuffled order, rules see what was placed
+	// before them and the random numbers drawn must not change
+	const CandidateMasks* masks = 0;
+	if ( t0.mRoomTemplate && RuledObject::IsUsingCompiledRules() )
+	{
+		t0.mRoomTemplate->BuildCandidates( mCandidates, *this, mRuleState, r );
+		masks = &mCandidates;
+	}
+
+	// Get world geometry and objects to spawn
+	mGeneratingSpawns = true;
+	for ( auto tile = roomTiles.begin(); tile != roomTiles.end(); ++tile )
+	{
+		Tile& t = **tile;
+		if ( t.mRoomTemplate )
 		{
-			for ( int x = r.x; x < r.x + r.GetWidth(); ++x )
+			const CandidateMasks* tileMasks = t.mRoomTemplate == t0.mRoomTemplate ? masks : 0;
+			TileStyle* style = t.mRoomTemplate->GetStyle( &t, *this, mRuleState, tileMasks );
+			r.mOccupancy.ChangeStyle( t.x, t.y, t.mStyle, style );
+			t.mStyle = style;
+			if ( !t.mBlockObjectSpawn )
 			{
-				roomTiles.push_back( &GetTileAt( x, y ) );
+				TileObject* obj = t.mRoomTemplate->GetObject( &t, *this, mRuleState, tileMasks );
+				r.mOccupancy.ChangeObject( t.x, t.y, t.mObject, obj );
+				t.mObject = obj;
+
+				// Spawners pick what they spawn now so the manifest says exactly what appears
+				t.mObjectVariant = -1;
+				if ( obj && obj->mUsageId == TileObject::Usage_SPAWNER )
+					t.mObjectVariant = ( (TileObject_Spawner*) obj )->GetRandomVariant( mSpawnRNG );
 			}
 		}
+	}
 
-		// Shuffle the tiles of the room to remove left-to-right top-to-bottom bias
-		std::random_shuffle( roomTiles.begin(), roomTiles.end() );
+	// Doors go in after the room is filled so their rules see everything in it
+	for ( int x = r.x; pickDoors && x < r.x + r.GetWidth(); ++x )
+	{
+		for ( int y = r.y; y < r.y + r.GetHeight(); ++y )
+		{
+			Tile& t = GetTileAt( x, y );
+			if ( !t.mRoomTemplate || t.GetUsageId() != Tile::Tile_DOOR_FRAME )
+				continue;
 
-		// Get world geometry and objects to spawn
-		for ( auto tile = roomTiles.begin(); tile != roomTiles.end(); ++tile )
+			Tile doorTile( t );
+			doorTile.mType = Tile::Tile_DOOR;
+			t.mDoorStyle = t.mRoomTemplate->GetStyle( &doorTile, *this, mRuleState );
+		}
+	}
+	mGeneratingSpawns = false;
+
+	// Nothing else keeps the lists up to date
+	r.mOccupancy.Invalidate();
+}
+//---------------------------------------
+void DungeonGenerator::ClearRoomSpawnData( Room& room, bool clearDoors )
+{
+	// The useables' own limits are reset when the room is filled again
+	for ( int x = room.x; x < room.x + room.GetWidth(); ++x )
+	{
+		for ( int y = room.y; y < room.y + room.GetHeight(); ++y )
 		{
-			Tile& t = **tile;
-			if ( t.mRoomTemplate )
+			Tile& tile = GetTileAt( x, y );
+			if ( tile.mStyle )
+				tile.mStyle->NotifyRemoved( mRuleState );
+			if ( tile.mObject )
+				tile.mObject->NotifyRemoved( mRuleState );
+			tile.mStyle = 0;
+			tile.mObject = 0;
+			tile.mObjectVariant = -1;
+
+			if ( clearDoors )
 			{
-				t.mStyle = t.mRoomTemplate->GetStyle( &t );
-				if ( !t.mBlockObjectSpawn )
-					t.mObject = t.mRoomTemplate->GetObject( &t );
+				if ( tile.mDoorStyle )
+					tile.mDoorStyle->NotifyRemoved( mRuleState );
+				tile.mDoorStyle = 0;
 			}
 		}
 	}
 }
 //---------------------------------------
-void DungeonGenerator::LockRandomDoors()
+int DungeonGenerator::GetRoomIndexAt( int x, int y ) const
 {
-	for ( auto itr = mDoors.begin(); itr != mDoors.end(); ++itr )
-	{
-		Tile& tile = **itr;
-		tile.mLocked = RandomPercentCheck( mChanceToLock );
-	}
+	const Room* room = GetTileAt( x, y ).mRoom;
+	return room ? room->mIndex : -1;
 }
 //---------------------------------------
-void DungeonGenerator::GatherDoors()
+int DungeonGenerator::GetRoomSectorId( int roomIndex ) const
 {
-	for ( auto itr = mTiles.begin(); itr != mTiles.end(); ++itr )
-	{
-		Tile& t = *itr;
-		if ( t.GetUsageId() == Tile::Tile_DOOR_FRAME )
-			mDoors.push_back( &t );
-	}
+	if ( roomIndex < 0 || roomIndex >= (int) mRooms.size() )
+		return -1;
+	return mRooms[ roomIndex ]->mSectorId;
 }
 //---------------------------------------
-void DungeonGenerator::FloodFill( int x, int y, int initId, int destId )
+bool DungeonGenerator::GetRoomBounds( int roomIndex, int& x, int& y, int& w, int& h ) const
 {
-	Tile& t = GetTileAt( x, y );
-	if (
-		( ( t.mType > Tile::Tile_NONE && t.mType < Tile::Tile_WALL ) ||
-		( t.GetUsageId() == Tile::Tile_DOOR_FRAME && !t.mLocked ) )
-		&& t.mSectorId == initId && initId != destId )
-	{
-		t.mSectorId = destId;
-		t.mRoom->mSectorId = destId;
-
-		mSectorsToVisit.insert( destId );
-		
-		// Debug colors
-		mSectorColors[ destId ] = Color( RNG::RandomUnit(), RNG::RandomUnit(), RNG::RandomUnit() );
-		if ( t.mType == Tile::Tile_FLOOR )
-			mTilesBySector[ destId ].push_back( &t );
-
-		FloodFill( x + 1, y, initId, destId );
-		FloodFill( x - 1, y, initId, destId );
-		FloodFill( x, y + 1, initId, destId );
-		FloodFill( x, y - 1, initId, destId );
-	}
+	if ( roomIndex < 0 || roomIndex >= (int) mRooms.size() )
+		return false;
+	const Room& room = *mRooms[ roomIndex ];
+	x = room.x;
+	y = room.y;
+	w = room.GetWidth();
+	h = room.GetHeight();
+	return true;
 }
 //---------------------------------------
-void DungeonGenerator::CalculateSectors()
+const std::vector< RoomConnection >& DungeonGenerator::GetRoomConnections()
 {
-	// Need to have doors locked before generating connectivity
-	LockRandomDoors();
+	if ( !mRoomConnectionsBuilt )
+		BuildRoomConnections();
+	return mRoomConnections;
+}
+//---------------------------------------
+void DungeonGenerator::BuildRoomConnections()
+{
+	mRoomConnections.clear();
+	mRoomConnectionsBuilt = true;
 
-	// Generate connectivity
-	int nextId = 1;
-	for ( int y = 0; y < mHeight; ++y )
+	// Rooms do not overlap so every opening is on the east or south wall of exactly one of its rooms
+	// Locked doors still connect their rooms
+	auto isOpen = []( const Tile& tile )
 	{
-		for ( int x = 0; x < mWidth; ++x )
-		{
-			Tile& tile = GetTileAt( x, y );
-			if ( tile.mType != Tile::Tile_NONE && tile.mSectorId == 0 )
-			{
-				FloodFill( x, y, 0, nextId++ );
-			}
-		}
-	}
-	DebugPrintf( "Sectors Created: %d\n", mSectorColors.size() );
-
-	// Sector id : connected sector ids
-	std::map< int, std::vector< int > > sectorMapping;
-	std::map< int, Tile* > sectorDoors;
-	// Build mapping of sectors to adjacency lists
-	for ( auto itr = mDoors.begin(); itr != mDoors.end(); ++itr )
+		return SectorGraph::IsWalkable( tile ) || tile.GetUsageId() == Tile::Tile_DOOR_FRAME;
+	};
+	auto connect = [&]( const Room& room, int ax, int ay, int bx, int by )
 	{
-		Tile& tile = **itr;
-		
-		if ( tile.mLocked )
+		const Tile& a = GetTileAt( ax, ay );
+		const Tile& b = GetTileAt( bx, by );
+		if ( !b.mRoom || b.mRoom == &room || !isOpen( a ) || !isOpen( b ) )
+			return;
+		const RoomConnection connection =
 		{
-			int x = tile.x;
-			int y = tile.y;
-			Tile* startTile = 0;
-			Tile* endTile = 0;
-			int startId = 0;
-			int endId = 0;
-			if ( tile.mType == Tile::Tile_DOOR_EAST )
-			{
-				startTile = &GetTileAt( x + 1, y );
-				endTile   = &GetTileAt( x - 1, y );
-			}
-			else if ( tile.mType == Tile::Tile_DOOR_WEST )
-			{
-				startTile = &GetTileAt( x - 1, y );
-				endTile   = &GetTileAt( x + 1, y );
-			}
-			else if ( tile.mType == Tile::Tile_DOOR_NORTH )
-			{
-				startTile = &GetTileAt( x, y + 1 );
-				endTile   = &GetTileAt( x, y - 1 );
-			}
-			else if ( tile.mType == Tile::Tile_DOOR_SOUTH )
-			{
-				startTile = &GetTileAt( x, y - 1 );
-				endTile   = &GetTileAt( x, y + 1 );
-			}
-			startId = startTile->mSectorId;
-			endId = endTile->mSectorId;
-			DebugPrintf( "Connection between %d and %d\n", startId, endId );
-			sectorMapping[ startId ].push_back( endId );
-			sectorMapping[ endId ].push_back( startId );
-			sectorDoors[ startId ] = startTile;
-			sectorDoors[ endId ] = endTile;
-			// Needed so the minimap draws with the correct color
-			tile.mSectorId = startId;
-		}
-	}
+			room.mIndex, b.mRoom->mIndex,
+			ax * mHeight + ay, bx * mHeight + by,
+			a.GetUsageId() == Tile::Tile_DOOR_FRAME || b.GetUsageId() == Tile::Tile_DOOR_FRAME
+		};
+		mRoomConnections.push_back( connection );
+	};
 
-	// Debug
-	DebugPrintf( "Sector Connections Results\n" );
-	for ( auto itr = sectorMapping.begin(); itr != sectorMapping.end(); ++itr )
+	for ( auto itr = mRooms.begin(); itr != mRooms.end(); ++itr )
 	{
-		DebugPrintf( "[%d] :", itr->first );
-		for ( auto jtr = itr->second.begin(); jtr != itr->second.end(); ++jtr )
-		{
-			DebugPrintf( " %d", *jtr );
-			if ( jtr + 1 != itr->second.end() )
-				DebugPrintf( "," );
-		}
-		DebugPrintf( "\n" );
-	}
-
-	std::stack< int > connectionStack;
-	mOrderOfVisitation.clear();
-	Tile& startTile = GetTileAt( (int) ( mEntranceLocation.x ), (int) ( mEntranceLocation.z ) );
-	int startSector = startTile.mSectorId;
-	mOrderOfVisitation.push_back( startSector );
-	int visitIndex = -1;
-	DebugPrintf( "Visit %d\n", startSector );
-	while ( !mSectorsToVisit.empty() )
-	{
-		// Remove sectors we already visited from this sectors adjacency list
-		for ( auto itr = mOrderOfVisitation.begin(); itr != mOrderOfVisitation.end(); ++itr )
-		{
-			std::vector< int >& neighbors = sectorMapping[ startSector ];
-			for ( auto jtr = neighbors.begin(); jtr != neighbors.end(); ++jtr )
-			{
-				if ( *itr == *jtr )
-				{
-					*jtr = -1;
-				}
-			}
-			neighbors.erase(
-			std::remove_if( neighbors.begin(), neighbors.end(), []( int i )
-			{
-				return i == -1;
-			}), neighbors.end() );
-		}
-
-		// Still more adjacent sectors to visit
-		if ( !sectorMapping[ startSector ].empty() )
-		{
-			// Get random connection
-			int index = RNG::RandomIndex( sectorMapping[ startSector ].size() );
-			int randomSectorId = sectorMapping[ startSector ][ index ];
-
-			connectionStack.push( startSector );
-
-			// Place key in startSector for randomSectorId
-			int keySpawnSector = mOrderOfVisitation[ visitIndex++ + 1 ];
-			Tile* doorTile = sectorDoors[ randomSectorId ];
-			std::vector< Tile* > tilesByDistance;
-			for ( auto itr = mTilesBySector[ keySpawnSector ].begin(); itr != mTilesBySector[ keySpawnSector ].end(); ++itr )
-			{
-				tilesByDistance.push_back( *itr );
-			}
-			// farthest to nearest
-			std::sort( tilesByDistance.begin(), tilesByDistance.end(), [ &doorTile ]( Tile* A, Tile* B ) -> bool
-			{
-				const int d1 = GetManhattanDistance( doorTile->x, doorTile->y, A->x, A->y );
-				const int d2 = GetManhattanDistance( doorTile->x, doorTile->y, B->x, B->y );
-				return d1 > d2;
-			});
-			unsigned lowerIndex = (unsigned) ( tilesByDistance.size() * 0.1f );
-			Tile* t = tilesByDistance[ RNG::RandomIndex( lowerIndex + 1 ) ];
-			t->mBlockObjectSpawn = true;
-			int keyId = randomSectorId;
-			Key* key = new Key( keyId );
-			const Key::KeyStyle& keyStyle = Key::GetRandomKeyStyle();
-			key->SetKeyStyle( keyStyle );
-			key->SetLocation( glm::vec3( t->x, t->z + 0.5f, t->y ) );
-			key->SetColor( mSectorColors[ randomSectorId ] );
-			mKeysToSpawn[ randomSectorId ] = key;
-			DebugPrintf( "Creating Key to %d in %d\n", randomSectorId, keySpawnSector );
-
-			DebugPrintf( "Visit %d\n", randomSectorId );
-			mOrderOfVisitation.push_back( randomSectorId );
-			
-			// Remove sector from list of sectors to visit
-			auto itr = std::find( mSectorsToVisit.begin(), mSectorsToVisit.end(), startSector );
-			if ( itr != mSectorsToVisit.end() )
-				mSectorsToVisit.erase( itr );
-			sectorMapping[ startSector ].erase( sectorMapping[ startSector ].begin() + index );
-
-			// Same thing starting in the sector we just picked
-			startSector = randomSectorId;
-		}
-		// Backtrack
-		else if ( !connectionStack.empty() )
+		const Room& room = **itr;
+		const int east = room.x + room.GetWidth() - 1;
+		const int south = room.y + room.GetHeight() - 1;
+		if ( east + 1 < mWidth )
 		{
-			startSector = connectionStack.top();
-			connectionStack.pop();
+			for ( int y = room.y; y <= south; ++y )
+				connect( room, east, y, east + 1, y );
 		}
-		// Dead end, try to start from a random location
-		else
+		if ( south + 1 < mHeight )
 		{
-			int index = RNG::RandomIndex( mSectorsToVisit.size() );
-			auto itr = mSectorsToVisit.begin();
-			std::advance( itr, index );
-			startSector = *itr;
-
-			mSectorsToVisit.erase( itr );
-			mOrderOfVisitation.push_back( startSector );
+			for ( int x = room.x; x <= east; ++x )
+				connect( room, x, south, x, south + 1 );
 		}
 	}
 }
 //---------------------------------------
-void DungeonGenerator::Draw( Window* window )
+bool DungeonGenerator::RerollRoom( int roomIndex )
 {
-	// Debug
-	if ( DebugSectors )
-	{
-		for ( auto itr = mTilesBySector.begin(); itr != mTilesBySector.end(); ++itr )
-		{
-			Texture2D::Unbind();
-			window->SetDrawColor( mSectorColors[ itr->first ] );
-			for ( auto jtr = itr->second.begin(); jtr != itr->second.end(); ++jtr )
-			{
-				Tile* t = *jtr;
-				window->DrawQuad( (float) t->x, (float) t->y, t->z + 0.005f, 1.0f, 1.0f );
-			}
-		}
+	if ( roomIndex < 0 || roomIndex >= (int) mRooms.size() )
+		return false;
 
-		// Critical path debug
-		float x = 0.0f, y = 220.0f;
-		for ( auto itr = mSectorColors.begin(); itr != mSectorColors.end(); ++itr )
-		{
-			window->DrawDebugTextFmt( x, y, itr->second, "%d", itr->first );
-			y += 24.0f;
-		}
-		for ( auto itr = mOrderOfVisitation.begin(); itr != mOrderOfVisitation.end(); ++itr )
+	// Tiles, doors and sectors stay as they are, only styles and objects are picked again
+	// The door entities are not spawned by the room, so their styles are kept too
+	Room& room = *mRooms[ roomIndex ];
+	ClearRoomSpawnData( room, false );
+	GenerateRoomSpawnData( room, false );
+	return true;
+}
+//---------------------------------------
+int DungeonGenerator::RerollSector( int sectorId )
+{
+	int count = 0;
+	for ( size_t i = 0; i < mRooms.size(); ++i )
+	{
+		if ( mRooms[i]->mSectorId == sectorId )
 		{
-			window->DrawDebugTextFmt( x, y, mSectorColors[ *itr ], "%d ", *itr );
-			x += 48.0f;
+			RerollRoom( (int) i );
+			++count;
 		}
 	}
+	return count;
 }
 //---------------------------------------
-void DungeonGenerator::SpawnEntities( Game* world )
+void DungeonGenerator::RerollSpawns( uint64_t seed )
 {
-	int startSector;
-	int endSector;
+	mSpawnRNG = RNG( seed ).Split( SPAWN_RNG_STREAM );
+
+	// Rules look at the tiles around them, which a new floor has not picked anything for yet
+	for ( auto itr = mRooms.begin(); itr != mRooms.end(); ++itr )
+		ClearRoomSpawnData( **itr, true );
 
-	startSector = GetTileAt( (int)( mEntranceLocation.x + 1 ), (int) ( mEntranceLocation.z ) ).mSectorId;
-	endSector = GetTileAt( (int) ( mExitLocation.x + 1 ), (int) ( mExitLocation.z ) ).mSectorId;
+	// Rules start over as they do for a new floor
+	for ( auto itr = mRoomTemplates.begin(); itr != mRoomTemplates.end(); ++itr )
+	{
+		( *itr )->ResetRules( mRuleState );
+		( *itr )->ResetObjects( mRuleState );
+	}
 
+	for ( auto itr = mRooms.begin(); itr != mRooms.end(); ++itr )
+		GenerateRoomSpawnData( **itr );
+}
+//---------------------------------------
+void DungeonGenerator::BuildSpawnManifest( SpawnManifest& manifest ) const
+{
+	manifest.Clear();
+
+	const int startSector = GetTileAt( (int)( mEntranceLocation.x + 1 ), (int) ( mEntranceLocation.z ) ).mSectorId;
+	const int endSector = GetTileAt( (int) ( mExitLocation.x + 1 ), (int) ( mExitLocation.z ) ).mSectorId;
 	DebugPrintf( "Spawn: Starting in %d\n", startSector );
 	DebugPrintf( "Spawn: Ending in %d\n", endSector );
 
+	// The keys placed by CalculateSectors(), by key id
+	std::map< int, int > keys;
 	for ( auto itr = mKeysToSpawn.begin(); itr != mKeysToSpawn.end(); ++itr )
 	{
-		world->AddEntity( itr->second );
+		keys[ itr->first ] = (int) manifest.mKeys.size();
+		manifest.mKeys.push_back( itr->second );
 	}
 
-	for ( int y = 0; y < mHeight; ++y )
+	// Only tiles of rooms have a template to spawn anything from
+	// so the rooms are visited rather than the whole grid, in tile order
+	std::vector< int > roomTiles;
+	for ( auto itr = mRooms.begin(); itr != mRooms.end(); ++itr )
 	{
-		for ( int x = 0; x < mWidth; ++x )	
+		const Room& room = **itr;
+		for ( int x = room.x; x < room.x + room.GetWidth(); ++x )
+			for ( int y = room.y; y < room.y + room.GetHeight(); ++y )
+				roomTiles.push_back( x * mHeight + y );
+	}
+	std::sort( roomTiles.begin(), roomTiles.end() );
+
+	for ( auto itr = roomTiles.begin(); itr != roomTiles.end(); ++itr )
+	{
+		const int x = *itr / mHeight;
+		const int y = *itr % mHeight;
+		const Tile& tile = mTiles[ *itr ];
+		AddTileSpawns( manifest, tile, tile.mRoom ? tile.mRoom->mIndex : -1 );
+
+		// Not a door frame, or a room failed to spawn and there was no other option
+		TileStyle* doorStyle = tile.mDoorStyle;
+		if ( tile.GetUsageId() != Tile::Tile_DOOR_FRAME || !doorStyle )
+			continue;
+
+		SpawnManifest::DoorSpawn door;
+		door.x = x;
+		door.y = y;
+		door.mLocation = glm::vec3( x, tile.z, y );
+		door.mOrientation = tile.GetOrientation();
+		door.mLock = SpawnManifest::Lock_NONE;
+		door.mKeyId = 0;
+		door.mKey = -1;
+		door.mColor = Color::WHITE;
+		door.mStyle = manifest.GetStyleId( doorStyle );
+		door.mPad = 0;
+
+		// CalculateSectors() left the id of the key that opens the door in its sector id
+		// Doors no key opens are left open
+		auto keyItr = keys.find( tile.mSectorId );
+		if ( tile.mLocked && keyItr != keys.end() )
 		{
-			Tile& tile = GetTileAt( x, y );
-			const int c = tile.mType;
-			const float z = tile.z;
-			const float cellW = 1.0f;
-			const float cellH = 1.0f;
-
-			if ( tile.mStyle )
+			// The key is kept even if this door can not be locked since other doors may share its id
+			if ( !doorStyle->mCanBeLocked )
 			{
-				MapTile* e = new MapTile( &tile );
-				tile.mStyle->SetupEvents( e );
-				world->AddEntity( e );
+				if ( doorStyle->mForceLocked )
+					door.mLock = SpawnManifest::Lock_FORCED;
 			}
-
-			if ( tile.mObject )
+			else
 			{
-				SpawnTileObject( world, tile, tile.mObject, 0 );
-			}
-
-			if ( tile.GetUsageId() == Tile::Tile_DOOR_FRAME )
-			{
-				Tile doorTile( tile );
-				doorTile.mType = Tile::Tile_DOOR;
-				TileStyle* doorStyle = tile.mRoomTemplate->GetStyle( &doorTile );
-
-				// This will happen if a room failed to spawn and there was no other option
-				if ( !doorStyle )
-					continue;
-
-				Mesh* doorMesh = doorStyle->mMesh;
-				Door* d = new Door( &tile, doorMesh );
-				d->SetLocation( glm::vec3( x, z, y ) );
-				d->SetRotation( glm::vec3( 0, 1.0f, 0 ), glm::radians( tile.GetOrientation() ) );
-				doorStyle->SetupEvents( d );
-	
-				if ( tile.mLocked )
-				{
-					int startId = 0;
-					int endId = 0;
-					if ( tile.mType == Tile::Tile_DOOR_EAST )
-					{
-						startId = GetTileAt( x + 1, y ).mSectorId;
-						endId = GetTileAt( x - 1, y ).mSectorId;
-					}
-					else if ( tile.mType == Tile::Tile_DOOR_WEST )
-					{
-						startId = GetTileAt( x - 1, y ).mSectorId;
-						endId = GetTileAt( x + 1, y ).mSectorId;
-					}
-					else if ( tile.mType == Tile::Tile_DOOR_NORTH )
-					{
-						startId = GetTileAt( x, y + 1 ).mSectorId;
-						endId = GetTileAt( x, y - 1 ).mSectorId;
-					}
-					else if ( tile.mType == Tile::Tile_DOOR_SOUTH )
-					{
-						startId = GetTileAt( x, y - 1 ).mSectorId;
-						endId = GetTileAt( x, y + 1 ).mSectorId;
-					}
-
-					int id = startId;
-					auto itr = mKeysToSpawn.find( endId );
-					if ( itr != mKeysToSpawn.end() )
-						id = endId;
-
-					if ( !doorStyle->mCanBeLocked )
-					{
-						if ( doorStyle->mForceLocked )
-							d->Lock( 0 );
-						mKeysToSpawn[ id ]->Destroy();
-					}
-					else
-					{
-						d->Lock( id );
-						d->SetColor( mSectorColors[ id ] );
-						d->SetKeyName( mKeysToSpawn[ id ]->GetKeyName() );
-					}
-					tile.mSectorId = id;
-				}
-				world->AddEntity( d );
+				door.mLock = SpawnManifest::Lock_KEY;
+				door.mKeyId = tile.mSectorId;
+				door.mKey = keyItr->second;
+				auto colorItr = mSectorColors.find( tile.mSectorId );
+				if ( colorItr != mSectorColors.end() )
+					door.mColor = colorItr->second;
 			}
 		}
+		manifest.mDoors.push_back( door );
 	}
-
-	mKeysToSpawn.clear();
 }
 //---------------------------------------
-bool DungeonGenerator::RandomPercentCheck( float percentToBeTrue ) const
+void DungeonGenerator::BuildRoomSpawnManifest( SpawnManifest& manifest, int roomIndex ) const
 {
-	const float r = RNG::RandomUnit();
-	return percentToBeTrue > 0 && r <= percentToBeTrue ? true : false;
+	manifest.Clear();
+	if ( roomIndex < 0 || roomIndex >= (int) mRooms.size() )
+		return;
+
+	const Room& room = *mRooms[ roomIndex ];
+	for ( int x = room.x; x < room.x + room.GetWidth(); ++x )
+	{
+		for ( int y = room.y; y < room.y + room.GetHeight(); ++y )
+			AddTileSpawns( manifest, GetTileAt( x, y ), roomIndex );
+	}
 }
 //---------------------------------------
-void DungeonGenerator::SpawnTileObject( Game* world, Tile& tile, TileObject* obj, Entity* parent )
+void DungeonGenerator::AddTileSpawns( SpawnManifest& manifest, const Tile& tile, int roomIndex ) const
 {
-	Entity* e = 0;
-	if ( obj->mUsageId == TileObject::Usage_STATIC )
-		e = new MapObject( &tile, obj->mMesh );
-	else if ( obj->mUsageId == TileObject::Usage_PICKUP )
+	if ( tile.mStyle )
 	{
-		TileObject_Pickup* pickup = (TileObject_Pickup*) obj;
-		e = Pickup::CreatePickup( pickup->mPickupName );
-		
-		if ( e )
-		{
-			//if ( obj->mMesh )
-			//	((Pickup*)e)->SetMesh( obj->mMesh );
-			((Pickup*)e)->SetLocation( glm::vec3( tile.x, tile.z, tile.y ) + obj->mLocalSpawnOffset );
-		}
+		const SpawnManifest::TileSpawn spawn = { tile.x, tile.y, roomIndex, manifest.GetStyleId( tile.mStyle ), 0 };
+		manifest.mTiles.push_back( spawn );
 	}
-	else if ( obj->mUsageId == TileObject::Usage_LIGHT )
-	{
-		TileObject_Light* lightObject = (TileObject_Light*) obj;
 
-		PointLight* light = world->CreateLight( lightObject->mLightColor, lightObject->mIntensity, lightObject->mFalloff, lightObject->mRadius );
-		if ( light )
-			light->mPosition = glm::vec3( tile.x, tile.z, tile.y ) + obj->mLocalSpawnOffset;
+	if ( tile.mObject )
+		AddObjectSpawns( manifest, tile, tile.mObject, roomIndex, -1, tile.mObjectVariant );
+}
+//---------------------------------------
+void DungeonGenerator::AddObjectSpawns( SpawnManifest& manifest, const Tile& tile, TileObject* obj, int roomIndex, int parent, int variant ) const
+{
+	SpawnManifest::ObjectSpawn spawn;
+	spawn.x = tile.x;
+	spawn.y = tile.y;
+	spawn.mLocation = glm::vec3( tile.x, tile.z, tile.y ) + obj->mLocalSpawnOffset;
+	spawn.mRoomIndex = roomIndex;
+	spawn.mParent = parent;
+	spawn.mObject = manifest.GetObjectId( obj );
+	spawn.mVariant = obj->mUsageId == TileObject::Usage_SPAWNER ? (int16) variant : -1;
+
+	const int index = (int) manifest.mObjects.size();
+	manifest.mObjects.push_back( spawn );
 
-		e = light;
-	}
-	else if ( obj->mUsageId == TileObject::Usage_ENEMY )
+	if ( obj->mAttachment )
+		AddObjectSpawns( manifest, tile, obj->mAttachment, roomIndex, index, -1 );
+}
+//---------------------------------------
+void DungeonGenerator::LockRandomDoors()
+{
+	for ( auto itr = mDoors.begin(); itr != mDoors.end(); ++itr )
 	{
-		TileObject_Enemy* enemyObject = (TileObject_Enemy*) obj;
-		e = Enemy::CreateEnemy( enemyObject->mEnemyClass );
-		if ( e )
-			((Actor*)e)->SetSpawnLocation( glm::vec3( tile.x, tile.z, tile.y ) + obj->mLocalSpawnOffset );
+		Tile& tile = **itr;
+		tile.mLocked = RandomPercentCheck( mChanceToLock );
 	}
-	else if ( obj->mUsageId == TileObject::Usage_SPAWNER )
+}
+//---------------------------------------
+void DungeonGenerator::GatherDoors()
+{
+	GatherDoors( 0, mWidth * mHeight );
+}
+//---------------------------------------
+void DungeonGenerator::GatherDoors( int begin, int end )
+{
+	for ( int i = begin; i < end; ++i )
 	{
-		TileObject_Spawner* spawner = (TileObject_Spawner*) obj;
-		e = Enemy::CreateEnemy( spawner->GetObjectToSpawn() );
-		if ( e )
-			((Actor*)e)->SetSpawnLocation( glm::vec3( tile.x, tile.z, tile.y ) + obj->mLocalSpawnOffset );
+		Tile& t = mTiles[i];
+		if ( t.GetUsageId() == Tile::Tile_DOOR_FRAME )
+			mDoors.push_back( &t );
 	}
-
-	if ( e )
+}
+//---------------------------------------
+void DungeonGenerator::BuildSectorGraph()
+{
+	// Every walkable tile belongs to a room so only the rooms are scanned
+	std::vector< SectorGraph::Region > regions( mRooms.size() );
+	for ( size_t i = 0; i < mRooms.size(); ++i )
 	{
-		e->SetParent( parent );
-		if ( parent )
-			parent->AddAttachment( e );
-		obj->SetupEvents( e );
-		world->AddEntity( e );
+		const Room& room = *mRooms[i];
+		SectorGraph::Region& region = regions[i];
+		region.x = room.x;
+		region.y = room.y;
+		region.w = room.GetWidth();
+		region.h = room.GetHeight();
 	}
+	mSectorGraph.Build( *this, regions );
 
-	if ( obj->mAttachment )
+	// First room of each sector
+	mRoomsBySector.assign( mSectorGraph.GetSectorCount() + 1, (const Room*) 0 );
+	for ( auto itr = mRooms.begin(); itr != mRooms.end(); ++itr )
 	{
-		SpawnTileObject( world, tile, obj->mAttachment, e );
+		const Room* room = *itr;
+		if ( room->mSectorId > 0 && room->mSectorId < (int) mRoomsBySector.size() && !mRoomsBySector[ room->mSectorId ] )
+			mRoomsBySector[ room->mSectorId ] = room;
 	}
 }
 //---------------------------------------
-const Room* DungeonGenerator::GetRoomBySectorId( int sectorId ) const
+void DungeonGenerator::CalculateSectors()
 {
-	const Room* room = 0;
+	// Need to have doors locked before generating connectivity
+	LockRandomDoors();
+	InvalidateDistanceFields();
 
-	for ( auto itr = mRooms.begin(); itr != mRooms.end(); ++itr )
+	// Generate connectivity
+	BuildSectorGraph();
+	const int sectorCount = mSectorGraph.GetSectorCount();
+	for ( int i = 1; i <= sectorCount; ++i )
 	{
-		if ( (*itr)->mSectorId == sectorId )
+		// Debug colors
+		mSectorColors[i] = Color( mRNG.RandomUnit(), mRNG.RandomUnit(), mRNG.RandomUnit() );
+
+		const int* tiles = mSectorGraph.GetTiles( i );
+		std::vector< Tile* >& floors = mTilesBySector[i];
+		for ( int j = 0; j < mSectorGraph.GetTileCount( i ); ++j )
 		{
-			room = *itr;
-			break;
+			Tile& t = mTiles[ tiles[j] ];
+			if ( t.mType == Tile::Tile_FLOOR )
+				floors.push_back( &t );
 		}
 	}
+	DebugPrintf( "Sectors Created: %d\n", sectorCount );
+
+	// Debug
+	DebugPrintf( "Sector Connections Results\n" );
+	for ( int i = 0; i <= sectorCount; ++i )
+	{
+		const int count = mSectorGraph.GetNeighborCount( i );
+		if ( count == 0 )
+			continue;
+		const int* neighbors = mSectorGraph.GetNeighbors( i );
+		DebugPrintf( "[%d] :", i );
+		for ( int j = 0; j < count; ++j )
+			DebugPrintf( j + 1 < count ? " %d," : " %d", neighbors[j] );
+		DebugPrintf( "\n" );
+	}
+
+	// Pick the order sectors are unlocked in and where their keys go
+	const int entrance = (int) mEntranceLocation.x * mHeight + (int) mEntranceLocation.z;
+	mLockPlanner.Plan( mSectorGraph, *this, entrance, GetDistanceField( DistanceField_DOORS ), mRNG );
+	mOrderOfVisitation = mLockPlanner.GetVisitOrder();
+
+	// Locked doors keep the id of the key that opens them, which also gives the minimap their color
+	// 0 if no key does and the door is left open
+	for ( int i = 0; i < mSectorGraph.GetDoorCount(); ++i )
+		mTiles[ mSectorGraph.GetDoor( i ).mTile ].mSectorId = mLockPlanner.GetLockId( i );
+
+	const std::vector< LockPlanner::Key >& keys = mLockPlanner.GetKeys();
+	for ( auto itr = keys.begin(); itr != keys.end(); ++itr )
+	{
+		Tile& t = mTiles[ itr->mTile ];
+		t.mBlockObjectSpawn = true;
+		KeySpawn& key = mKeysToSpawn[ itr->mKeyId ];
+		key.mKeyId = itr->mKeyId;
+		key.mSectorId = itr->mSectorId;
+		key.mLocation = glm::vec3( t.x, t.z + 0.5f, t.y );
+		key.mColor = mSectorColors[ itr->mKeyId ];
+		DebugPrintf( "Creating Key to %d in %d\n", itr->mKeyId, itr->mSectorId );
+	}
+	mDistanceFields[ DistanceField_KEYS ].Invalidate();
+}
+//---------------------------------------
+void DungeonGenerator::ProveSolvable()
+{
+	std::vector< LockPlanner::Key > keys;
+	for ( auto itr = mKeysToSpawn.begin(); itr != mKeysToSpawn.end(); ++itr )
+	{
+		LockPlanner::Key key = { itr->second.mKeyId, itr->second.mSectorId, -1 };
+		keys.push_back( key );
+	}
+
+	const int startSector = GetTileAt( (int) mEntranceLocation.x, (int) mEntranceLocation.z ).mSectorId;
+	const int exitSector = GetTileAt( (int) mExitLocation.x, (int) mExitLocation.z ).mSectorId;
+	mSolvable = mLockPlanner.Solve( mSectorGraph, *this, keys, startSector, exitSector );
+	if ( !mSolvable )
+		WarnFail( "Floor '%s' can not be finished, sector %d can not be reached from %d\n", mFloorName.c_str(), exitSector, startSector );
+}
+//---------------------------------------
+const DistanceField& DungeonGenerator::GetDistanceField( DistanceFieldId id )
+{
+	DistanceField& field = mDistanceFields[ id ];
+	if ( field.IsBuilt() )
+		return field;
+
+	std::vector< int > sources;
+	if ( id == DistanceField_ENTRANCE || id == DistanceField_EXIT )
+	{
+		const glm::vec3& location = id == DistanceField_ENTRANCE ? mEntranceLocation : mExitLocation;
+		const int x = (int) location.x;
+		const int y = (int) location.z;
+		if ( x >= 0 && x < mWidth && y >= 0 && y < mHeight &&
+			GetTileAt( x, y ).mType == ( id == DistanceField_ENTRANCE ? Tile::Tile_ENTRANCE : Tile::Tile_EXIT ) )
+			sources.push_back( x * mHeight + y );
+	}
+	else if ( id == DistanceField_DOORS )
+	{
+		sources.reserve( mDoors.size() );
+		for ( auto itr = mDoors.begin(); itr != mDoors.end(); ++itr )
+			sources.push_back( ( *itr )->x * mHeight + ( *itr )->y );
+	}
+	else if ( id == DistanceField_KEYS )
+	{
+		for ( auto itr = mKeysToSpawn.begin(); itr != mKeysToSpawn.end(); ++itr )
+			sources.push_back( (int) itr->second.mLocation.x * mHeight + (int) itr->second.mLocation.z );
+	}
 
-	return room;
+	field.Build( *this, sources );
+	return field;
+}
+//---------------------------------------
+void DungeonGenerator::InvalidateDistanceFields()
+{
+	for ( int i = 0; i < DISTANCE_FIELD_COUNT; ++i )
+		mDistanceFields[i].Invalidate();
+}
+//---------------------------------------
+bool DungeonGenerator::RandomPercentCheck( float percentToBeTrue )
+{
+	const float r = mRNG.RandomUnit();
+	return percentToBeTrue > 0 && r <= percentToBeTrue ? true : false;
+}
+//---------------------------------------
+const Room* DungeonGenerator::GetRoomBySectorId( int sectorId ) const
+{
+	if ( sectorId <= 0 || sectorId >= (int) mRoomsBySector.size() )
+		return 0;
+	return mRoomsBySector[ sectorId ];
 }
 //---------------------------------------
\ No newline at end of file
@@ -17,9 +17,21 @@
 
 #include <map>
 #include <set>
+#include <limits.h>
 #include "Color.h"
 #include "XmlReader.h"
 #include "Logger.h"
+#include "RNG.h"
+#include "FreeSpaceIndex.h"
+#include "SectorGraph.h"
+#include "SymbolTable.h"
+#include "RuleProgram.h"
+#include "RuleState.h"
+#include "CandidateMasks.h"
+#include "RoomOccupancy.h"
+#include "LockPlanner.h"
+#include "DistanceField.h"
+#include "WeightedRandomTree.h"
 
 //---------------------------------------
 // Forwards
@@ -28,11 +40,25 @@ class Texture2D;
 class Mesh;
 class Entity;
 class Game;
-class Key;
 struct Tile;
 class TileGrid;
+class DungeonGenerator;
 class Room;
 struct DepthValue;
+class Timer;
+class LayoutStrategy;
+struct SpawnManifest;
+
+//---------------------------------------
+// Distance fields kept by DungeonGenerator for the current floor
+enum DistanceFieldId
+{
+	DistanceField_ENTRANCE,
+	DistanceField_EXIT,
+	DistanceField_DOORS,		// Every door, locked or not
+	DistanceField_KEYS,
+	DISTANCE_FIELD_COUNT
+};
 
 //---------------------------------------
 // Rule used for placement of objects in the world
@@ -41,20 +67,27 @@ struct Rule
 	static Rule* CreateRule( const XmlReader::XmlReaderIterator& xmlItr );
 
 	virtual ~Rule() {}
-	virtual bool IsValid( Tile* tile ) = 0;
-	virtual void Reset() {}
-	virtual void NotifySuccess() {}
-	virtual Rule* Copy() const = 0;
-
-	TileGrid* mGrid;
+	// Check tile of generator, rules know of no generator themselves so they can be shared
+	virtual bool IsValid( Tile* tile, DungeonGenerator& generator, const int32* state ) const = 0;
+	// Rules are not changed while generating, what they track is kept in a RuleState
+	// Number of slots of it this rule uses, passed to the calls below as state
+	virtual int GetStateSize() const { return 0; }
+	// Set state to its initial value
+	virtual void Reset( int32* /*state*/ ) const {}
+	// All checks passed, update state
+	virtual void NotifySuccess( int32* /*state*/ ) const {}
+	// What passed was taken back, undo NotifySuccess()
+	virtual void NotifyRemoved( int32* /*state*/ ) const {}
+	// Emit the instructions for this rule, by default the program calls IsValid()
+	virtual void Compile( RuleProgram& program ) const { program.Emit( RuleProgram::Op_RULE, this ); }
 };
 //---------------------------------------
 struct Rule_Random
 	: public Rule
 {
 	Rule_Random( const XmlReader::XmlReaderIterator& xmlItr );
-	virtual bool IsValid( Tile* tile );
-	virtual Rule* Copy() const { return new Rule_Random( *this ); }
+	virtual bool IsValid( Tile* tile, DungeonGenerator& generator, const int32* state ) const;
+	virtual void Compile( RuleProgram& program ) const;
 
 protected:
 	float mPercentToBeTrue;
@@ -73,7 +106,7 @@ struct Rule_ObjectRule
 	Rule_ObjectRule( const XmlReader::XmlReaderIterator& xmlItr );
 
 protected:
-	std::vector< std::string > mObjectNames;
+	std::vector< Symbol > mObjectNames;
 };
 //---------------------------------------
 struct Rule_StyleRule
@@ -81,7 +114,7 @@ struct Rule_StyleRule
 	Rule_StyleRule( const XmlReader::XmlReaderIterator& xmlItr );
 
 protected:
-	std::vector< std::string > mStyleNames;
+	std::vector< Symbol > mStyleNames;
 };
 //---------------------------------------
 struct Rule_SpawnOn
@@ -89,45 +122,49 @@ struct Rule_SpawnOn
 	, public Rule_UsageRule
 {
 	Rule_SpawnOn( const XmlReader::XmlReaderIterator& xmlItr );
-	virtual bool IsValid( Tile* tile ) = 0;
+	virtual bool IsValid( Tile* tile, DungeonGenerator& generator, const int32* state ) const = 0;
 };
 //---------------------------------------
 struct Rule_CanSpawnOn
 	: public Rule_SpawnOn
 {
 	Rule_CanSpawnOn( const XmlReader::XmlReaderIterator& xmlItr );
-	virtual bool IsValid( Tile* tile );
-	virtual Rule* Copy() const { return new Rule_CanSpawnOn( *this ); }
+	virtual bool IsValid( Tile* tile, DungeonGenerator& generator, const int32* state ) const;
+	virtual void Compile( RuleProgram& program ) const;
 };
 //---------------------------------------
 struct Rule_CanNotSpawnOn
 	: public Rule_SpawnOn
 {
 	Rule_CanNotSpawnOn( const XmlReader::XmlReaderIterator& xmlItr );
-	virtual bool IsValid( Tile* tile );
-	virtual Rule* Copy() const { return new Rule_CanNotSpawnOn( *this ); }
+	virtual bool IsValid( Tile* tile, DungeonGenerator& generator, const int32* state ) const;
+	virtual void Compile( RuleProgram& program ) const;
 };
 //---------------------------------------
 struct Rule_MaxCount
 	: public Rule
 {
 	Rule_MaxCount( const XmlReader::XmlReaderIterator& xmlItr );
-	virtual bool IsValid( Tile* tile );
-	virtual Rule* Copy() const { return new Rule_MaxCount( *this ); }
-	void Reset();
-	void NotifySuccess() { --mCurrentCount; }
+	virtual bool IsValid( Tile* tile, DungeonGenerator& generator, const int32* state ) const;
+	virtual void Compile( RuleProgram& program ) const { program.Emit( RuleProgram::Op_MAX_COUNT, this ); }
+	// The count left
+	int GetStateSize() const { return 1; }
+	void Reset( int32* state ) const { state[0] = mMaxCount; }
+	void NotifySuccess( int32* state ) const { --state[0]; }
+	void NotifyRemoved( int32* state ) const { if ( state[0] < mMaxCount ) ++state[0]; }
 	
 protected:
 	int mMaxCount;
-	int mCurrentCount;
 };
 //---------------------------------------
 struct Rule_AdjacentTo
 	: public Rule
 {
 	Rule_AdjacentTo( const XmlReader::XmlReaderIterator& xmlItr );
-	virtual bool IsValid( Tile* tile ) = 0;
-	void GetTilesToCheck( Tile* tile, std::vector< Tile* >& tilesToCheck );
+	virtual bool IsValid( Tile* tile, DungeonGenerator& generator, const int32* state ) const = 0;
+	void GetTilesToCheck( Tile* tile, TileGrid& grid, std::vector< Tile* >& tilesToCheck ) const;
+	// Emit an Op_ADJACENT checking the same tiles as GetTilesToCheck()
+	void CompileAdjacent( RuleProgram& program, int match ) const;
 
 	enum AdjacentDirection
 	{
@@ -152,9 +189,9 @@ struct Rule_NotAdjacentToUsage
 	, Rule_UsageRule
 {
 	Rule_NotAdjacentToUsage( const XmlReader::XmlReaderIterator& xmlItr );
-	virtual bool IsValid( Tile* tile );
-	virtual Rule* Copy() const { return new Rule_NotAdjacentToUsage( *this ); }
-	virtual bool CheckTile( Tile* tile, int usage );
+	virtual bool IsValid( Tile* tile, DungeonGenerator& generator, const int32* state ) const;
+	virtual void Compile( RuleProgram& program ) const;
+	virtual bool CheckTile( Tile* tile, int usage ) const;
 };
 //---------------------------------------
 struct Rule_NotAdjacentToObject
@@ -162,9 +199,9 @@ struct Rule_NotAdjacentToObject
 	, public Rule_ObjectRule
 {
 	Rule_NotAdjacentToObject( const XmlReader::XmlReaderIterator& xmlItr );
-	virtual bool IsValid( Tile* tile );
-	virtual Rule* Copy() const { return new Rule_NotAdjacentToObject( *this ); }
-	bool CheckTile( Tile* tile, const std::string& objectName );
+	virtual bool IsValid( Tile* tile, DungeonGenerator& generator, const int32* state ) const;
+	virtual void Compile( RuleProgram& program ) const;
+	bool CheckTile( Tile* tile, Symbol objectName ) const;
 };
 //---------------------------------------
 struct Rule_NotAdjacentToStyle
@@ -172,41 +209,40 @@ struct Rule_NotAdjacentToStyle
 	, public Rule_StyleRule
 {
 	Rule_NotAdjacentToStyle( const XmlReader::XmlReaderIterator& xmlItr );
-	virtual bool IsValid( Tile* tile );
-	virtual Rule* Copy() const { return new Rule_NotAdjacentToStyle( *this ); }
-	bool CheckTile( Tile* tile, const std::string& styleName );
+	virtual bool IsValid( Tile* tile, DungeonGenerator& generator, const int32* state ) const;
+	virtual void Compile( RuleProgram& program ) const;
+	bool CheckTile( Tile* tile, Symbol styleName ) const;
 };
 //---------------------------------------
 struct Rule_AdjacentToUsage
 	: public Rule_NotAdjacentToUsage
 {
 	Rule_AdjacentToUsage( const XmlReader::XmlReaderIterator& xmlItr );
-	virtual Rule* Copy() const { return new Rule_AdjacentToUsage( *this ); }
 };
 //---------------------------------------
 struct Rule_AdjacentToObject
 	: public Rule_NotAdjacentToObject
 {
 	Rule_AdjacentToObject( const XmlReader::XmlReaderIterator& xmlItr );
-	virtual Rule* Copy() const { return new Rule_AdjacentToObject( *this ); }
 };
 //---------------------------------------
 struct Rule_AdjacentToStyle
 	: public Rule_NotAdjacentToStyle
 {
 	Rule_AdjacentToStyle( const XmlReader::XmlReaderIterator& xmlItr );
-	virtual Rule* Copy() const { return new Rule_AdjacentToStyle( *this ); }
 };
 //---------------------------------------
 struct Rule_DistanceTo
 	: public Rule
 {
 	Rule_DistanceTo( const XmlReader::XmlReaderIterator& xmlItr );
-	bool IsValid( Tile* tile );
+	bool IsValid( Tile* tile, DungeonGenerator& generator, const int32* state ) const;
 	virtual bool ShouldCheck( const Tile& tile ) const = 0;
 	virtual float GetDistanceBetween( const Tile& startTile, const Tile& endTile ) const = 0;
 
-private:
+protected:
+	bool IsInRange( float d ) const { return d >= mMinDist && ( mMaxDist == 0 || d <= mMaxDist ); }
+
 	float mMinDist;
 	float mMaxDist;
 };
@@ -216,9 +252,15 @@ struct Rule_DistanceToUsage
 	, public Rule_UsageRule
 {
 	Rule_DistanceToUsage( const XmlReader::XmlReaderIterator& xmlItr );
-	Rule* Copy() const { return new Rule_DistanceToUsage( *this ); }
+	void Compile( RuleProgram& program ) const;
+	bool IsValid( Tile* tile, DungeonGenerator& generator, const int32* state ) const;
 	bool ShouldCheck( const Tile& tile ) const;
 	float GetDistanceBetween( const Tile& startTile, const Tile& endTile ) const;
+
+private:
+	// DistanceFieldId for each usage when walked="true", empty unless every usage has one
+	// Otherwise the Manhattan distance to each matching tile in the room is checked
+	std::vector< int > mFields;
 };
 //---------------------------------------
 struct Rule_DistanceToObject
@@ -226,7 +268,7 @@ struct Rule_DistanceToObject
 	, public Rule_ObjectRule
 {
 	Rule_DistanceToObject( const XmlReader::XmlReaderIterator& xmlItr );
-	Rule* Copy() const { return new Rule_DistanceToObject( *this ); }
+	void Compile( RuleProgram& program ) const;
 	bool ShouldCheck( const Tile& tile ) const;
 	float GetDistanceBetween( const Tile& startTile, const Tile& endTile ) const;
 };
@@ -236,7 +278,7 @@ struct Rule_DistanceToStyle
 	, public Rule_StyleRule
 {
 	Rule_DistanceToStyle( const XmlReader::XmlReaderIterator& xmlItr );
-	Rule* Copy() const { return new Rule_DistanceToStyle( *this ); }
+	void Compile( RuleProgram& program ) const;
 	bool ShouldCheck( const Tile& tile ) const;
 	float GetDistanceBetween( const Tile& startTile, const Tile& endTile ) const;
 };
@@ -247,8 +289,8 @@ struct Rule_ValidDepths
 	Rule_ValidDepths( const XmlReader::XmlReaderIterator& xmlItr );
 	Rule_ValidDepths( const Rule_ValidDepths& other );
 	virtual ~Rule_ValidDepths();
-	bool IsValid( Tile* tile );
-	Rule* Copy() const { return new Rule_ValidDepths( *this ); }
+	bool IsValid( Tile* tile, DungeonGenerator& generator, const int32* state ) const;
+	void Compile( RuleProgram& program ) const;
 	void AddValidDepth( DepthValue* depth );
 
 private:
@@ -261,8 +303,8 @@ struct Rule_RoomContains
 	: public Rule
 {
 	Rule_RoomContains();
-	bool IsValid( Tile* tile );
-	virtual bool CheckTile( const Tile& tile ) = 0;
+	bool IsValid( Tile* tile, DungeonGenerator& generator, const int32* state ) const;
+	virtual bool CheckTile( const Tile& tile ) const = 0;
 protected:
 	bool mPassValue;
 };
@@ -272,15 +314,14 @@ struct Rule_RoomDoesNotHaveUsage
 	, public Rule_UsageRule
 {
 	Rule_RoomDoesNotHaveUsage( const XmlReader::XmlReaderIterator& xmlItr );
-	virtual bool CheckTile( const Tile& tile );
-	virtual Rule* Copy() const { return new Rule_RoomDoesNotHaveUsage( *this ); }
+	virtual bool CheckTile( const Tile& tile ) const;
+	virtual void Compile( RuleProgram& program ) const;
 };
 //---------------------------------------
 struct Rule_RoomDoesHaveUsage
 	: public Rule_RoomDoesNotHaveUsage
 {
 	Rule_RoomDoesHaveUsage( const XmlReader::XmlReaderIterator& xmlItr );
-	Rule* Copy() const { return new Rule_RoomDoesHaveUsage( *this ); }
 };
 //---------------------------------------
 struct Rule_RoomDoesNotHaveStyle
@@ -288,15 +329,14 @@ struct Rule_RoomDoesNotHaveStyle
 	, public Rule_StyleRule
 {
 	Rule_RoomDoesNotHaveStyle( const XmlReader::XmlReaderIterator& xmlItr );
-	virtual bool CheckTile( const Tile& tile );
-	virtual Rule* Copy() const { return new Rule_RoomDoesNotHaveStyle( *this ); }
+	virtual bool CheckTile( const Tile& tile ) const;
+	virtual void Compile( RuleProgram& program ) const;
 };
 //---------------------------------------
 struct Rule_RoomDoesHaveStyle
 	: public Rule_RoomDoesNotHaveStyle
 {
 	Rule_RoomDoesHaveStyle( const XmlReader::XmlReaderIterator& xmlItr );
-	Rule* Copy() const { return new Rule_RoomDoesHaveStyle( *this ); }
 };
 //---------------------------------------
 struct Rule_RoomDoesNotHaveObject
@@ -304,15 +344,14 @@ struct Rule_RoomDoesNotHaveObject
 	, public Rule_ObjectRule
 {
 	Rule_RoomDoesNotHaveObject( const XmlReader::XmlReaderIterator& xmlItr );
-	virtual bool CheckTile( const Tile& tile );
-	virtual Rule* Copy() const { return new Rule_RoomDoesNotHaveObject( *this ); }
+	virtual bool CheckTile( const Tile& tile ) const;
+	virtual void Compile( RuleProgram& program ) const;
 };
 //---------------------------------------
 struct Rule_RoomDoesHaveObject
 	: public Rule_RoomDoesNotHaveObject
 {
 	Rule_RoomDoesHaveObject( const XmlReader::XmlReaderIterator& xmlItr );
-	Rule* Copy() const { return new Rule_RoomDoesHaveObject( *this ); }
 };
 //---------------------------------------
 
@@ -321,24 +360,45 @@ struct Rule_RoomDoesHaveObject
 // An object that has Rules
 struct RuledObject
 {
+	RuledObject();
 	virtual ~RuledObject();
 
 	// Cases Reset() to be called on all Rules
-	// This will reset any cached or tracking data in the Rules
+	// This will reset the tracking data of the Rules in state
 	// to be set to their initial values
-	virtual void ResetRules();
+	virtual void ResetRules( RuleState& state );
 
 	// Add a new Rule to this object
 	// This object will take ownership of the pointer
 	virtual void AddRule( Rule* rule );
 	virtual void AddRules( const std::vector< Rule* >& rules );
 
-	// Check the given Tile against this objects Rules
-	virtual bool ValidateRules( Tile* tile );
+	// Check the given Tile of generator against this objects Rules
+	// Runs the compiled rules, compiling them first if they changed
+	virtual bool ValidateRules( Tile* tile, DungeonGenerator& generator, RuleState& state );
+
+	// Lower mRules into a RuleProgram, done for every rule when an area loads
+	void CompileRules();
+	// The RuleProgram of mRules, compiled first if they changed
+	const RuleProgram& GetCompiledRules();
+	// Give the Rules their slots in state and reset them, done for every rule when an area loads
+	// Does nothing if they have slots already, objects used in several places share one set
+	void AllocateState( RuleState& state );
+	// Forget the slots, they are gone once the RuleState is cleared
+	void ReleaseState() { mStateSlot = -1; }
+	// The first slot of this object's Rules in state, allocated first if they changed
+	int32* GetState( RuleState& state );
+
+	// Turn off to check each Rule through IsValid() instead, for comparing the two
+	// This is shared by every RuledObject, only change it while nothing is generating
+	static void SetUseCompiledRules( bool use ) { sUseCompiledRules = use; }
+	static bool IsUsingCompiledRules() { return sUseCompiledRules; }
 
 	// Lets the Rules know that all checks passed and they should
-	// do an internal update of their tracking data
-	void NotifySuccess();
+	// update their tracking data in state
+	void NotifySuccess( RuleState& state );
+	// Lets the Rules know that what passed was removed again, i.e. a rerolled room
+	void NotifyRemoved( RuleState& state );
 
 	// Load Rule tags from someTag
 	// Structure is as so:
@@ -346,14 +406,12 @@ struct RuledObject
 	//   <Rule />
 	// </someTag>
 	template< typename TRuledObject >
-	void LoadRulesFromXML( const XmlReader::XmlReaderIterator& xmlItr, TileGrid* ownerGrid, const std::map< std::string, TRuledObject* >& objectMap )
+	void LoadRulesFromXML( const XmlReader::XmlReaderIterator& xmlItr, const SymbolMap< TRuledObject >& objectMap )
 	{
 		for ( XmlReader::XmlReaderIterator ruleItr = xmlItr.NextChild( "Rule" );
 			ruleItr.IsValid(); ruleItr = ruleItr.NextSibling( "Rule" ) )
 		{
-			Rule* rule = Rule::CreateRule( ruleItr );
-			rule->mGrid = ownerGrid;
-			mRules.push_back( rule );
+			AddRule( Rule::CreateRule( ruleItr ) );
 		}
 
 		// Copy rules
@@ -361,7 +419,7 @@ struct RuledObject
 		xmlItr.GetAttributeAsCSV( "extendsRules", objectsToCopyFrom );
 		for ( auto objectCopyItr = objectsToCopyFrom.begin(); objectCopyItr != objectsToCopyFrom.end(); ++objectCopyItr )
 		{
-			TRuledObject* objectToCopy = objectMap.at( *objectCopyItr );
+			TRuledObject* objectToCopy = objectMap.Find( *objectCopyItr );
 			if ( objectToCopy )
 			{
 				CopyRulesFrom( objectToCopy );
@@ -373,10 +431,17 @@ struct RuledObject
 		}
 	}
 
-	// Append this objects rules with copies of obj rules
+	// Append obj's rules to this object's, the rules are shared
+	// Their state is not, this object gets its own slots. obj must outlive this object
 	void CopyRulesFrom( RuledObject* obj );
 protected:
 	std::vector< Rule* > mRules;
+	std::vector< Rule* > mOwnedRules;	// The rules of mRules this object deletes
+	RuleProgram mProgram;
+	bool mRulesCompiled;		// False when mRules changed since mProgram was compiled
+	int mStateSlot;				// First slot in the RuleState, -1 if not allocated since mRules changed
+
+	static bool sUseCompiledRules;
 };
 
 //---------------------------------------
@@ -387,9 +452,9 @@ struct EventObject
 	void SetupEvents( Entity* entity ) const;
 
 	// <type, <tags>>
-	std::map< int, std::vector< unsigned int > > mSignals;
+	std::map< int, std::vector< Symbol > > mSignals;
 	// <tag, <commands>>
-	std::map< unsigned int, std::vector< std::string > > mSlots;
+	std::map< Symbol, std::vector< std::string > > mSlots;
 };
 
 
@@ -414,6 +479,7 @@ struct TileObject
 	int mUsageId;		// How this object is used
 	Mesh* mMesh;
 	std::string mName;
+	Symbol mNameId;		// mName interned
 	glm::vec3 mLocalSpawnOffset;
 	TileObject* mAttachment;
 };
@@ -421,7 +487,7 @@ struct TileObject
 struct TileObject_Pickup
 	: public TileObject
 {
-	std::string mPickupName;
+	Symbol mPickupName;
 };
 
 struct TileObject_Light
@@ -436,21 +502,24 @@ struct TileObject_Light
 struct TileObject_Enemy
 	: public TileObject
 {
-	std::string mEnemyClass;
+	Symbol mEnemyClass;
 };
 
 struct SpawnList
 {
-	const std::string& GetRandomObject() const;
+	// Index into mList, -1 if it is empty
+	int GetRandomIndex( RNG& rng ) const;
 
-	std::vector< std::string > mList;
+	std::vector< Symbol > mList;		// Enemy template names
 };
 
 // Just spawns enemies right now
 struct TileObject_Spawner
 	: public TileObject
 {
-	const std::string& GetObjectToSpawn() const;
+	// Pick what to spawn, see SpawnManifest::ObjectSpawn::mVariant
+	int GetRandomVariant( RNG& rng ) const { return mList ? mList->GetRandomIndex( rng ) : -1; }
+	Symbol GetObjectToSpawn( int variant ) const { return mList->mList[ variant ]; }
 
 	SpawnList* mList;
 };
@@ -468,6 +537,7 @@ struct TileStyle
 	int mUsageId;		// What tile type this style can be applied to
 	Mesh* mMesh;
 	std::string mName;
+	Symbol mNameId;		// mName interned
 	bool mCanBeLocked;	// Used by doors
 	bool mForceLocked;
 };
@@ -478,7 +548,7 @@ struct TileStyle
 struct Useable
 	: public RuledObject
 {
-	void ResetRules();
+	void ResetRules( RuleState& state );
 
 	RuledObject* mObject;
 };
@@ -491,6 +561,8 @@ struct DepthValue
 {
 	virtual bool IsValidAtDepth( int depth ) const = 0;
 	virtual DepthValue* Copy() const = 0;
+	// Inclusive range of depths this is valid at
+	virtual void GetDepthRange( int& min, int& max ) const = 0;
 };
 //---------------------------------------
 struct DepthValue_All
@@ -498,6 +570,7 @@ struct DepthValue_All
 {
 	bool IsValidAtDepth( int depth ) const { return true; }
 	DepthValue* Copy() const { return new DepthValue_All( *this ); }
+	void GetDepthRange( int& min, int& max ) const { min = INT_MIN; max = INT_MAX; }
 };
 //---------------------------------------
 struct DepthValue_Single
@@ -506,6 +579,7 @@ struct DepthValue_Single
 	DepthValue_Single( int depth ) : mDepth( depth ) {}
 	virtual bool IsValidAtDepth( int depth ) const { return depth == mDepth; }
 	virtual DepthValue* Copy() const { return new DepthValue_Single( *this ); }
+	virtual void GetDepthRange( int& min, int& max ) const { min = mDepth; max = mDepth; }
 	void SetValidDepth( int depth ) { mDepth = depth; }
 
 protected:
@@ -518,6 +592,7 @@ struct DepthValue_Range
 	DepthValue_Range( int min, int max ) : mMinDepth( min ), mMaxDepth( max ) {}
 	bool IsValidAtDepth( int depth ) const { return depth >= mMinDepth && depth <= mMaxDepth; }
 	DepthValue* Copy() const { return new DepthValue_Range( *this ); }
+	void GetDepthRange( int& min, int& max ) const { min = mMinDepth; max = mMaxDepth; }
 	void SetDepthRange( int min, int max ) { mMinDepth = min; mMaxDepth = max; }
 
 private:
@@ -530,6 +605,7 @@ struct DepthValue_LessThan
 	DepthValue_LessThan( int depth ) : DepthValue_Single( depth ) {}
 	bool IsValidAtDepth( int depth ) const { return depth <= mDepth; }
 	DepthValue* Copy() const { return new DepthValue_LessThan( *this ); }
+	void GetDepthRange( int& min, int& max ) const { min = INT_MIN; max = mDepth; }
 };
 //---------------------------------------
 struct DepthValue_GreaterThan
@@ -538,6 +614,7 @@ struct DepthValue_GreaterThan
 	DepthValue_GreaterThan( int depth ) : DepthValue_Single( depth ) {}
 	bool IsValidAtDepth( int depth ) const { return depth >= mDepth; }
 	DepthValue* Copy() const { return new DepthValue_GreaterThan( *this ); }
+	void GetDepthRange( int& min, int& max ) const { min = mDepth; max = INT_MAX; }
 };
 
 
@@ -553,13 +630,21 @@ public:
 
 	void CopyDataFrom( RoomTemplate* room );
 
-	TileStyle* GetStyle( Tile* tile );
+	// masks from BuildCandidates() skips the useables that are certain to fail at tile
+	TileStyle* GetStyle( Tile* tile, DungeonGenerator& generator, RuleState& state, const CandidateMasks* masks=0 );
 	void AddStyle( Useable* style );
 	bool HasStyleForUsage( int usage ) const;
-	TileObject* GetObject( Tile* tile );
+	TileObject* GetObject( Tile* tile, DungeonGenerator& generator, RuleState& state, const CandidateMasks* masks=0 );
+	// Masks of the objects and styles of this template over room, see CandidateMasks
+	void BuildCandidates( CandidateMasks& masks, DungeonGenerator& generator, RuleState& state, const Room& room );
 	void AddObject( Useable* object );
-	void ResetRules();
-	void ResetObjects();
+	void ResetRules( RuleState& state );
+	void ResetObjects( RuleState& state );
+	// Compile the rules of this template, its useables and what they use
+	// and give them their slots in state if they do not have them yet
+	void CompileAllRules( RuleState& state );
+	// Release the slots of the same objects CompileAllRules() gives them to
+	void ReleaseAllState();
 	void SetMinSize( int x, int y );
 	void SetMaxSize( int x, int y );
 
@@ -629,13 +714,15 @@ struct Tile
 		, mRevealed( false )
 		, mLocked( false )
 		, mBlockObjectSpawn( false )
+		, mDoorStyle( 0 )
+		, mObjectVariant( -1 )
 	{}
 
 	void SetLocation( int _x, int _y ) { x = _x; y = _y; }
 	int GetUsageId() const;
 	float GetOrientation() const;
-	bool HasObjectOfName( const std::string& name ) const;
-	bool HasStyleOfName( const std::string& name ) const;
+	bool HasObjectOfName( Symbol name ) const;
+	bool HasStyleOfName( Symbol name ) const;
 	bool CanBeLocked() const;
 
 	int x, y;				// Array Location
@@ -650,6 +737,8 @@ struct Tile
 	Room* mRoom;			// This is only valid during generation
 	TileStyle* mStyle;
 	TileObject* mObject;
+	TileStyle* mDoorStyle;	// Door in a door frame, picked with the rest of the room's spawn data
+	int mObjectVariant;		// What mObject spawns if it is a spawner, see TileObject_Spawner
 };
 
 //---------------------------------------
@@ -682,9 +771,21 @@ public:
 	{
 		const int i = x * mHeight + y;
 		if ( i < 0 || i >= (int) mTiles.size() )
-			return Tile::NULL_TILE;
+		{
+			// Callers may write to the tile they get back so each grid
+			// hands out its own copy, keeping grids on other threads safe
+			mNullTile = Tile::NULL_TILE;
+			return mNullTile;
+		}
 		return mTiles[ x * mHeight + y ];
 	}
+	const Tile& GetTileAt( int x, int y ) const
+	{
+		const int i = x * mHeight + y;
+		if ( i < 0 || i >= (int) mTiles.size() )
+			return Tile::NULL_TILE;
+		return mTiles[ i ];
+	}
 	void SetTileAt( int x, int y, int value )
 	{
 		mTiles[ x * mHeight + y ].mType = value;
@@ -702,6 +803,7 @@ public:
 protected:
 	int mWidth, mHeight;
 	std::vector< Tile > mTiles;
+	Tile mNullTile;		// Returned by GetTileAt() when out of bounds
 };
 
 //---------------------------------------
@@ -721,7 +823,116 @@ public:
 
 	int x, y;					// Location of top left of this grid in the parent grid
 	int mSectorId;				// The sector id for the tiles in this room
+	int mIndex;					// Index of this room in the generator's room list
 	RoomTemplate* mTemplate;	// Template used to create this room
+	std::vector< int > mDoorCandidates;	// Parent grid indices of walls a new room could grow from
+	RoomOccupancy mOccupancy;	// Built while the room's spawn data is generated
+};
+
+//---------------------------------------
+// A key placed during generation
+// The Key entity is created from this by Game::CreateEntities()
+struct KeySpawn
+{
+	int mKeyId;				// Sector the key unlocks
+	int mSectorId;			// Sector the key was placed in
+	glm::vec3 mLocation;
+	Color mColor;
+};
+
+//---------------------------------------
+// An opening between two rooms, an edge of the room graph
+// Rooms open onto each other through a door, an archway or a stair
+struct RoomConnection
+{
+	int mRoomA, mRoomB;		// Room indices, mRoomA is west or north of mRoomB
+	int mTileA, mTileB;		// Tile indices x * height + y of the opening on either side
+	bool mDoor;				// One side is a door tile, see Tile::mLocked
+};
+
+//---------------------------------------
+// Wall time spent in each phase of the last Generate() call
+// All times are in milliseconds
+struct GenerationTimings
+{
+	GenerationTimings()
+		: mPlaceRooms( 0 )
+		, mGatherDoors( 0 )
+		, mPlaceEntrance( 0 )
+		, mCalculateSectors( 0 )
+		, mPlaceExit( 0 )
+		, mGenerateSpawnData( 0 )
+		, mRoomAttempts( 0 )
+		, mRoomsPlaced( 0 )
+		, mFillRatio( 0 )
+		, mSectorCount( 0 )
+		, mPlacementStop( Stop_ATTEMPTS )
+		, mTargetMet( false )
+		, mWithinBudget( true )
+	{}
+
+	// Why room placement ended
+	enum PlacementStop
+	{
+		Stop_ATTEMPTS,		// Ran out of attempts
+		Stop_FULL,			// No room has anywhere left for a door
+		Stop_MAX_ROOMS,		// Reached SetMaxRoomCount()
+		Stop_TARGET,		// Reached the quality target of the GenerationBudget
+		Stop_BUDGET,		// Ran out of time
+		Stop_LAYOUT,		// A LayoutStrategy placed every room it planned
+	};
+
+	double GetTotal() const
+	{
+		return mPlaceRooms + mGatherDoors + mPlaceEntrance + mCalculateSectors + mPlaceExit + mGenerateSpawnData;
+	}
+
+	double mPlaceRooms;
+	double mGatherDoors;
+	double mPlaceEntrance;
+	double mCalculateSectors;
+	double mPlaceExit;
+	double mGenerateSpawnData;
+	int mRoomAttempts;		// Number of rooms generated while placing
+	int mRoomsPlaced;		// Number of rooms that fit
+	float mFillRatio;		// Fraction of the grid covered by rooms
+	int mSectorCount;
+	int mPlacementStop;		// PlacementStop
+	bool mTargetMet;		// Every quality target of the GenerationBudget was reached
+	bool mWithinBudget;		// Generate() finished inside its time budget
+};
+
+//---------------------------------------
+// Limits for an anytime Generate()
+// Room placement stops once the time runs out or every non zero target is reached,
+// then the remaining passes run as usual. Zero means no limit or no target
+struct GenerationBudget
+{
+	GenerationBudget()
+		: mMilliseconds( 0 )
+		, mRoomCount( 0 )
+		, mFillRatio( 0 )
+		, mMinSectorCount( 0 )
+	{}
+
+	double mMilliseconds;	// Wall time for the whole Generate()
+	int mRoomCount;
+	float mFillRatio;		// Fraction of the grid covered by rooms [0,1]
+	int mMinSectorCount;	// Estimated while placing from the doors placed and SetDoorLockChance()
+};
+
+//---------------------------------------
+// Passes of a Generate() in the order they run, see DungeonGenerator::Step()
+enum GenerationPhase
+{
+	Phase_CLEAR,
+	Phase_PLACE_ROOMS,
+	Phase_GATHER_DOORS,
+	Phase_PLACE_ENTRANCE,
+	Phase_CALCULATE_SECTORS,
+	Phase_PLACE_EXIT,
+	Phase_GENERATE_SPAWN_DATA,
+	Phase_DONE,
 };
 
 //---------------------------------------
@@ -730,6 +941,9 @@ public:
 class DungeonGenerator
 	: public TileGrid
 {
+	friend class FloorCache;
+	friend class FloorFile;
+	friend class LayoutStrategy;
 public:
 	// Initialized to default values
 	DungeonGenerator();
@@ -739,6 +953,8 @@ public:
 	// Use to set values before generation
 	void Init( int width, int height, int maxRoomCount, int minRoomWidth, int maxRoomWidth, int minRoomHeight, int maxRoomHeight );
 
+	// Max number of rooms to place, 0 -> no limit
+	void SetMaxRoomCount( int count ) { mMaxRoomCount = count; }
 	// The chance a room will change in height
 	// v = [0,1]
 	void SetVerticalness( float v ) { mVerticalChance = v; }
@@ -756,9 +972,53 @@ public:
 	const char* GetName() const { return mName.c_str(); }
 	const char* GetFloorName() const { return mFloorName.c_str(); }
 	int GetCurrentDepth() const { return mCurrentDepth; }
+	// Generate() advances from this depth
+	void SetCurrentDepth( int depth ) { mCurrentDepth = depth; }
+	// Edges of the map for SetEdgeExits()
+	enum MapEdge
+	{
+		Edge_NORTH	= 1 << 0,	// y == 0
+		Edge_SOUTH	= 1 << 1,	// y == height - 1
+		Edge_WEST	= 1 << 2,	// x == 0
+		Edge_EAST	= 1 << 3,	// x == width - 1
+	};
+	// Run a corridor from the first room to the middle of each edge in edgeMask
+	// and leave its end open. Maps of the same size with matching exits line up
+	// when placed next to each other.
+	void SetEdgeExits( int edgeMask ) { mEdgeExits = edgeMask; }
+	// How rooms are placed, see LayoutStrategy.h. The generator does not own it
+	// 0 -> grow rooms out of random doors of the rooms placed so far (default)
+	// A strategy places all of its rooms in one go, the quality target and time limit of a GenerationBudget do not apply
+	void SetLayoutStrategy( LayoutStrategy* layout ) { mLayout = layout; }
+	// Generate only walls, floors, doors, sectors and the room graph, i.e. for scouting seeds
+	// No tile gets a style or object, the rules of TileStyles and TileObjects are not run
+	// and the spawn data pass is skipped. The layout is the same as a full Generate() of the same seed
+	void SetLayoutOnly( bool layoutOnly ) { mLayoutOnly = layoutOnly; }
+	bool IsLayoutOnly() const { return mLayoutOnly; }
+	// Seed used by the next Generate()
+	// The layout and the spawn data draw from separate streams of it, see RerollSpawns()
+	void SetRandomSeed( uint64_t seed ) { mRNG.SetRandomSeed( seed ); mSpawnRNG = mRNG.Split( SPAWN_RNG_STREAM ); }
+	// Stream the layout is made from
+	RNG& GetRNG() { return mRNG; }
+	// Stream Rules draw from, the spawn stream while styles and objects are picked
+	RNG& GetRuleRNG() { return mGeneratingSpawns ? mSpawnRNG : mRNG; }
 
 	// Generate a random dungeon
 	void Generate();
+	// Generate a random dungeon within a time budget, see GenerationBudget
+	// What was achieved is in GetLastTimings()
+	void Generate( const GenerationBudget& budget );
+	// Start a Generate() to be run a slice at a time with Step()
+	// The time budget counts only the time spent inside Step()
+	void BeginGenerate( const GenerationBudget& budget=GenerationBudget() );
+	// Run the generation started by BeginGenerate() for about budgetMicroseconds, 0 -> until done
+	// Stops between room placement attempts, rooms of spawn data or the other passes
+	// and picks up from there on the next call. Returns true once the floor is finished
+	bool Step( int budgetMicroseconds );
+	// Phase_DONE once the floor can be used
+	GenerationPhase GetGenerationPhase() const { return mPhase; }
+	// Profiling info for the last Generate()
+	const GenerationTimings& GetLastTimings() const { return mTimings; }
 
 	// An ASCII string of the grid
 	std::string ToText();
@@ -766,20 +1026,55 @@ public:
 	// Debug info drawing
 	void Draw( Window* window );
 
-	// Add an empty room template
-	RoomTemplate& CreateRoomTemplate()
-	{
-		mRoomTemplates.push_back( new RoomTemplate() );
-		return *mRoomTemplates.back();
-	}
+	// Generate rooms from templates owned elsewhere, i.e. by a DungeonArea
+	// Templates are only read while generating so generators may share them
+	// ruleState must be the one their rules were compiled into, this generator works on its own copy
+	void SetRoomTemplates( const std::vector< RoomTemplate* >& templates, const RuleState& ruleState );
 
 	// Useful locations
 	glm::vec3 GetStartLocation() const { return mEntranceLocation; }
 	glm::vec3 GetExitLocation() const { return mExitLocation; }
 	void GetDoorLocations( std::vector< glm::vec3 >& doorLocations ) const;
 
-	// Spawn entities in the world
-	void SpawnEntities( Game* world );
+	// Everything the floor spawns as plain data, see Game::CreateEntities()
+	// The generator is only read so it can be built on any thread, as often as needed
+	// Door styles and spawner picks were made with the spawn data
+	void BuildSpawnManifest( SpawnManifest& manifest ) const;
+	// Only the styles and objects of one room, i.e. after RerollRoom()
+	// Entities are tagged with the room index, see Entity::GetSpawnRoom()
+	void BuildRoomSpawnManifest( SpawnManifest& manifest, int roomIndex ) const;
+
+	// Rooms of the current floor
+	int GetRoomCount() const { return (int) mRooms.size(); }
+	// Index of the room a tile belongs to, -1 if none
+	int GetRoomIndexAt( int x, int y ) const;
+	// -1 if roomIndex is out of range
+	int GetRoomSectorId( int roomIndex ) const;
+	// Top left tile and size of a room, returns false if roomIndex is out of range
+	bool GetRoomBounds( int roomIndex, int& x, int& y, int& w, int& h ) const;
+	// Openings between rooms of the current floor, each pair of touching tiles once
+	// Built on first use and kept until the floor changes
+	const std::vector< RoomConnection >& GetRoomConnections();
+	// Pick the styles and objects of one room again, in place, as if the room was filled for the first time
+	// The layout, doors, door styles and sectors are kept and only that room's rules are run
+	bool RerollRoom( int roomIndex );
+	// RerollRoom() every room in the sector, returns the number of rooms
+	int RerollSector( int sectorId );
+	// Pick the styles and objects of every room again from seed, keeping the layout
+	// Gives the same spawns as a Generate() of the first floor from SetRandomSeed( seed ),
+	// so it also fills in a floor made with SetLayoutOnly()
+	void RerollSpawns( uint64_t seed );
+
+	// Walking distance fields of the current floor
+	// Built on first use and kept until the floor changes
+	const DistanceField& GetDistanceField( DistanceFieldId id );
+	// Steps from x, y to the nearest source of field id, -1 if it can not be reached
+	int GetWalkDistance( DistanceFieldId id, int x, int y ) { return GetDistanceField( id ).GetDistance( x, y ); }
+
+	// True if the exit of the current floor can be reached from the entrance
+	bool IsSolvable() const { return mSolvable; }
+	// Doors that must be unlocked one after the other to reach the exit, -1 if the floor is not solvable
+	int GetCriticalPathLength() const { return mSolvable ? mLockPlanner.GetCriticalPathLength() : -1; }
 
 	const Color& GetColorForSectorId( int sectorId ) const
 	{
@@ -803,44 +1098,93 @@ private:
 
 	
 
-	// Generate a random room
-	void GenerateRoom( Room& room );
-	// Add a room to the map
+	// Get the first room template whose rules pass
+	RoomTemplate* GetValidRoomTemplate();
+	// Size limits for rooms made from tmpl
+	void GetRoomSizeRange( const RoomTemplate& tmpl, int& minSizeX, int& maxSizeX, int& minSizeY, int& maxSizeY ) const;
+	// Top left of a w x h room that opens onto the given door
+	void GetRoomLocationForDoor( int doorX, int doorY, int dir, int w, int h, int& rx, int& ry ) const;
+	// Pick a random room size for tmpl and shrink it until it fits at the door
+	// Returns false if even the smallest room would not fit
+	bool FitRoomToDoor( const RoomTemplate& tmpl, int doorX, int doorY, int dir, int& w, int& h );
+	// Fill a w x h room with walls and floor
+	void GenerateRoom( Room& room, RoomTemplate* tmpl, int w, int h );
+	// Add the corridors requested by SetEdgeExits() to the first room
+	void AddEdgeExits( const Room& firstRoom );
+	// Add a room to the map, the generator takes ownership of it
 	void AddRoom( Room& room, int x, int y, float z );
 	// Create an empty dungeon
 	void Clear();
+	// The two halves of Clear(), Step() resets the tiles a slice at a time
+	void ClearTiles( int begin, int end );
+	void ClearFloorData();
 	// Place entrance - must be called before CalculateSectors()
 	void PlaceEntrance();
 	// Place exit - must be called after CalculateSectors()
 	void PlaceExit();
 	// Get a location where a door could be placed
-	void GetDoorLocation( int& x, int& y );
+	// Returns false if no room has anywhere left to put a door
+	bool GetDoorLocation( int& x, int& y );
 	// Get the direction the door should open
-	int GetDoorDirection( int x, int y );
-	// Try to place a room
-	bool CanRoomFitHere( int x, int y, int w, int h, float z );
+	int GetDoorDirection( int x, int y ) const;
+	// Check if a new room could grow out of the wall at x, y
+	bool IsDoorCandidate( int x, int y ) const;
+	// Add or remove the tiles in the rectangle from their room's door candidates
+	void UpdateDoorCandidates( int x, int y, int w, int h );
+	// Keep the room selection weights in sync with its door candidates
+	void UpdateRoomWeight( const Room& room );
+	// Check if a room would fit without overlapping any other room
+	// Rooms never overlap whatever their height, so only the floor plan is checked
+	bool CanRoomFitHere( int x, int y, int w, int h ) const;
 	// Create a connection between two rooms
 	// This function will mutate tiles around the connection so that they look correct
-	void ConnectRooms( int doorX, int doorY, int dir );
-	// Generate what objects and world geometry should spawn on each tile
-	void GenerateSpawnData();
+	// Returns true if a door was placed in the connection
+	bool ConnectRooms( int doorX, int doorY, int dir );
+	// True once every non zero target of budget is reached by the rooms placed so far
+	bool IsTargetMet( const GenerationBudget& budget, int doorsPlaced ) const;
+	// Height for a room grown out of one at z, see SetVerticalness()
+	float GetAdjoiningRoomZ( float z );
+	// Room placement for Step(), returns false if it ran out of time before placement was over
+	// stepMilliseconds of 0 -> no limit
+	bool PlaceRooms( const Timer& stepTimer, double stepMilliseconds );
+	// Report on the floor once the last pass is done, finishedAt is the time spent in Step()
+	void FinishGenerate( double finishedAt );
+	// Styles and objects for the tiles of one room, and the styles of its doors if pickDoors
+	void GenerateRoomSpawnData( Room& room, bool pickDoors=true );
+	// Take back the styles and objects of one room, and its door styles if clearDoors
+	// The objects' floor wide limits get their picks back, as if they were never made
+	void ClearRoomSpawnData( Room& room, bool clearDoors );
+	// Label sectors and build the graph of locked doors between them
+	void BuildSectorGraph();
 	// Create a critical path through the level
 	void CalculateSectors();
-	// Used by CalculateSectors() to determine connectivity
-	void FloodFill( int x, int y, int initId, int destId );
+	// Check the exit can be reached from the entrance with the keys placed, sets mSolvable
+	void ProveSolvable();
+	// Call whenever walkable tiles, doors or the entrance, exit and keys change
+	void InvalidateDistanceFields();
+	// Find the openings along the east and south walls of every room
+	void BuildRoomConnections();
 	// Locks random doors in the map
 	void LockRandomDoors();
 	// Cache all the door tiles
 	void GatherDoors();
+	// Door tiles with index in [begin,end)
+	void GatherDoors( int begin, int end );
 	// Utility for random checks
-	bool RandomPercentCheck( float percentToBeTrue ) const;
-	// Spawns an object and all of its attachments
-	void SpawnTileObject( Game* world, Tile& tile, TileObject* obj, Entity* parent=0 );
+	bool RandomPercentCheck( float percentToBeTrue );
+	// Add an object and all of its attachments to manifest
+	// variant is what obj spawns if it is a spawner, attachments spawn nothing
+	void AddObjectSpawns( SpawnManifest& manifest, const Tile& tile, TileObject* obj, int roomIndex, int parent, int variant ) const;
+	// Add the style and object of a tile to manifest, tagged with roomIndex
+	void AddTileSpawns( SpawnManifest& manifest, const Tile& tile, int roomIndex ) const;
 	// Get a room by its id. Returns null if no rooms in the sector
 	const Room* GetRoomBySectorId( int sectorId ) const;
 
 	// Dimensions
 	int mMaxRoomCount;
+	int mEdgeExits;		// MapEdge mask
+	LayoutStrategy* mLayout;
+	bool mLayoutOnly;
 	int mMinRoomSizeX, mMinRoomSizeY;
 	int mMaxRoomSizeX, mMaxRoomSizeY;
 
@@ -857,18 +1201,47 @@ private:
 	glm::vec3 mExitLocation;
 
 	// Generation
-	std::vector< RoomTemplate* > mRoomTemplates;
+	std::vector< RoomTemplate* > mRoomTemplates;	// Not owned, see SetRoomTemplates()
 	RoomTemplate mDummyRoomTmpl;
 	std::vector< Room* > mRooms;
+	FreeSpaceIndex mFreeSpace;		// Cells covered by mRooms
+	int mRoomArea;					// Tiles covered by mRooms
+	std::vector< int > mDoorCandidateSlots;	// Per tile, index into its room's mDoorCandidates or -1
+	WeightedRandomTree mRoomWeights;		// Direction biased weight of each room with door candidates
+	WeightedRandomTree mRoomsWithDoors;		// 1 for each room with door candidates
+	RNG mRNG;								// Every random choice made for the layout comes from here
+	RNG mSpawnRNG;							// And for styles and objects from here
+	bool mGeneratingSpawns;					// GetRuleRNG() is mSpawnRNG
+	CandidateMasks mCandidates;				// Of the room GenerateRoomSpawnData() is filling
+	RuleState mRuleState;					// What the rules of the area track, i.e. max counts
+	static const uint64_t SPAWN_RNG_STREAM = 1;	// mRNG.Split() for mSpawnRNG
 	std::vector< Tile* > mDoors;
+	SectorGraph mSectorGraph;				// Sectors and the locked doors between them
+	std::vector< const Room* > mRoomsBySector;	// First room of each sector id
+	LockPlanner mLockPlanner;
+	bool mSolvable;							// Set by ProveSolvable()
+	DistanceField mDistanceFields[ DISTANCE_FIELD_COUNT ];
+	std::vector< RoomConnection > mRoomConnections;
+	bool mRoomConnectionsBuilt;
 	std::map< int, std::vector< Tile* > > mTilesBySector;
-	std::map< int, Key* > mKeysToSpawn;
-	std::set< int > mSectorsToVisit;
+	std::map< int, KeySpawn > mKeysToSpawn;
 	std::vector< int > mOrderOfVisitation;
 
 	// Debug
 	std::map< int, Color > mSectorColors;
-
+	GenerationTimings mTimings;
+
+	// Step() state
+	static const int STEP_TILE_COUNT = 1 << 16;	// Tiles cleared or scanned for doors between checks of the clock
+	GenerationPhase mPhase;
+	int mTileCursor;				// Next tile to clear or scan for doors
+	GenerationBudget mBudget;
+	int mPlacementAttempt;
+	int mDoorsPlaced;
+	int mSpawnRoomIndex;
+	double mWorkMilliseconds;		// Time spent in Step() for this floor
+	double mPlacedAt;				// mWorkMilliseconds when room placement ended
+	double mFinishEstimate;			// Milliseconds per room the passes after room placement took last time
 	// Naming
 	std::string mName;
 	std::string mFloorName;
@@ -0,0 +1,66 @@
+/*
+ * Description :
+ *   Parts of DungeonGenerator that touch game entities or draw.
+ *   Entities themselves are made by Game::CreateEntities() from a SpawnManifest.
+ *   Kept out of DungeonGenerator.cpp so the generator can be built
+ *   without the engine (see CMakeLists.txt).
+ */
+ 
+#include "DungeonGenerator.h"
+#include "Texture.h"
+#include "Window.h"
+#include "Logger.h"
+
+
+//---------------------------------------
+// EventObject
+void EventObject::SetupEvents( Entity* entity ) const
+{
+	for ( auto itr = mSignals.begin(); itr != mSignals.end(); ++itr )
+	{
+		for ( auto jtr = itr->second.begin(); jtr != itr->second.end(); ++jtr )
+			entity->RegisterSignal( itr->first, *jtr );
+	}
+
+	for ( auto itr = mSlots.begin(); itr != mSlots.end(); ++itr )
+	{
+		for ( auto jtr = itr->second.begin(); jtr != itr->second.end(); ++jtr )
+			entity->RegisterSlot( itr->first, *jtr );
+	}
+}
+//---------------------------------------
+
+
+//---------------------------------------
+// DungeonGenerator
+void DungeonGenerator::Draw( Window* window )
+{
+	// Debug
+	if ( DebugSectors )
+	{
+		for ( auto itr = mTilesBySector.begin(); itr != mTilesBySector.end(); ++itr )
+		{
+			Texture2D::Unbind();
+			window->SetDrawColor( mSectorColors[ itr->first ] );
+			for ( auto jtr = itr->second.begin(); jtr != itr->second.end(); ++jtr )
+			{
+				Tile* t = *jtr;
+				window->DrawQuad( (float) t->x, (float) t->y, t->z + 0.005f, 1.0f, 1.0f );
+			}
+		}
+
+		// Critical path debug
+		float x = 0.0f, y = 220.0f;
+		for ( auto itr = mSectorColors.begin(); itr != mSectorColors.end(); ++itr )
+		{
+			window->DrawDebugTextFmt( x, y, itr->second, "%d", itr->first );
+			y += 24.0f;
+		}
+		for ( auto itr = mOrderOfVisitation.begin(); itr != mOrderOfVisitation.end(); ++itr )
+		{
+			window->DrawDebugTextFmt( x, y, mSectorColors[ *itr ], "%d ", *itr );
+			x += 48.0f;
+		}
+	}
+}
+//---------------------------------------
@@ -28,10 +28,10 @@ public:
 		const std::string weaponPath = xmlItr.GetAttributeAsString( "weaponModel", "" );
 		const std::string deathPath = xmlItr.GetAttributeAsString( "deathModel", "" );
 
-		mDeathAnimName = xmlItr.GetAttributeAsString( "deathAnimName", "" );
-		mIdleAnimName = xmlItr.GetAttributeAsString( "idleAnimName", "" );
-		mPainAnimName = xmlItr.GetAttributeAsString( "painAnimName", "" );
-		mAttackAnimName = xmlItr.GetAttributeAsString( "attackAnimName", "" );
+		mDeathAnimName = SymbolTable::Intern( xmlItr.GetAttributeAsString( "deathAnimName", "" ) );
+		mIdleAnimName = SymbolTable::Intern( xmlItr.GetAttributeAsString( "idleAnimName", "" ) );
+		mPainAnimName = SymbolTable::Intern( xmlItr.GetAttributeAsString( "painAnimName", "" ) );
+		mAttackAnimName = SymbolTable::Intern( xmlItr.GetAttributeAsString( "attackAnimName", "" ) );
 
 		mBodyTextureIndex = xmlItr.GetAttributeAsInt( "bodyTextureIndex", 0 );
 		mHeadTextureIndex = xmlItr.GetAttributeAsInt( "headTextureIndex", 0 );
@@ -52,10 +52,10 @@ public:
 	MD2Model* mSpecialDeath;
 	int mBodyTextureIndex;
 	int mHeadTextureIndex;
-	std::string mDeathAnimName;
-	std::string mIdleAnimName;
-	std::string mPainAnimName;
-	std::string mAttackAnimName;
+	Symbol mDeathAnimName;
+	Symbol mIdleAnimName;
+	Symbol mPainAnimName;
+	Symbol mAttackAnimName;
 };
 //---------------------------------------
 class EnemyFactory
@@ -82,7 +82,7 @@ void Enemy::LoadEnemyTempaltesFromXml( const XmlReader::XmlReaderIterator& xmlIt
 	Entity::LoadTemplatesFromXml< Enemy >( xmlItr );
 }
 //---------------------------------------
-Enemy* Enemy::CreateEnemy( const std::string& templateName )
+Enemy* Enemy::CreateEnemy( Symbol templateName )
 {
 	return Entity::CreateEntity< Enemy >( templateName );
 }
@@ -201,7 +201,7 @@ void Enemy::TakeDamage( int damage, Entity* instigator )
 {
 	Hurt( damage );
 
-	if ( IsAlive() && mBodyAnim && !mBodyAnim->IsAnimationPlaying( mTemplate->mPainAnimName.c_str() ) )
+	if ( IsAlive() && mBodyAnim && !mBodyAnim->IsAnimationPlaying( mTemplate->mPainAnimName ) )
 	{
 		Face( instigator );
 
@@ -226,9 +226,9 @@ void Enemy::Kill()
 		mGibs->PlayAnim( "splt0", false );
 }
 //---------------------------------------
-void Enemy::OnAnimationComplete( const char* animName )
+void Enemy::OnAnimationComplete( Symbol animName )
 {
-	if ( !strcmp( animName, mTemplate->mPainAnimName.c_str() ) )
+	if ( animName == mTemplate->mPainAnimName )
 	{
 		PrepareFire();
 	}
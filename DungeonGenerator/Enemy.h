@@ -22,7 +22,7 @@ class Enemy
 	friend class EnemyFactory;
 public:
 	static void LoadEnemyTempaltesFromXml( const XmlReader::XmlReaderIterator& xmlItr );
-	static Enemy* CreateEnemy( const std::string& templateName );
+	static Enemy* CreateEnemy( Symbol templateName );
 
 	Enemy();
 	virtual ~Enemy();
@@ -36,7 +36,7 @@ public:
 	void TakeDamage( int damage, Entity* instigator );
 	void Kill();
 
-	void OnAnimationComplete( const char* animName );
+	void OnAnimationComplete( Symbol animName );
 
 private:
 	MD2Animation* mBodyAnim;
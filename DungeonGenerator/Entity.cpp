@@ -34,6 +34,7 @@ Entity::Entity()
 	, mDestroyed( false )
 	, mEntityType( ET_NONE )
 	, mRenderGroup( RG_SCENE )
+	, mSpawnRoom( -1 )
 {}
 //---------------------------------------
 Entity::~Entity()
@@ -39,6 +39,12 @@ public:
 		return EntityT::GetFactory()->CreateEntity( tempalteName );
 	}
 
+	template< typename EntityT >
+	static EntityT* CreateEntity( Symbol tempalteName )
+	{
+		return EntityT::GetFactory()->CreateEntity( tempalteName );
+	}
+
 	// Type this entity is
 	enum EntityType
 	{
@@ -70,6 +76,9 @@ public:
 	virtual void Update( float dt );
 	virtual void Draw( Window* window );
 	void SetParent( Entity* parent ) { mParent = parent; }
+	// Room of the floor this entity was spawned for, -1 if none
+	void SetSpawnRoom( int roomIndex ) { mSpawnRoom = roomIndex; }
+	int GetSpawnRoom() const { return mSpawnRoom; }
 	// Attachments will share lifespan with this entity
 	void AddAttachment( Entity* attachment ) { mAttachments.push_back( attachment ); }
 	// Player pressed action while aiming at this entity
@@ -109,6 +118,7 @@ protected:
 	std::vector< Entity* > mAttachments;
 	short mEntityType;
 	short mRenderGroup;
+	int mSpawnRoom;
 	bool mAlive;
 	bool mVisible;
 private:
@@ -9,7 +9,7 @@
 
 #include "XmlReader.h"
 #include "Logger.h"
-#include <map>
+#include "SymbolTable.h"
 
 // Base for all Entity Xml Templates
 // Contains some common data Entities generally use
@@ -18,6 +18,7 @@ class EntityTemplateBase
 public:
 	EntityTemplateBase( const XmlReader::XmlReaderIterator& xmlItr )
 		: mName( xmlItr.GetAttributeAsString( "name" ) )
+		, mNameId( SymbolTable::Intern( mName ) )
 		, mScale( xmlItr.GetAttributeAsFloat( "scale", 1.0f ) )
 		, mTranslate( _mTranslate )
 		, mRotate( _mRotate )
@@ -32,6 +33,7 @@ public:
 			_mRotate[i] = _tmp[i];
 	}
 	const std::string mName;
+	const Symbol mNameId;
 	const float mScale;
 	const float* const mTranslate;
 	const float* const mRotate;
@@ -53,26 +55,23 @@ public:
 
 	// Called by static Entity< EntityT >::CreateEntity()
 	// Null is returned if the Xml template did not exist
-	EntityT* CreateEntity( const std::string& name );
+	EntityT* CreateEntity( Symbol name );
+	EntityT* CreateEntity( const std::string& name ) { return CreateEntity( SymbolTable::Intern( name ) ); }
 
 protected:
-	EntityTemplateT* GetTemplate( const std::string& name );
+	EntityTemplateT* GetTemplate( Symbol name );
 
 	// This is where you construct the entity from the template data
 	virtual void InternalCreateEntity( EntityT& entity, const EntityTemplateT& entityTmpl ) = 0;
 
-	std::map< std::string, EntityTemplateT* > mEntityTemplates;
+	SymbolMap< EntityTemplateT > mEntityTemplates;
 };
 
 template< typename EntityT, typename EntityTemplateT >
 void EntityFactoryBase< EntityT, EntityTemplateT >::LoadTemplatesFromXml( const XmlReader::XmlReaderIterator& xmlItr )
 {
 	// Free old data when loading new data
-	for ( auto itr = mEntityTemplates.begin(); itr != mEntityTemplates.end(); ++itr )
-	{
-		delete itr->second;
-	}
-	mEntityTemplates.clear();
+	mEntityTemplates.DeleteAll();
 
 	// The assumption is the Xml data is formatted like so:
 	// <Entities>
@@ -86,26 +85,21 @@ void EntityFactoryBase< EntityT, EntityTemplateT >::LoadTemplatesFromXml( const
 		  itr.IsValid(); itr = itr.NextSibling() )
 	{
 		EntityTemplateT* entityTmpl = new EntityTemplateT( itr );
-		mEntityTemplates[ entityTmpl->mName ] = entityTmpl;
+		mEntityTemplates.Add( entityTmpl->mNameId, entityTmpl );
 	}
 }
 
 template< typename EntityT, typename EntityTemplateT >
-EntityTemplateT* EntityFactoryBase< EntityT, EntityTemplateT >::GetTemplate( const std::string& name )
+EntityTemplateT* EntityFactoryBase< EntityT, EntityTemplateT >::GetTemplate( Symbol name )
 {
-	EntityTemplateT* entityTmpl = 0;
-	auto itr = mEntityTemplates.find( name );
-	if ( itr != mEntityTemplates.end() )
-	{
-		entityTmpl = itr->second;
-	}
-	else
-		WarnFail( "Failed to get Entity Template '%s'\n", name.c_str() );
+	EntityTemplateT* entityTmpl = mEntityTemplates.Find( name );
+	if ( !entityTmpl )
+		WarnFail( "Failed to get Entity Template '%s'\n", SymbolTable::GetName( name ) );
 	return entityTmpl;
 }
 
 template< typename EntityT, typename EntityTemplateT >
-EntityT* EntityFactoryBase< EntityT, EntityTemplateT >::CreateEntity( const std::string& name )
+EntityT* EntityFactoryBase< EntityT, EntityTemplateT >::CreateEntity( Symbol name )
 {
 	EntityTemplateT* entityTmpl = GetTemplate( name );
 	EntityT* entity = 0;
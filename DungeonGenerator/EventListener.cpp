@@ -1,5 +1,4 @@
 #include "EventListener.h"
-#include "HashUtil.h"
 #include "Logger.h"
 
 #include <algorithm>
@@ -48,7 +47,7 @@ void EventListener::FireSignal( EventSignal signal )
 		for ( auto jtr = mSlots[ *itr ].begin(); jtr != mSlots[ *itr ].end(); ++jtr )
 		{
 			const EventData* data = *jtr;
-			DebugPrintf( "Fired event: %u\n", *itr );
+			DebugPrintf( "Fired event: %s\n", SymbolTable::GetName( *itr ) );
 			data->mListener->EvaluateCommands( data->mCommands );
 		}
 	}
@@ -56,7 +55,7 @@ void EventListener::FireSignal( EventSignal signal )
 //---------------------------------------
 EventTag EventListener::TagFromString( const std::string& stringTag )
 {
-	return GenerateHash( stringTag.c_str() );
+	return SymbolTable::Intern( stringTag );
 }
 //---------------------------------------
 EventSignal EventListener::SignalFromString( const std::string& stringSignal )
@@ -7,12 +7,14 @@
  
 #pragma once
 
+#include "SymbolTable.h"
+
 #include <map>
 #include <vector>
 #include <string>
 
 typedef int EventSignal;
-typedef unsigned int EventTag;
+typedef Symbol EventTag;
 
 class EventListener
 {
@@ -34,7 +36,7 @@ public:
 	void UnregisterSlots();
 	// Signal all objects listening for tag
 	void FireSignal( EventSignal signal );
-	// Hash a string into a tag
+	// Intern a string as a tag
 	static EventTag TagFromString( const std::string& stringTag );
 	// Get signal enum from string
 	static EventSignal SignalFromString( const std::string& stringSignal );
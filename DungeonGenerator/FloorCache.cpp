@@ -0,0 +1,121 @@
+#include "FloorCache.h"
+#include "DungeonGenerator.h"
+#include "DungeonArea.h"
+#include "FloorFile.h"
+#include "HashUtil.h"
+#include "Logger.h"
+#include "StringUtil.h"
+
+//---------------------------------------
+FloorCache::FloorCache()
+	: mHits( 0 )
+	, mMisses( 0 )
+{}
+//---------------------------------------
+void FloorCache::SetDirectory( const std::string& directory )
+{
+	mDirectory = directory;
+	if ( !mDirectory.empty() && mDirectory[ mDirectory.size() - 1 ] != '/' )
+		mDirectory += '/';
+}
+//---------------------------------------
+bool FloorCache::Generate( DungeonGenerator& generator, const DungeonArea& area )
+{
+	// A strategy's own settings are not part of the key
+	if ( generator.mLayout )
+	{
+		generator.Generate();
+		return false;
+	}
+
+	const uint64_t key = GetKey( generator, area );
+	const std::string filename = GetFilename( key );
+
+	if ( Load( filename, key, generator, area ) )
+	{
+		++mHits;
+		return true;
+	}
+
+	++mMisses;
+	generator.Generate();
+	if ( !Save( filename, key, generator ) )
+		DebugPrintf( "FloorCache: failed to write '%s'\n", filename.c_str() );
+	return false;
+}
+//---------------------------------------
+uint64_t FloorCache::GetKey( const DungeonGenerator& generator, const DungeonArea& area )
+{
+	const RNG::State rng = generator.mRNG.GetState();
+	const int32_t dimensions[] =
+	{
+		generator.mCurrentDepth,
+		generator.mWidth,
+		generator.mHeight,
+		generator.mMaxRoomCount,
+		generator.mEdgeExits,
+		generator.mLayoutOnly,
+		generator.mMinRoomSizeX,
+		generator.mMinRoomSizeY,
+		generator.mMaxRoomSizeX,
+		generator.mMaxRoomSizeY,
+	};
+	const float variance[] =
+	{
+		generator.mVerticalChance,
+		generator.mVerticalBiasUp,
+		generator.mVerticalBiasDown,
+		generator.mDirectionBias[0],
+		generator.mDirectionBias[1],
+		generator.mDoorChance,
+		generator.mChanceToLock,
+	};
+
+	uint64_t hash = GenerateHash64( &area.mContentHash, sizeof( area.mContentHash ) );
+	hash = GenerateHash64( &rng.mState, sizeof( rng.mState ), hash );
+	hash = GenerateHash64( &rng.mIncrement, sizeof( rng.mIncrement ), hash );
+	hash = GenerateHash64( &rng.mSeed, sizeof( rng.mSeed ), hash );
+	hash = GenerateHash64( &rng.mStream, sizeof( rng.mStream ), hash );
+	const RNG::State spawnRng = generator.mSpawnRNG.GetState();
+	hash = GenerateHash64( &spawnRng, sizeof( spawnRng ), hash );
+	hash = GenerateHash64( dimensions, sizeof( dimensions ), hash );
+	hash = GenerateHash64( variance, sizeof( variance ), hash );
+	return hash;
+}
+//---------------------------------------
+std::string FloorCache::GetFilename( uint64_t key ) const
+{
+	char name[32];
+	sprintf_s( name, sizeof( name ), "%016llx.floor", (unsigned long long) key );
+	return mDirectory + name;
+}
+//---------------------------------------
+bool FloorCache::Save( const std::string& filename, uint64_t key, const DungeonGenerator& generator ) const
+{
+	// Write to a temporary file so a reader never sees half a floor
+	const std::string tempFilename = filename + ".tmp";
+	if ( !FloorFile::Save( tempFilename.c_str(), generator, key ) )
+	{
+		remove( tempFilename.c_str() );
+		return false;
+	}
+
+	remove( filename.c_str() );
+	if ( rename( tempFilename.c_str(), filename.c_str() ) != 0 )
+	{
+		remove( tempFilename.c_str() );
+		return false;
+	}
+	return true;
+}
+//---------------------------------------
+bool FloorCache::Load( const std::string& filename, uint64_t key, DungeonGenerator& generator, const DungeonArea& area ) const
+{
+	FloorFile file;
+	if ( !file.Open( filename.c_str() ) || file.GetKey() != key )
+		return false;
+	if ( file.GetWidth() != generator.GetWidth() || file.GetHeight() != generator.GetHeight() )
+		return false;
+	return file.ApplyTo( generator, area );
+}
+//---------------------------------------
@@ -0,0 +1,48 @@
+/*
+ * Description :
+ *   Stores generated floors on disk so the same floor is only generated once.
+ *   A floor is keyed by a hash of the area file, the generator's RNG state,
+ *   its depth and size, which is everything Generate() depends on.
+ *   Floors are kept as FloorFiles, so a hit maps the file and applies it.
+ */
+ 
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+
+class DungeonGenerator;
+class DungeonArea;
+
+class FloorCache
+{
+public:
+	FloorCache();
+
+	// Floors are stored as files in directory, which must already exist
+	void SetDirectory( const std::string& directory );
+	const std::string& GetDirectory() const { return mDirectory; }
+
+	// Same as generator.Generate() but loads the floor if it was cached
+	// area must be the area loaded into generator
+	// Floors of a generator with a LayoutStrategy are always generated
+	// Returns true on a cache hit
+	bool Generate( DungeonGenerator& generator, const DungeonArea& area );
+
+	// Key of the floor generator would make next
+	static uint64_t GetKey( const DungeonGenerator& generator, const DungeonArea& area );
+
+	unsigned GetHitCount() const { return mHits; }
+	unsigned GetMissCount() const { return mMisses; }
+	void ResetCounters() { mHits = 0; mMisses = 0; }
+
+private:
+	std::string GetFilename( uint64_t key ) const;
+	bool Save( const std::string& filename, uint64_t key, const DungeonGenerator& generator ) const;
+	bool Load( const std::string& filename, uint64_t key, DungeonGenerator& generator, const DungeonArea& area ) const;
+
+	std::string mDirectory;
+	unsigned mHits;
+	unsigned mMisses;
+};
@@ -0,0 +1,575 @@
+#include "FloorFile.h"
+#include "DungeonGenerator.h"
+#include "DungeonArea.h"
+#include "Logger.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <map>
+#include <string>
+#include <vector>
+
+#ifdef WIN32
+#	include <windows.h>
+#else
+#	include <fcntl.h>
+#	include <sys/mman.h>
+#	include <sys/stat.h>
+#	include <unistd.h>
+#endif
+
+namespace
+{
+	// Size of one element of each section
+	const uint32 SECTION_ELEMENT_SIZES[ FloorSection_COUNT ] =
+	{
+		sizeof( char ),
+		sizeof( uint32 ),
+		sizeof( uint32 ),
+		sizeof( uint8 ),
+		sizeof( float ),
+		sizeof( int32 ),
+		sizeof( uint8 ),
+		sizeof( uint16 ),
+		sizeof( uint16 ),
+		sizeof( uint16 ),
+		sizeof( uint16 ),
+		sizeof( int16 ),
+		sizeof( FloorFileRoom ),
+		sizeof( FloorFileKey ),
+		sizeof( FloorFileSectorColor ),
+		sizeof( int32 ),
+	};
+
+	//---------------------------------------
+	// NUL terminated strings packed together, each name stored once
+	class StringTable
+	{
+	public:
+		uint32 Add( const std::string& str )
+		{
+			auto itr = mOffsets.find( str );
+			if ( itr != mOffsets.end() )
+				return itr->second;
+
+			const uint32 offset = (uint32) mChars.size();
+			mChars.insert( mChars.end(), str.begin(), str.end() );
+			mChars.push_back( '\0' );
+			mOffsets[ str ] = offset;
+			return offset;
+		}
+
+		const std::vector< char >& GetChars() const { return mChars; }
+
+	private:
+		std::vector< char > mChars;
+		std::map< std::string, uint32 > mOffsets;
+	};
+	//---------------------------------------
+	// Id of each distinct named thing in the order first seen
+	template< typename TNamed >
+	uint16 GetNameId( TNamed* named, std::map< TNamed*, uint16 >& ids, std::vector< uint32 >& names, StringTable& strings )
+	{
+		if ( !named )
+			return FLOOR_FILE_NO_ID;
+
+		auto itr = ids.find( named );
+		if ( itr != ids.end() )
+			return itr->second;
+
+		const uint16 id = (uint16) names.size();
+		ids[ named ] = id;
+		names.push_back( strings.Add( named->mName ) );
+		return id;
+	}
+	//---------------------------------------
+	template< typename T >
+	void AddSection( std::vector< uint8 >& buffer, FloorFileHeader& header, FloorFileSectionId id, const std::vector< T >& data )
+	{
+		// Every section starts 8 byte aligned so it can be used in place
+		buffer.resize( ( buffer.size() + 7 ) & ~(size_t) 7 );
+
+		FloorFileSection& section = header.mSections[ id ];
+		section.mOffset = buffer.size();
+		section.mCount = (uint32) data.size();
+		section.mElementSize = sizeof( T );
+		if ( !data.empty() )
+		{
+			const uint8* bytes = (const uint8*) &data[0];
+			buffer.insert( buffer.end(), bytes, bytes + data.size() * sizeof( T ) );
+		}
+	}
+	//---------------------------------------
+	// Resolve every name in a table against an area map, false if one is missing
+	template< typename TNamed >
+	bool ResolveNames( const FloorFile& file, uint32 count, const char* (FloorFile::*getName)( uint32 ) const,
+		const SymbolMap< TNamed >& map, std::vector< TNamed* >& resolved )
+	{
+		resolved.resize( count );
+		for ( uint32 i = 0; i < count; ++i )
+		{
+			const char* name = ( file.*getName )( i );
+			resolved[i] = map.Find( name );
+			if ( !resolved[i] )
+			{
+				WarnFail( "Floor uses '%s' which is not in the area\n", name );
+				return false;
+			}
+		}
+		return true;
+	}
+}
+
+//---------------------------------------
+FloorFile::FloorFile()
+	: mData( 0 )
+	, mSize( 0 )
+	, mMapped( false )
+#ifdef WIN32
+	, mFile( 0 )
+	, mMapping( 0 )
+#endif
+{}
+//---------------------------------------
+FloorFile::~FloorFile()
+{
+	Close();
+}
+//---------------------------------------
+bool FloorFile::Save( const char* filename, const DungeonGenerator& generator, uint64 key )
+{
+	const size_t tileCount = generator.mTiles.size();
+
+	FloorFileHeader header;
+	memset( &header, 0, sizeof( header ) );
+	header.mMagic = FLOOR_FILE_MAGIC;
+	header.mVersion = FLOOR_FILE_VERSION;
+	header.mHeaderSize = sizeof( FloorFileHeader );
+	header.mSectionCount = FloorSection_COUNT;
+	header.mKey = key;
+	header.mWidth = generator.mWidth;
+	header.mHeight = generator.mHeight;
+	header.mDepth = generator.mCurrentDepth;
+	header.mEntrance[0] = generator.mEntranceLocation.x;
+	header.mEntrance[1] = generator.mEntranceLocation.y;
+	header.mEntrance[2] = generator.mEntranceLocation.z;
+	header.mExit[0] = generator.mExitLocation.x;
+	header.mExit[1] = generator.mExitLocation.y;
+	header.mExit[2] = generator.mExitLocation.z;
+	const RNG::State rng = generator.mRNG.GetState();
+	header.mRNGState = rng.mState;
+	header.mRNGIncrement = rng.mIncrement;
+	header.mRNGSeed = rng.mSeed;
+	header.mRNGStream = rng.mStream;
+	const RNG::State spawnRng = generator.mSpawnRNG.GetState();
+	header.mSpawnRNGState = spawnRng.mState;
+	header.mSpawnRNGIncrement = spawnRng.mIncrement;
+	header.mSpawnRNGSeed = spawnRng.mSeed;
+	header.mSpawnRNGStream = spawnRng.mStream;
+
+	StringTable strings;
+	header.mFloorName = strings.Add( generator.mFloorName );
+
+	// Templates are stored by their index in the area
+	std::map< RoomTemplate*, uint16 > templateIds;
+	templateIds[ const_cast< RoomTemplate* >( &generator.mDummyRoomTmpl ) ] = FLOOR_FILE_DUMMY_TEMPLATE;
+	for ( size_t i = 0; i < generator.mRoomTemplates.size(); ++i )
+		templateIds[ generator.mRoomTemplates[i] ] = (uint16) i;
+	header.mTemplateCount = (uint32) generator.mRoomTemplates.size();
+
+	// Tiles
+	std::vector< uint32 > styleNames, objectNames;
+	std::map< TileStyle*, uint16 > styleIds;
+	std::map< TileObject*, uint16 > objectIds;
+	std::vector< uint8 > types( tileCount ), flags( tileCount );
+	std::vector< float > heights( tileCount );
+	std::vector< int32 > sectors( tileCount );
+	std::vector< uint16 > styles( tileCount ), objects( tileCount ), templates( tileCount ), doorStyles( tileCount );
+	std::vector< int16 > variants( tileCount );
+	for ( size_t i = 0; i < tileCount; ++i )
+	{
+		const Tile& tile = generator.mTiles[i];
+		types[i] = (uint8) tile.mType;
+		heights[i] = tile.z;
+		sectors[i] = tile.mSectorId;
+		flags[i] = ( tile.mLocked ? FloorTile_LOCKED : 0 ) | ( tile.mBlockObjectSpawn ? FloorTile_BLOCK_OBJECT_SPAWN : 0 );
+		styles[i] = GetNameId( tile.mStyle, styleIds, styleNames, strings );
+		objects[i] = GetNameId( tile.mObject, objectIds, objectNames, strings );
+		templates[i] = tile.mRoomTemplate ? templateIds[ tile.mRoomTemplate ] : FLOOR_FILE_NO_ID;
+		doorStyles[i] = GetNameId( tile.mDoorStyle, styleIds, styleNames, strings );
+		variants[i] = (int16) tile.mObjectVariant;
+	}
+	if ( styleNames.size() >= FLOOR_FILE_DUMMY_TEMPLATE || objectNames.size() >= FLOOR_FILE_DUMMY_TEMPLATE
+		|| header.mTemplateCount >= FLOOR_FILE_DUMMY_TEMPLATE )
+	{
+		WarnFail( "Too many styles, objects or rooms to save floor '%s'\n", filename );
+		return false;
+	}
+
+	// Rooms
+	std::vector< FloorFileRoom > rooms( generator.mRooms.size() );
+	for ( size_t i = 0; i < rooms.size(); ++i )
+	{
+		const Room& room = *generator.mRooms[i];
+		FloorFileRoom& record = rooms[i];
+		record.x = room.x;
+		record.y = room.y;
+		record.mWidth = room.GetWidth();
+		record.mHeight = room.GetHeight();
+		record.mSectorId = room.mSectorId;
+		record.mTemplate = room.mTemplate ? templateIds[ room.mTemplate ] : FLOOR_FILE_NO_ID;
+		record.mPad = 0;
+	}
+
+	// Keys and sectors
+	std::vector< FloorFileKey > keys;
+	for ( auto itr = generator.mKeysToSpawn.begin(); itr != generator.mKeysToSpawn.end(); ++itr )
+	{
+		const KeySpawn& spawn = itr->second;
+		FloorFileKey key = { spawn.mKeyId, spawn.mSectorId,
+			{ spawn.mLocation.x, spawn.mLocation.y, spawn.mLocation.z },
+			{ spawn.mColor.r, spawn.mColor.g, spawn.mColor.b, spawn.mColor.a } };
+		keys.push_back( key );
+	}
+	std::vector< FloorFileSectorColor > sectorColors;
+	for ( auto itr = generator.mSectorColors.begin(); itr != generator.mSectorColors.end(); ++itr )
+	{
+		const Color& c = itr->second;
+		FloorFileSectorColor color = { itr->first, { c.r, c.g, c.b, c.a } };
+		sectorColors.push_back( color );
+	}
+	std::vector< int32 > visitOrder( generator.mOrderOfVisitation.begin(), generator.mOrderOfVisitation.end() );
+
+	// Lay out the file
+	std::vector< uint8 > buffer( sizeof( FloorFileHeader ) );
+	AddSection( buffer, header, FloorSection_STRINGS, strings.GetChars() );
+	AddSection( buffer, header, FloorSection_STYLE_NAMES, styleNames );
+	AddSection( buffer, header, FloorSection_OBJECT_NAMES, objectNames );
+	AddSection( buffer, header, FloorSection_TILE_TYPES, types );
+	AddSection( buffer, header, FloorSection_TILE_HEIGHTS, heights );
+	AddSection( buffer, header, FloorSection_TILE_SECTORS, sectors );
+	AddSection( buffer, header, FloorSection_TILE_FLAGS, flags );
+	AddSection( buffer, header, FloorSection_TILE_STYLES, styles );
+	AddSection( buffer, header, FloorSection_TILE_OBJECTS, objects );
+	AddSection( buffer, header, FloorSection_TILE_TEMPLATES, templates );
+	AddSection( buffer, header, FloorSection_TILE_DOOR_STYLES, doorStyles );
+	AddSection( buffer, header, FloorSection_TILE_VARIANTS, variants );
+	AddSection( buffer, header, FloorSection_ROOMS, rooms );
+	AddSection( buffer, header, FloorSection_KEYS, keys );
+	AddSection( buffer, header, FloorSection_SECTOR_COLORS, sectorColors );
+	AddSection( buffer, header, FloorSection_VISIT_ORDER, visitOrder );
+	buffer.resize( ( buffer.size() + 7 ) & ~(size_t) 7 );
+	header.mFileSize = buffer.size();
+	memcpy( &buffer[0], &header, sizeof( header ) );
+
+	FILE* file = fopen( filename, "wb" );
+	if ( !file )
+		return false;
+	const bool ok = fwrite( &buffer[0], 1, buffer.size(), file ) == buffer.size();
+	return fclose( file ) == 0 && ok;
+}
+//---------------------------------------
+bool FloorFile::Open( const char* filename )
+{
+	Close();
+
+#ifdef WIN32
+	mFile = CreateFileA( filename, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0 );
+	if ( mFile == INVALID_HANDLE_VALUE )
+	{
+		mFile = 0;
+		return false;
+	}
+	LARGE_INTEGER size;
+	if ( !GetFileSizeEx( mFile, &size ) || size.QuadPart == 0 )
+	{
+		Close();
+		return false;
+	}
+	mMapping = CreateFileMappingA( mFile, 0, PAGE_READONLY, 0, 0, 0 );
+	const void* data = mMapping ? MapViewOfFile( mMapping, FILE_MAP_READ, 0, 0, 0 ) : 0;
+	if ( !data )
+	{
+		Close();
+		return false;
+	}
+	mSize = (size_t) size.QuadPart;
+#else
+	const int fd = open( filename, O_RDONLY );
+	if ( fd < 0 )
+		return false;
+	struct stat info;
+	if ( fstat( fd, &info ) != 0 || info.st_size == 0 )
+	{
+		close( fd );
+		return false;
+	}
+	void* data = mmap( 0, (size_t) info.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+	close( fd );
+	if ( data == MAP_FAILED )
+		return false;
+	mSize = (size_t) info.st_size;
+#endif
+
+	mData = (const uint8*) data;
+	mMapped = true;
+	if ( !Validate() )
+	{
+		WarnFail( "'%s' is not a valid floor file\n", filename );
+		Close();
+		return false;
+	}
+	return true;
+}
+//---------------------------------------
+bool FloorFile::OpenMemory( const void* data, size_t size )
+{
+	Close();
+	mData = (const uint8*) data;
+	mSize = size;
+	if ( !Validate() )
+	{
+		Close();
+		return false;
+	}
+	return true;
+}
+//---------------------------------------
+void FloorFile::Close()
+{
+	if ( mMapped )
+	{
+#ifdef WIN32
+		UnmapViewOfFile( mData );
+#else
+		munmap( (void*) mData, mSize );
+#endif
+	}
+#ifdef WIN32
+	if ( mMapping )
+		CloseHandle( mMapping );
+	if ( mFile )
+		CloseHandle( mFile );
+	mMapping = 0;
+	mFile = 0;
+#endif
+	mData = 0;
+	mSize = 0;
+	mMapped = false;
+}
+//---------------------------------------
+bool FloorFile::Validate() const
+{
+	if ( !mData || mSize < sizeof( FloorFileHeader ) || ( (size_t) mData & 7 ) != 0 )
+		return false;
+
+	const FloorFileHeader& header = GetHeader();
+	if ( header.mMagic != FLOOR_FILE_MAGIC
+		|| header.mVersion != FLOOR_FILE_VERSION
+		|| header.mHeaderSize != sizeof( FloorFileHeader )
+		|| header.mSectionCount != FloorSection_COUNT
+		|| header.mFileSize > mSize
+		|| header.mWidth < 0 || header.mHeight < 0 )
+		return false;
+
+	const uint64 tileCount = (uint64) header.mWidth * header.mHeight;
+	for ( int i = 0; i < FloorSection_COUNT; ++i )
+	{
+		const FloorFileSection& section = header.mSections[i];
+		if ( section.mElementSize != SECTION_ELEMENT_SIZES[i]
+			|| ( section.mOffset & 7 ) != 0
+			|| section.mOffset < sizeof( FloorFileHeader )
+			|| section.mOffset + (uint64) section.mCount * section.mElementSize > header.mFileSize )
+			return false;
+		if ( i >= FloorSection_TILE_TYPES && i <= FloorSection_TILE_VARIANTS && section.mCount != tileCount )
+			return false;
+	}
+
+	// Every name must point at a terminated string
+	const uint32 stringsSize = GetCount( FloorSection_STRINGS );
+	const char* strings = (const char*) GetSection( FloorSection_STRINGS );
+	if ( stringsSize == 0 || strings[ stringsSize - 1 ] != '\0' || header.mFloorName >= stringsSize )
+		return false;
+	for ( int table = FloorSection_STYLE_NAMES; table <= FloorSection_OBJECT_NAMES; ++table )
+	{
+		const uint32* offsets = (const uint32*) GetSection( (FloorFileSectionId) table );
+		for ( uint32 i = 0; i < GetCount( (FloorFileSectionId) table ); ++i )
+		{
+			if ( offsets[i] >= stringsSize )
+				return false;
+		}
+	}
+	return true;
+}
+//---------------------------------------
+const char* FloorFile::GetString( uint32 offset ) const
+{
+	return (const char*) GetSection( FloorSection_STRINGS ) + offset;
+}
+//---------------------------------------
+const char* FloorFile::GetName( FloorFileSectionId table, uint32 id ) const
+{
+	if ( id >= GetCount( table ) )
+		return 0;
+	return GetString( ( (const uint32*) GetSection( table ) )[ id ] );
+}
+//---------------------------------------
+glm::vec3 FloorFile::GetEntrance() const
+{
+	const float* v = GetHeader().mEntrance;
+	return glm::vec3( v[0], v[1], v[2] );
+}
+//---------------------------------------
+glm::vec3 FloorFile::GetExit() const
+{
+	const float* v = GetHeader().mExit;
+	return glm::vec3( v[0], v[1], v[2] );
+}
+//---------------------------------------
+bool FloorFile::ApplyTo( DungeonGenerator& generator, const DungeonArea& area ) const
+{
+	if ( !IsOpen() )
+		return false;
+
+	// Resolve names before touching the generator
+	std::vector< TileStyle* > styles;
+	std::vector< TileObject* > objects;
+	if ( !ResolveNames( *this, GetStyleCount(), &FloorFile::GetStyleName, area.mStyleMap, styles )
+		|| !ResolveNames( *this, GetObjectCount(), &FloorFile::GetObjectName, area.mObjectMap, objects ) )
+		return false;
+
+	const uint32 templateCount = GetTemplateCount();
+	if ( templateCount != generator.mRoomTemplates.size() )
+	{
+		WarnFail( "Floor was made from an area with %u rooms, not %u\n", templateCount, (unsigned) generator.mRoomTemplates.size() );
+		return false;
+	}
+
+	const FloorFileHeader& header = GetHeader();
+	const int width = header.mWidth;
+	const int height = header.mHeight;
+	if ( width != generator.mWidth || height != generator.mHeight )
+		generator.Resize( width, height );
+
+	generator.Clear();
+	generator.mDoors.clear();
+	generator.mOrderOfVisitation.clear();
+	generator.mTimings = GenerationTimings();
+	generator.mPhase = Phase_DONE;
+	generator.mCurrentDepth = header.mDepth;
+	generator.mFloorName = GetFloorName();
+	generator.mEntranceLocation = GetEntrance();
+	generator.mExitLocation = GetExit();
+
+	// Tiles
+	const uint8* types = GetTileTypes();
+	const float* heights = GetTileHeights();
+	const int32* sectors = GetTileSectors();
+	const uint8* flags = GetTileFlags();
+	const uint16* tileStyles = GetTileStyles();
+	const uint16* tileObjects = GetTileObjects();
+	const uint16* tileTemplates = GetTileTemplates();
+	const uint16* tileDoorStyles = GetTileDoorStyles();
+	const int16* tileVariants = GetTileVariants();
+	const size_t tileCount = generator.mTiles.size();
+	for ( size_t i = 0; i < tileCount; ++i )
+	{
+		const uint16 style = tileStyles[i];
+		const uint16 object = tileObjects[i];
+		const uint16 tmpl = tileTemplates[i];
+		const uint16 doorStyle = tileDoorStyles[i];
+		if ( ( style != FLOOR_FILE_NO_ID && style >= styles.size() )
+			|| ( doorStyle != FLOOR_FILE_NO_ID && doorStyle >= styles.size() )
+			|| ( object != FLOOR_FILE_NO_ID && object >= objects.size() )
+			|| ( tmpl != FLOOR_FILE_NO_ID && tmpl != FLOOR_FILE_DUMMY_TEMPLATE && tmpl >= templateCount ) )
+		{
+			generator.Clear();
+			return false;
+		}
+
+		Tile& tile = generator.mTiles[i];
+		tile.SetLocation( (int) i / height, (int) i % height );
+		tile.mType = types[i];
+		tile.z = heights[i];
+		tile.mSectorId = sectors[i];
+		tile.mLocked = ( flags[i] & FloorTile_LOCKED ) != 0;
+		tile.mBlockObjectSpawn = ( flags[i] & FloorTile_BLOCK_OBJECT_SPAWN ) != 0;
+		tile.mStyle = style != FLOOR_FILE_NO_ID ? styles[ style ] : 0;
+		tile.mObject = object != FLOOR_FILE_NO_ID ? objects[ object ] : 0;
+		tile.mDoorStyle = doorStyle != FLOOR_FILE_NO_ID ? styles[ doorStyle ] : 0;
+		tile.mObjectVariant = tileVariants[i];
+		tile.mRoomTemplate = tmpl == FLOOR_FILE_NO_ID ? 0
+			: tmpl == FLOOR_FILE_DUMMY_TEMPLATE ? &generator.mDummyRoomTmpl
+			: generator.mRoomTemplates[ tmpl ];
+	}
+
+	// Rooms keep a copy of their tiles as AddRoom would have left them
+	const FloorFileRoom* rooms = GetRooms();
+	for ( uint32 i = 0; i < GetRoomCount(); ++i )
+	{
+		const FloorFileRoom& record = rooms[i];
+		if ( record.x < 0 || record.y < 0 || record.mWidth <= 0 || record.mHeight <= 0
+			|| record.x + record.mWidth > width || record.y + record.mHeight > height )
+			continue;
+
+		Room* room = new Room();
+		room->Resize( record.mWidth, record.mHeight );
+		room->x = record.x;
+		room->y = record.y;
+		room->mSectorId = record.mSectorId;
+		room->mIndex = (int) generator.mRooms.size();
+		room->mTemplate = record.mTemplate == FLOOR_FILE_DUMMY_TEMPLATE ? &generator.mDummyRoomTmpl
+			: record.mTemplate < templateCount ? generator.mRoomTemplates[ record.mTemplate ] : 0;
+		for ( int x = 0; x < record.mWidth; ++x )
+		{
+			for ( int y = 0; y < record.mHeight; ++y )
+			{
+				Tile& tile = generator.GetTileAt( record.x + x, record.y + y );
+				Tile& roomTile = room->GetTileAt( x, y );
+				roomTile = tile;
+				roomTile.SetLocation( x, y );
+				tile.mRoom = room;
+			}
+		}
+		generator.mFreeSpace.Occupy( record.x, record.y, record.mWidth, record.mHeight );
+		generator.mRooms.push_back( room );
+	}
+
+	// Keys and sectors
+	const FloorFileKey* keys = GetKeys();
+	for ( uint32 i = 0; i < GetKeyCount(); ++i )
+	{
+		const FloorFileKey& record = keys[i];
+		KeySpawn& key = generator.mKeysToSpawn[ record.mKeyId ];
+		key.mKeyId = record.mKeyId;
+		key.mSectorId = record.mSectorId;
+		key.mLocation = glm::vec3( record.mLocation[0], record.mLocation[1], record.mLocation[2] );
+		key.mColor = Color( record.mColor[0], record.mColor[1], record.mColor[2], record.mColor[3] );
+	}
+	const FloorFileSectorColor* sectorColors = GetSectorColors();
+	for ( uint32 i = 0; i < GetSectorColorCount(); ++i )
+	{
+		const float* c = sectorColors[i].mColor;
+		generator.mSectorColors[ sectorColors[i].mSectorId ] = Color( c[0], c[1], c[2], c[3] );
+	}
+	const int32* visitOrder = GetVisitOrder();
+	generator.mOrderOfVisitation.assign( visitOrder, visitOrder + GetVisitOrderCount() );
+
+	generator.GatherDoors();
+	generator.BuildSectorGraph();
+	generator.ProveSolvable();
+
+	RNG::State rng;
+	rng.mState = header.mRNGState;
+	rng.mIncrement = header.mRNGIncrement;
+	rng.mSeed = header.mRNGSeed;
+	rng.mStream = header.mRNGStream;
+	generator.mRNG.SetState( rng );
+	rng.mState = header.mSpawnRNGState;
+	rng.mIncrement = header.mSpawnRNGIncrement;
+	rng.mSeed = header.mSpawnRNGSeed;
+	rng.mStream = header.mSpawnRNGStream;
+	generator.mSpawnRNG.SetState( rng );
+	return true;
+}
+//---------------------------------------
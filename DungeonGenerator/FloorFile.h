@@ -0,0 +1,195 @@
+/*
+ * Description :
+ *   Versioned binary format for a generated floor.
+ *   The file is a header followed by flat sections, each 8 byte aligned and
+ *   stored little endian, so a mapped file can be used in place without
+ *   parsing. Tile sections hold one value per tile at index x * height + y.
+ *   Styles and objects are stored by id into name tables, room templates
+ *   by their index in the area since they need not be named.
+ */
+
+#pragma once
+
+#include "Types.h"
+
+#include <stddef.h>
+#include <glm/glm.hpp>
+
+class DungeonGenerator;
+class DungeonArea;
+
+static const uint32 FLOOR_FILE_MAGIC = 0x4C464744;	// 'DGFL'
+static const uint32 FLOOR_FILE_VERSION = 4;	// 2: locked door tiles hold the id of their key, 3: spawn RNG, 4: door styles and spawner variants
+
+// Tile style, object or room template id for no entry
+static const uint16 FLOOR_FILE_NO_ID = 0xFFFF;
+// Tile template id for the generator's corridor template
+static const uint16 FLOOR_FILE_DUMMY_TEMPLATE = 0xFFFE;
+
+//---------------------------------------
+enum FloorFileSectionId
+{
+	FloorSection_STRINGS,			// char, NUL terminated names
+	FloorSection_STYLE_NAMES,		// uint32 offset into strings per style id
+	FloorSection_OBJECT_NAMES,		// uint32 offset into strings per object id
+	FloorSection_TILE_TYPES,		// uint8 Tile::TileType
+	FloorSection_TILE_HEIGHTS,		// float
+	FloorSection_TILE_SECTORS,		// int32
+	FloorSection_TILE_FLAGS,		// uint8 FloorTileFlags
+	FloorSection_TILE_STYLES,		// uint16 style id
+	FloorSection_TILE_OBJECTS,		// uint16 object id
+	FloorSection_TILE_TEMPLATES,	// uint16 room template index
+	FloorSection_TILE_DOOR_STYLES,	// uint16 style id
+	FloorSection_TILE_VARIANTS,		// int16 spawner variant
+	FloorSection_ROOMS,				// FloorFileRoom
+	FloorSection_KEYS,				// FloorFileKey
+	FloorSection_SECTOR_COLORS,		// FloorFileSectorColor
+	FloorSection_VISIT_ORDER,		// int32 sector id
+	FloorSection_COUNT
+};
+
+enum FloorTileFlags
+{
+	FloorTile_LOCKED				= 1 << 0,
+	FloorTile_BLOCK_OBJECT_SPAWN	= 1 << 1,
+};
+
+//---------------------------------------
+struct FloorFileSection
+{
+	uint64 mOffset;			// From the start of the file
+	uint32 mCount;			// Number of elements
+	uint32 mElementSize;
+};
+
+//---------------------------------------
+struct FloorFileHeader
+{
+	uint32 mMagic;
+	uint32 mVersion;
+	uint32 mHeaderSize;
+	uint32 mSectionCount;
+	uint64 mFileSize;
+	uint64 mKey;			// Defined by the writer, FloorCache stores its key here
+	int32 mWidth;
+	int32 mHeight;
+	int32 mDepth;
+	uint32 mFloorName;		// Offset into strings
+	uint32 mTemplateCount;	// Room templates in the area the floor was made from
+	uint32 mPad;
+	float mEntrance[3];
+	float mExit[3];
+	uint64 mRNGState;		// Generator RNG after the floor was made
+	uint64 mRNGIncrement;
+	uint64 mRNGSeed;
+	uint64 mRNGStream;
+	uint64 mSpawnRNGState;	// Generator spawn RNG after the floor was made
+	uint64 mSpawnRNGIncrement;
+	uint64 mSpawnRNGSeed;
+	uint64 mSpawnRNGStream;
+	FloorFileSection mSections[ FloorSection_COUNT ];
+};
+
+//---------------------------------------
+struct FloorFileRoom
+{
+	int32 x, y;
+	int32 mWidth, mHeight;
+	int32 mSectorId;
+	uint16 mTemplate;		// Room template index
+	uint16 mPad;
+};
+
+//---------------------------------------
+struct FloorFileKey
+{
+	int32 mKeyId;			// Sector the key unlocks
+	int32 mSectorId;		// Sector the key was placed in
+	float mLocation[3];
+	float mColor[4];		// rgba
+};
+
+//---------------------------------------
+struct FloorFileSectorColor
+{
+	int32 mSectorId;
+	float mColor[4];		// rgba
+};
+
+//---------------------------------------
+// Read only view of a floor file
+// Open() maps the file, nothing is copied or parsed beyond checking the layout
+class FloorFile
+{
+public:
+	FloorFile();
+	~FloorFile();
+
+	// Write the generator's current floor to filename
+	static bool Save( const char* filename, const DungeonGenerator& generator, uint64 key=0 );
+
+	// Map filename and check its layout
+	bool Open( const char* filename );
+	// Use a floor already in memory, data must be 8 byte aligned and outlive this
+	bool OpenMemory( const void* data, size_t size );
+	void Close();
+	bool IsOpen() const { return mData != 0; }
+
+	// Replace the generator's floor with this one
+	// area must be the area loaded into generator
+	bool ApplyTo( DungeonGenerator& generator, const DungeonArea& area ) const;
+
+	const FloorFileHeader& GetHeader() const { return *(const FloorFileHeader*) mData; }
+	int GetWidth() const { return GetHeader().mWidth; }
+	int GetHeight() const { return GetHeader().mHeight; }
+	int GetDepth() const { return GetHeader().mDepth; }
+	uint64 GetKey() const { return GetHeader().mKey; }
+	const char* GetFloorName() const { return GetString( GetHeader().mFloorName ); }
+	glm::vec3 GetEntrance() const;
+	glm::vec3 GetExit() const;
+
+	// Tile sections, one value per tile at x * height + y
+	const uint8* GetTileTypes() const { return (const uint8*) GetSection( FloorSection_TILE_TYPES ); }
+	const float* GetTileHeights() const { return (const float*) GetSection( FloorSection_TILE_HEIGHTS ); }
+	const int32* GetTileSectors() const { return (const int32*) GetSection( FloorSection_TILE_SECTORS ); }
+	const uint8* GetTileFlags() const { return (const uint8*) GetSection( FloorSection_TILE_FLAGS ); }
+	const uint16* GetTileStyles() const { return (const uint16*) GetSection( FloorSection_TILE_STYLES ); }
+	const uint16* GetTileObjects() const { return (const uint16*) GetSection( FloorSection_TILE_OBJECTS ); }
+	const uint16* GetTileTemplates() const { return (const uint16*) GetSection( FloorSection_TILE_TEMPLATES ); }
+	const uint16* GetTileDoorStyles() const { return (const uint16*) GetSection( FloorSection_TILE_DOOR_STYLES ); }
+	const int16* GetTileVariants() const { return (const int16*) GetSection( FloorSection_TILE_VARIANTS ); }
+
+	// Name tables, returns null for an id out of range
+	uint32 GetStyleCount() const { return GetCount( FloorSection_STYLE_NAMES ); }
+	const char* GetStyleName( uint32 id ) const { return GetName( FloorSection_STYLE_NAMES, id ); }
+	uint32 GetObjectCount() const { return GetCount( FloorSection_OBJECT_NAMES ); }
+	const char* GetObjectName( uint32 id ) const { return GetName( FloorSection_OBJECT_NAMES, id ); }
+	uint32 GetTemplateCount() const { return GetHeader().mTemplateCount; }
+
+	uint32 GetRoomCount() const { return GetCount( FloorSection_ROOMS ); }
+	const FloorFileRoom* GetRooms() const { return (const FloorFileRoom*) GetSection( FloorSection_ROOMS ); }
+	uint32 GetKeyCount() const { return GetCount( FloorSection_KEYS ); }
+	const FloorFileKey* GetKeys() const { return (const FloorFileKey*) GetSection( FloorSection_KEYS ); }
+	uint32 GetSectorColorCount() const { return GetCount( FloorSection_SECTOR_COLORS ); }
+	const FloorFileSectorColor* GetSectorColors() const { return (const FloorFileSectorColor*) GetSection( FloorSection_SECTOR_COLORS ); }
+	uint32 GetVisitOrderCount() const { return GetCount( FloorSection_VISIT_ORDER ); }
+	const int32* GetVisitOrder() const { return (const int32*) GetSection( FloorSection_VISIT_ORDER ); }
+
+private:
+	FloorFile( const FloorFile& );
+	FloorFile& operator=( const FloorFile& );
+
+	bool Validate() const;
+	const void* GetSection( FloorFileSectionId id ) const { return mData + GetHeader().mSections[ id ].mOffset; }
+	uint32 GetCount( FloorFileSectionId id ) const { return GetHeader().mSections[ id ].mCount; }
+	const char* GetString( uint32 offset ) const;
+	const char* GetName( FloorFileSectionId table, uint32 id ) const;
+
+	const uint8* mData;
+	size_t mSize;
+	bool mMapped;
+#ifdef WIN32
+	void* mFile;
+	void* mMapping;
+#endif
+};
@@ -0,0 +1,82 @@
+#include "FreeSpaceIndex.h"
+
+#include <algorithm>
+
+//---------------------------------------
+FreeSpaceIndex::FreeSpaceIndex()
+	: mWidth( 0 )
+	, mHeight( 0 )
+{}
+//---------------------------------------
+void FreeSpaceIndex::Resize( int w, int h )
+{
+	mWidth = w;
+	mHeight = h;
+	mTree.assign( ( w + 1 ) * ( h + 1 ), 0 );
+	mOccupied.assign( w * h, 0 );
+}
+//---------------------------------------
+void FreeSpaceIndex::Clear()
+{
+	std::fill( mTree.begin(), mTree.end(), 0 );
+	std::fill( mOccupied.begin(), mOccupied.end(), 0 );
+}
+//---------------------------------------
+void FreeSpaceIndex::Occupy( int x, int y, int w, int h )
+{
+	const int startX = std::max( x, 0 );
+	const int startY = std::max( y, 0 );
+	const int endX = std::min( x + w, mWidth );
+	const int endY = std::min( y + h, mHeight );
+
+	for ( int cx = startX; cx < endX; ++cx )
+	{
+		for ( int cy = startY; cy < endY; ++cy )
+		{
+			unsigned char& occupied = mOccupied[ cx * mHeight + cy ];
+			if ( !occupied )
+			{
+				occupied = 1;
+				AddToTree( cx, cy, 1 );
+			}
+		}
+	}
+}
+//---------------------------------------
+int FreeSpaceIndex::CountOccupied( int x, int y, int w, int h ) const
+{
+	return PrefixCount( x + w, y + h )
+		 - PrefixCount( x, y + h )
+		 - PrefixCount( x + w, y )
+		 + PrefixCount( x, y );
+}
+//---------------------------------------
+bool FreeSpaceIndex::IsFree( int x, int y, int w, int h ) const
+{
+	if ( x < 0 || y < 0 || w <= 0 || h <= 0 || x + w > mWidth || y + h > mHeight )
+		return false;
+	return CountOccupied( x, y, w, h ) == 0;
+}
+//---------------------------------------
+int FreeSpaceIndex::PrefixCount( int x, int y ) const
+{
+	int count = 0;
+	for ( int i = x; i > 0; i -= i & -i )
+	{
+		const int row = i * ( mHeight + 1 );
+		for ( int j = y; j > 0; j -= j & -j )
+			count += mTree[ row + j ];
+	}
+	return count;
+}
+//---------------------------------------
+void FreeSpaceIndex::AddToTree( int x, int y, int value )
+{
+	for ( int i = x + 1; i <= mWidth; i += i & -i )
+	{
+		const int row = i * ( mHeight + 1 );
+		for ( int j = y + 1; j <= mHeight; j += j & -j )
+			mTree[ row + j ] += value;
+	}
+}
+//---------------------------------------
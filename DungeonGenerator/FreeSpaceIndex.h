@@ -0,0 +1,44 @@
+/*
+ * Description :
+ *   Tracks which cells of a grid are occupied by rooms.
+ *   Backed by a 2D Fenwick tree so "is this rectangle empty" is
+ *   answered in O(log w * log h) instead of scanning every cell.
+ */
+ 
+#pragma once
+
+#include <vector>
+
+class FreeSpaceIndex
+{
+public:
+	FreeSpaceIndex();
+
+	// Resize the index and mark every cell as free
+	void Resize( int w, int h );
+	// Mark every cell as free
+	void Clear();
+
+	// Mark a rectangle of cells as occupied
+	// Cells outside the grid are ignored
+	void Occupy( int x, int y, int w, int h );
+
+	// Number of occupied cells in the rectangle
+	// The rectangle must be inside the grid
+	int CountOccupied( int x, int y, int w, int h ) const;
+
+	// True if the rectangle is inside the grid and has no occupied cells
+	bool IsFree( int x, int y, int w, int h ) const;
+
+	inline int GetWidth() const { return mWidth; }
+	inline int GetHeight() const { return mHeight; }
+
+private:
+	// Number of occupied cells in [0,x) x [0,y)
+	int PrefixCount( int x, int y ) const;
+	void AddToTree( int x, int y, int value );
+
+	int mWidth, mHeight;
+	std::vector< int > mTree;				// 1 based Fenwick tree, (mWidth + 1) * (mHeight + 1)
+	std::vector< unsigned char > mOccupied;	// So cells are only counted once
+};
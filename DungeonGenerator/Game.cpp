@@ -22,6 +22,10 @@
 #include "Logger.h"
 #include "Key.h"
 #include "Enemy.h"
+#include "Pickup.h"
+#include "Door.h"
+#include "MapTile.h"
+#include "MapObject.h"
 #include "Weapon.h"
 
 //---------------------------------------
@@ -38,8 +42,12 @@ Game* Game::Get()
 
 //---------------------------------------
 Game::Game()
+	: mCurrentGenerator( 0 )
+	, mNextFloorPending( false )
 {
 	Game::mInstance = this;
+	mGenerator = &mGenerators[ mCurrentGenerator ];
+	mArea = &mAreas[ mCurrentGenerator ];
 
 	mWindow.Init();
 	mRunning = false;
@@ -57,7 +65,7 @@ Game::Game()
 	mCamera.position.y = 0;
 	mCamera.position.z = 0;
 
-	mCamera.map = &mGenerator;
+	mCamera.map = mGenerator;
 
 	mWindow.SetCamera( &mCamera );
 
@@ -66,7 +74,7 @@ Game::Game()
 	//Weapon* shotty = Weapon::CreateWeapon( "shotgun" );
 	//mPlayer.GiveWeapon( shotty );
 	
-	mMinimap.SetMap( &mGenerator );
+	mMinimap.SetMap( mGenerator );
 
 	// Lighting shaders
 	char* basicVertTxt;
@@ -94,6 +102,7 @@ Game::Game()
 //---------------------------------------
 Game::~Game()
 {
+	CancelNextFloor();
 	mWindow.Destroy();
 }
 //---------------------------------------
@@ -111,301 +120,36 @@ void Game::LoadAssets()
 //---------------------------------------
 void Game::LoadArea( const char* filename )
 {
-	XmlReader reader( filename );
+	// Anything pre generated came from the old area
+	CancelNextFloor();
+	// The other generator holds the old data even if the filename matches, i.e. on a reload
+	mAreaFilenames[ 1 - mCurrentGenerator ].clear();
 
-	// <Area>
-	XmlReader::XmlReaderIterator itr = reader.ReadRoot();
-	if ( itr.IsValid() )
+	if ( LoadAreaInto( mCurrentGenerator, filename ) )
+		ApplyAreaLighting();
+}
+//---------------------------------------
+bool Game::LoadAreaInto( int slot, const std::string& filename )
+{
+	// Meshes are created here so this must be called from the main thread
+	if ( mAreas[ slot ].Load( filename.c_str(), mGenerators[ slot ], &Mesh::CreateMesh ) )
 	{
-		const char* areaName = itr.GetAttributeAsCString( "name", "Dungeon" );
-		int areaMaxRooms = itr.GetAttributeAsInt( "maxRooms", 0 );
-		std::vector< int > minRoomSize, maxRoomSize, areaSize;
-		itr.GetAttributeAsCSV( "minRoomSize", minRoomSize );
-		itr.GetAttributeAsCSV( "maxRoomSize", maxRoomSize );
-		itr.GetAttributeAsCSV( "areaSize", areaSize );
-		float verticalness = itr.GetAttributeAsFloat( "verticalness", 0.5f );
-		float verticalBiasUp = itr.GetAttributeAsFloat( "verticalness", 0.5f );
-		float verticalBiasDown = itr.GetAttributeAsFloat( "verticalBiasDown", 0.5f );
-		float doorChance = itr.GetAttributeAsFloat( "doorChance", 0.5f );
-		float doorLockChance = itr.GetAttributeAsFloat( "doorLockChance", 0.5f );
-		std::vector< float > ambientColor;
-		itr.GetAttributeAsCSV( "ambientLightColor", ambientColor, "1,1,1" );
-		float ambientIntensity = itr.GetAttributeAsFloat( "ambientLightIntensity", 1.0f );
-		mEndDepth = itr.GetAttributeAsInt( "endDepth", 0 );
-		mNextArea = itr.GetAttributeAsString( "nextArea", "" );
-
-		if ( mNextArea.empty() )
-			mEndDepth = 0;
-		else
-			mNextArea = "../data/" + mNextArea;
-
-		mGenerator.Init( areaSize[0], areaSize[1], areaMaxRooms, minRoomSize[0], maxRoomSize[0], minRoomSize[1], maxRoomSize[1] );
-		mGenerator.SetVerticalness( verticalness );
-		mGenerator.SetVerticalBias( verticalBiasUp, verticalBiasDown );
-		mGenerator.SetDoorChance( doorChance );
-		mGenerator.SetDoorLockChance( doorLockChance );
-		mGenerator.SetName( areaName );
-
-		mGlobalLightColor = glm::vec3( ambientColor[0], ambientColor[1], ambientColor[2] );
-		mGlobalLightIntensity = ambientIntensity;
-
-		mGlobalLight.Color.SetValue( mGlobalLightColor );
-		mGlobalLight.Intensity.SetValue( mGlobalLightIntensity );
-
-		// Free old mappings of styles and object templates
-		for ( auto i = mStyleMap.begin(); i != mStyleMap.end(); ++i )
-		{
-			delete i->second;
-		}
-		mStyleMap.clear();
-
-		for ( auto i = mMapObjectMap.begin(); i != mMapObjectMap.end(); ++i )
-		{
-			delete i->second;
-		}
-		mMapObjectMap.clear();
-
-		for ( auto i = mSpawnListMap.begin(); i != mSpawnListMap.end(); ++i )
-		{
-			delete i->second;
-		}
-		mSpawnListMap.clear();
-		
-		for ( auto i = mUseableObjects.begin(); i != mUseableObjects.end(); ++i )
-		{
-			delete *i;
-		}
-		mUseableObjects.clear();
-
-		// <Styles>
-		XmlReader::XmlReaderIterator styleslItr = itr.NextChild( "Styles" );
-		if ( styleslItr.IsValid() )
-		{
-			std::string prefix = "../data/";
-			for ( XmlReader::XmlReaderIterator styleItr = styleslItr.NextChild( "Style" );
-				styleItr.IsValid(); styleItr = styleItr.NextSibling() )
-			{
-				TileStyle* style = new TileStyle;
-				style->mUsageId = TileStyle::GetUsageIdFromString( styleItr.GetAttributeAsString( "usage", "none" ) );
-				style->mMesh = Mesh::CreateMesh( prefix + styleItr.GetAttributeAsString( "file" ) );
-				style->mName = styleItr.GetAttributeAsString( "name" );
-				style->mCanBeLocked = styleItr.GetAttributeAsBool( "canBeLocked", true );
-				style->mForceLocked = styleItr.GetAttributeAsBool( "forceLocked", false );
-				style->LoadRulesFromXML( styleItr, &mGenerator, mStyleMap );
-				style->LoadEventsFromXML( styleItr );
-				mStyleMap[ style->mName ] = style;
-			}
-		}
-
-		// <SpawnList>
-		XmlReader::XmlReaderIterator spawnListsItr = itr.NextChild( "SpawnLists" );
-		if ( spawnListsItr.IsValid() )
-		{
-			for ( XmlReader::XmlReaderIterator spawnListItr = spawnListsItr.NextChild( "SpawnList" );
-				spawnListItr.IsValid(); spawnListItr = spawnListItr.NextSibling() )
-			{
-				std::string listName = spawnListItr.GetAttributeAsString( "name" );
-				SpawnList* spawnList = new SpawnList;
-				spawnListItr.GetAttributeAsCSV( "list", spawnList->mList );
-				mSpawnListMap[ listName ] = spawnList;
-
-				// Copy from another list
-				std::vector< std::string > listToExtendFrom;
-				spawnListItr.GetAttributeAsCSV( "extendsLists", listToExtendFrom );
-				for ( auto listItr = listToExtendFrom.begin(); listItr != listToExtendFrom.end(); ++listItr )
-				{
-					SpawnList* list = mSpawnListMap[ *listItr ];
-					if ( list )
-					{
-						spawnList->mList.insert( spawnList->mList.end(), list->mList.begin(), list->mList.end() );
-					}
-					else
-					{
-						WarnFail( "Could not find SpawnList of name '%s'. Did you define it after this SpawnList?\n", listItr->c_str() );
-					}
-				}
-			}
-		}
-
-		// <Objects>
-		XmlReader::XmlReaderIterator objectslItr = itr.NextChild( "Objects" );
-		if ( objectslItr.IsValid() )
-		{
-			std::string prefix = "../data/";
-			for ( XmlReader::XmlReaderIterator objectItr = objectslItr.NextChild( "Object" );
-				objectItr.IsValid(); objectItr = objectItr.NextSibling() )
-			{
-				std::string name = objectItr.GetAttributeAsString( "name" );
-				int usage = TileObject::GetUsageIdFromString( objectItr.GetAttributeAsString( "usage", "none" ) );
-				TileObject* object;
-
-				// Object specific properties
-				if ( usage == TileObject::Usage_STATIC )
-				{
-					object = new TileObject();
-					object->mMesh = Mesh::CreateMesh( prefix + objectItr.GetAttributeAsString( "file" ) );
-				}
-				else if ( usage == TileObject::Usage_PICKUP )
-				{
-					object = new TileObject_Pickup();
-					object->mUsageId = usage;
-					//object->mMesh = Mesh::CreateMesh( prefix + objectItr.GetAttributeAsString( "file" ) );
-
-					TileObject_Pickup* pickupObject = (TileObject_Pickup*) object;
-					pickupObject->mPickupName = objectItr.GetAttributeAsString( "pickupName" );
-				}
-				else if ( usage == TileObject::Usage_LIGHT )
-				{
-					object = new TileObject_Light();
-					TileObject_Light* lightObject = (TileObject_Light*) object;
-
-					std::vector< float > color;
-					objectItr.GetAttributeAsCSV( "lightColor", color, "1,1,1" );
-					if ( color.size() == 3 )
-						lightObject->mLightColor = Color( color[0], color[1], color[2] );
-					else
-						DebugPrintf( "TileObject: invalid color - must be 'r,g,b'\n" );
-					lightObject->mIntensity = objectItr.GetAttributeAsFloat( "lightIntensity", 0.5f );
-					lightObject->mRadius = objectItr.GetAttributeAsFloat( "lightRadius", 1.0f );
-					lightObject->mFalloff = objectItr.GetAttributeAsFloat( "lightFalloff", 0.5f );
-				}
-				else if ( usage == TileObject::Usage_ENEMY )
-				{
-					object = new TileObject_Enemy();
-					TileObject_Enemy* enemyObject = (TileObject_Enemy*) object;
-					enemyObject->mEnemyClass = objectItr.GetAttributeAsString( "enemyType" );
-				}
-				else if ( usage == TileObject::Usage_SPAWNER )
-				{
-					object = new TileObject_Spawner();
-					TileObject_Spawner* spawner = (TileObject_Spawner*) object;
-					std::string listName = objectItr.GetAttributeAsString( "spawnList" );
-					auto listItr = mSpawnListMap.find( listName );
-					if ( listItr != mSpawnListMap.end() )
-					{
-						spawner->mList = listItr->second;
-					}
-					else
-					{
-						WarnFail( "Cannot find SpawnList '%s'\n", listName.c_str() );
-					}
-				}
-
-				// General properties
-				object->mName = name;
-				object->mUsageId = usage;
-				object->mAttachment = mMapObjectMap[ objectItr.GetAttributeAsString( "attachment", "" ) ];
-				object->LoadRulesFromXML( objectItr, &mGenerator, mMapObjectMap );
-				object->LoadEventsFromXML( objectItr );
-				std::vector< float > v;
-				objectItr.GetAttributeAsCSV( "localSpawnOffset", v, "0,0,0" );
-				if ( v.size() == 3 )
-					object->mLocalSpawnOffset = glm::vec3( v[0], v[1], v[2] );
-				else
-					DebugPrintf( "TileObject: invalid local spawn offset - must be 'x,y,z'\n" );
-				mMapObjectMap[ object->mName ] = object;
-			}
-		}
-
-
-		// <Rooms>
-		std::map< std::string, RoomTemplate* > roomMap;
-		XmlReader::XmlReaderIterator roomTmplItr = itr.NextChild( "Rooms" );
-		if ( roomTmplItr.IsValid() )
-		{
-			for ( XmlReader::XmlReaderIterator roomItr = roomTmplItr.NextChild( "Room" );
-				roomItr.IsValid(); roomItr = roomItr.NextSibling() )
-			{
-				RoomTemplate& roomTmpl = mGenerator.CreateRoomTemplate();
-				const char* name = roomItr.GetAttributeAsCString( "name", 0 );
-				// Rooms are only mapped if they are named
-				if ( name )
-				{
-					roomMap[ name ] = &roomTmpl;
-				}
-				// Load rules
-				roomTmpl.LoadRulesFromXML( roomItr, &mGenerator, roomMap );
-				// Copy base rooms
-				std::vector< std::string > roomsToCopyFrom;
-				roomItr.GetAttributeAsCSV( "extendsRooms", roomsToCopyFrom );
-				for ( auto roomCopyItr = roomsToCopyFrom.begin(); roomCopyItr != roomsToCopyFrom.end(); ++roomCopyItr )
-				{
-					RoomTemplate* roomToCopy = roomMap[ *roomCopyItr ];
-					if ( roomToCopy )
-					{
-						roomTmpl.CopyDataFrom( roomToCopy );
-					}
-					else
-					{
-						WarnFail( "Could not find room of name '%s'. Did you define it after this room?\n", roomCopyItr->c_str() );
-					}
-				}
+		mAreaFilenames[ slot ] = filename;
+		return true;
+	}
 
-				if ( roomItr.HasAttribute( "minRoomSize" ) )
-				{
-					std::vector< int > minRoomSize;
-					roomItr.GetAttributeAsCSV( "minRoomSize", minRoomSize );
-					roomTmpl.SetMinSize( minRoomSize[0], minRoomSize[1] );
-				}
-				if ( roomItr.HasAttribute( "maxRoomSize" ) )
-				{
-					std::vector< int > maxRoomSize;
-					roomItr.GetAttributeAsCSV( "maxRoomSize", maxRoomSize );
-					roomTmpl.SetMaxSize( maxRoomSize[0], maxRoomSize[1] );
-				}
+	mAreaFilenames[ slot ].clear();
+	return false;
+}
+//---------------------------------------
+void Game::ApplyAreaLighting()
+{
+	const Color& ambientColor = mArea->mAmbientLightColor;
+	mGlobalLightColor = glm::vec3( ambientColor.r, ambientColor.g, ambientColor.b );
+	mGlobalLightIntensity = mArea->mAmbientLightIntensity;
 
-				std::map< std::string, Useable* > usableMap;
-				std::map< std::string, Useable* > usableStyleMap;
-				for ( XmlReader::XmlReaderIterator roomJtr = roomItr.NextChild();
-					roomJtr.IsValid(); roomJtr = roomJtr.NextSibling() )
-				{
-					if ( roomJtr.ElementNameEquals( "UseStyle" ) )
-					{
-						std::string styleName = roomJtr.GetAttributeAsString( "uses" );
-						Useable* useStyle = new Useable;
-						mUseableObjects.push_back( useStyle );
-						useStyle->mObject = mStyleMap[ styleName ];
-						useStyle->LoadRulesFromXML( roomJtr, &mGenerator, usableStyleMap );
-						
-						roomTmpl.AddStyle( useStyle );
-
-						const char* name = roomJtr.GetAttributeAsCString( "name", 0 );
-						// Useables are only mapped if they are named
-						if ( name )
-						{
-							usableStyleMap[ name ] = useStyle;
-						}	
-					}
-					else if ( roomJtr.ElementNameEquals( "UsesObject" ) )
-					{
-						std::string objectName = roomJtr.GetAttributeAsString( "uses" );
-						auto objItr = mMapObjectMap.find( objectName );
-						if ( objItr == mMapObjectMap.end() )
-						{
-							WarnFail( "<Room name='%s'> <UsesObject uses='%s'>: No object named '%s'\n", name, objectName.c_str(), objectName.c_str() );
-							continue;
-						}
-						Useable* useObject = new Useable;
-						mUseableObjects.push_back( useObject );
-						useObject->mObject = mMapObjectMap[ objectName ];
-						useObject->LoadRulesFromXML( roomJtr, &mGenerator, usableMap );
-						roomTmpl.AddObject( useObject );
-
-						const char* name = roomJtr.GetAttributeAsCString( "name", 0 );
-						// Useables are only mapped if they are named
-						if ( name )
-						{
-							usableMap[ name ] = useObject;
-						}
-					}
-				}
-			}
-		}
-	}
-	else
-	{
-		WarnFail( "Failed to open '%s'\n", filename );
-	}
+	mGlobalLight.Color.SetValue( mGlobalLightColor );
+	mGlobalLight.Intensity.SetValue( mGlobalLightIntensity );
 }
 //---------------------------------------
 void Game::LoadKeys( const char* filename )
@@ -507,7 +251,7 @@ void Game::Run()
 	{
 		// Check if exit reached
 		glm::vec3 p1 = mPlayer.GetPosition();
-		glm::vec3 p2 = mGenerator.GetExitLocation();
+		glm::vec3 p2 = mGenerator->GetExitLocation();
 		float dist = glm::distance( p1, p2 );
 		if ( dist < 0.5f )
 		{
@@ -563,11 +307,11 @@ void Game::Run()
 		//
 		Texture2D::Unbind();
 		// World axes
-		mWindow.DrawWorldAxes( (float) mGenerator.GetWidth(), 10.0f, (float) mGenerator.GetHeight() );
+		mWindow.DrawWorldAxes( (float) mGenerator->GetWidth(), 10.0f, (float) mGenerator->GetHeight() );
 		// Physics debug
 		mPhysicsWorld.DebugDraw();
 		// Map - Debug Draw
-		mGenerator.Draw( &mWindow );
+		mGenerator->Draw( &mWindow );
 
 		// Entities - Foreground
 		mWindow.SetActiveEffect( &mBasicLightingEffect );
@@ -585,7 +329,7 @@ void Game::Run()
 		//
 		if ( !mHideHUD )
 		{
-			mWindow.DrawDebugText( 0, 200.0f, Color::WHITE, 0.75f, mGenerator.GetFloorName() );
+			mWindow.DrawDebugText( 0, 200.0f, Color::WHITE, 0.75f, mGenerator->GetFloorName() );
 
 			// Minimap
 			mMinimap.SetCenter( mCamera.position.x, mCamera.position.z, glm::degrees( mCamera.horizontalAngle ) );
@@ -615,6 +359,7 @@ void Game::Run()
 				"F6    Reload Data Files\n" \
 				"F7    Toggle Connectivity Debug\n" \
 				"F8    Reveal minimap\n" \
+				"F9    Reroll Room (Shift: Sector)\n" \
 				"F10  Toggle HUD\n" \
 				"L      Toggle Bright Lighting\n" \
 				"TAB  Toggle Fullscreen Map\n"
@@ -668,9 +413,24 @@ void Game::GenerateMap()
 	mWindow.Present();
 	mLoadFadeInTime = 0.75f;
 
-	if ( mEndDepth > 0 && mGenerator.GetCurrentDepth() == mEndDepth )
+	// Use the floor that was generated in the background while this one was played
+	const bool pregenerated = mNextFloorPending;
+	if ( pregenerated )
+	{
+		WaitForNextFloor();
+		mNextFloorPending = false;
+
+		mCurrentGenerator = 1 - mCurrentGenerator;
+		mGenerator = &mGenerators[ mCurrentGenerator ];
+		mArea = &mAreas[ mCurrentGenerator ];
+		mCamera.map = mGenerator;
+		mMinimap.SetMap( mGenerator );
+		ApplyAreaLighting();
+	}
+	else if ( mArea->mEndDepth > 0 && mGenerator->GetCurrentDepth() == mArea->mEndDepth )
 	{
-		LoadArea( mNextArea.c_str() );
+		const std::string nextArea = mArea->mNextArea;
+		LoadArea( nextArea.c_str() );
 	}
 
 	GameLog::Instance.Clear();
@@ -690,21 +450,231 @@ void Game::GenerateMap()
 	// Initialize lighting
 	InitializeLights();
 	
-	// Generate a new map
-	mGenerator.Generate();
+	// Generate a new map a frame's worth at a time so the loading screen keeps drawing
+	if ( !pregenerated )
+	{
+		mGenerator->BeginGenerate();
+		while ( !mGenerator->Step( 16000 ) )
+		{
+			mWindow.Prepare();
+			mWindow.DrawDebugTextFmt( mWindow.GetWidth() * 0.01f, mWindow.GetHeight() * 0.95f, Color::WHITE, "Loading... %d/%d",
+				(int) mGenerator->GetGenerationPhase(), (int) Phase_DONE );
+			mWindow.Present();
+		}
+	}
 
 	// Player setup
 	mPlayerLight = CreateLight( Color::WHITE, 0.25f, 0.2f, 0.5f );
 	mPlayer.SetCamera( &mCamera );
 	mPlayer.InitPhysics( &mPhysicsWorld );
-	mPlayer.Teleport( mGenerator.GetStartLocation() );
+	mPlayer.Teleport( mGenerator->GetStartLocation() );
 	mPlayer.ClearInventory();
 	mPlayer.InitializeWeapons();
 
-	// Spawn entities
-	mGenerator.SpawnEntities( this );
+	// Spawn entities, the manifest of a background floor was built with it
+	SpawnManifest manifest;
+	if ( pregenerated )
+		std::swap( manifest, mNextFloorManifest );
+	else
+		mGenerator->BuildSpawnManifest( manifest );
+	CreateEntities( manifest, *mGenerator );
+
+	GameLog::Instance.PostMessageFmt( "Now entering %s", mGenerator->GetFloorName() );
+
+	// Start on the next floor while this one is played
+	PreGenerateNextFloor();
+}
+//---------------------------------------
+void Game::RerollRoomAt( const glm::vec3& position, bool wholeSector )
+{
+	const int roomIndex = mGenerator->GetRoomIndexAt( (int) ( position.x + 0.5f ), (int) ( position.z + 0.5f ) );
+	if ( roomIndex < 0 )
+		return;
+
+	std::vector< bool > reroll( mGenerator->GetRoomCount(), false );
+	if ( wholeSector )
+	{
+		const int sectorId = mGenerator->GetRoomSectorId( roomIndex );
+		for ( int i = 0; i < mGenerator->GetRoomCount(); ++i )
+			reroll[i] = mGenerator->GetRoomSectorId( i ) == sectorId;
+	}
+	else
+		reroll[ roomIndex ] = true;
+
+	// Remove only what those rooms spawned, their physics bodies go with them
+	// Doors belong to no room, RerollRoom() keeps their styles so they stay as they are
+	for ( auto itr = mEntities.begin(); itr != mEntities.end(); ++itr )
+	{
+		const int spawnRoom = (*itr)->GetSpawnRoom();
+		if ( spawnRoom >= 0 && spawnRoom < (int) reroll.size() && reroll[ spawnRoom ] )
+			(*itr)->Destroy();
+	}
+	RemoveDeadEntities();
+
+	for ( int i = 0; i < (int) reroll.size(); ++i )
+	{
+		if ( reroll[i] )
+		{
+			mGenerator->RerollRoom( i );
+			SpawnManifest manifest;
+			mGenerator->BuildRoomSpawnManifest( manifest, i );
+			CreateEntities( manifest, *mGenerator );
+		}
+	}
 
-	GameLog::Instance.PostMessageFmt( "Now entering %s", mGenerator.GetFloorName() );
+	GameLog::Instance.PostMessageFmt( wholeSector ? "Rerolled sector of room %d" : "Rerolled room %d", roomIndex );
+}
+//---------------------------------------
+void Game::CreateEntities( const SpawnManifest& manifest, TileGrid& grid )
+{
+	std::vector< Entity* > entities;
+	entities.reserve( manifest.GetSpawnCount() );
+
+	// Keys first, locked doors show the name of the key that opens them
+	std::vector< Key* > keys;
+	for ( auto itr = manifest.mKeys.begin(); itr != manifest.mKeys.end(); ++itr )
+	{
+		glm::vec3 location = itr->mLocation;
+		Key* key = new Key( itr->mKeyId );
+		key->SetKeyStyle( Key::GetRandomKeyStyle() );
+		key->SetLocation( location );
+		key->SetColor( itr->mColor );
+		keys.push_back( key );
+		entities.push_back( key );
+	}
+
+	for ( auto itr = manifest.mTiles.begin(); itr != manifest.mTiles.end(); ++itr )
+	{
+		MapTile* e = new MapTile( &grid.GetTileAt( itr->x, itr->y ) );
+		e->SetSpawnRoom( itr->mRoomIndex );
+		manifest.mStylePalette[ itr->mStyle ]->SetupEvents( e );
+		entities.push_back( e );
+	}
+
+	// Attachments come after their parent so it is always made first
+	std::vector< Entity* > objects( manifest.mObjects.size(), 0 );
+	for ( size_t i = 0; i < manifest.mObjects.size(); ++i )
+	{
+		const SpawnManifest::ObjectSpawn& spawn = manifest.mObjects[i];
+		TileObject* obj = manifest.mObjectPalette[ spawn.mObject ];
+		Tile& tile = grid.GetTileAt( spawn.x, spawn.y );
+		glm::vec3 location = spawn.mLocation;
+
+		Entity* e = 0;
+		if ( obj->mUsageId == TileObject::Usage_STATIC )
+			e = new MapObject( &tile, obj->mMesh );
+		else if ( obj->mUsageId == TileObject::Usage_PICKUP )
+		{
+			Pickup* pickup = Pickup::CreatePickup( ( (TileObject_Pickup*) obj )->mPickupName );
+			if ( pickup )
+				pickup->SetLocation( location );
+			e = pickup;
+		}
+		else if ( obj->mUsageId == TileObject::Usage_LIGHT )
+		{
+			TileObject_Light* lightObject = (TileObject_Light*) obj;
+			PointLight* light = CreateLight( lightObject->mLightColor, lightObject->mIntensity, lightObject->mFalloff, lightObject->mRadius );
+			if ( light )
+				light->mPosition = spawn.mLocation;
+			e = light;
+		}
+		else if ( obj->mUsageId == TileObject::Usage_ENEMY )
+		{
+			Enemy* enemy = Enemy::CreateEnemy( ( (TileObject_Enemy*) obj )->mEnemyClass );
+			if ( enemy )
+				enemy->SetSpawnLocation( spawn.mLocation );
+			e = enemy;
+		}
+		else if ( obj->mUsageId == TileObject::Usage_SPAWNER && spawn.mVariant >= 0 )
+		{
+			Enemy* enemy = Enemy::CreateEnemy( ( (TileObject_Spawner*) obj )->GetObjectToSpawn( spawn.mVariant ) );
+			if ( enemy )
+				enemy->SetSpawnLocation( spawn.mLocation );
+			e = enemy;
+		}
+
+		if ( !e )
+			continue;
+
+		Entity* parent = spawn.mParent >= 0 ? objects[ spawn.mParent ] : 0;
+		e->SetSpawnRoom( spawn.mRoomIndex );
+		e->SetParent( parent );
+		if ( parent )
+			parent->AddAttachment( e );
+		obj->SetupEvents( e );
+		objects[i] = e;
+		entities.push_back( e );
+	}
+
+	for ( auto itr = manifest.mDoors.begin(); itr != manifest.mDoors.end(); ++itr )
+	{
+		TileStyle* doorStyle = manifest.mStylePalette[ itr->mStyle ];
+		glm::vec3 location = itr->mLocation;
+		Door* d = new Door( &grid.GetTileAt( itr->x, itr->y ), doorStyle->mMesh );
+		d->SetLocation( location );
+		d->SetRotation( glm::vec3( 0, 1.0f, 0 ), glm::radians( itr->mOrientation ) );
+		doorStyle->SetupEvents( d );
+
+		if ( itr->mLock == SpawnManifest::Lock_KEY )
+		{
+			d->Lock( itr->mKeyId );
+			d->SetColor( itr->mColor );
+			d->SetKeyName( keys[ itr->mKey ]->GetKeyName() );
+		}
+		else if ( itr->mLock == SpawnManifest::Lock_FORCED )
+			d->Lock( 0 );
+		entities.push_back( d );
+	}
+
+	AddEntities( entities );
+}
+//---------------------------------------
+void Game::PreGenerateNextFloor()
+{
+	const int next = 1 - mCurrentGenerator;
+	DungeonGenerator& generator = mGenerators[ next ];
+
+	if ( mArea->mEndDepth > 0 && mGenerator->GetCurrentDepth() == mArea->mEndDepth )
+	{
+		// The next floor is in a new area, parse it now
+		if ( !LoadAreaInto( next, mArea->mNextArea ) )
+			return;
+	}
+	else
+	{
+		// Meshes are shared so loading the same area again is cheap
+		if ( mAreaFilenames[ next ] != mAreaFilenames[ mCurrentGenerator ] && !LoadAreaInto( next, mAreaFilenames[ mCurrentGenerator ] ) )
+			return;
+		generator.SetCurrentDepth( mGenerator->GetCurrentDepth() );
+	}
+	generator.DebugSectors = mGenerator->DebugSectors;
+
+	// Continue the current floor's random sequence so every floor is different
+	const uint64_t seedHigh = mGenerator->GetRNG().Rand();
+	const uint64_t seedLow = mGenerator->GetRNG().Rand();
+	generator.SetRandomSeed( ( seedHigh << 32 ) | seedLow );
+
+	// Only the generator and the manifest are touched on the worker
+	// Entities are still created from the manifest on the main thread in GenerateMap()
+	mNextFloorPending = true;
+	SpawnManifest& manifest = mNextFloorManifest;
+	mNextFloorThread = std::thread( [&generator, &manifest]()
+	{
+		generator.Generate();
+		generator.BuildSpawnManifest( manifest );
+	});
+}
+//---------------------------------------
+void Game::WaitForNextFloor()
+{
+	if ( mNextFloorThread.joinable() )
+		mNextFloorThread.join();
+}
+//---------------------------------------
+void Game::CancelNextFloor()
+{
+	WaitForNextFloor();
+	mNextFloorPending = false;
 }
 //---------------------------------------
 void Game::HandleEvents()
@@ -787,12 +757,17 @@ void Game::HandleEvents()
 				}
 				else if ( sdlEvent.key.keysym.sym == SDLK_F7 )
 				{
-					mGenerator.DebugSectors = !mGenerator.DebugSectors;
+					mGenerator->DebugSectors = !mGenerator->DebugSectors;
 				}
 				else if ( sdlEvent.key.keysym.sym == SDLK_F8 )
 				{
 					mMinimap.RevealAll();
 				}
+				else if ( sdlEvent.key.keysym.sym == SDLK_F9 )
+				{
+					const glm::vec3 position = mCamera.ghost ? mCamera.position : mPlayer.GetPosition();
+					RerollRoomAt( position, ( sdlEvent.key.keysym.mod & KMOD_SHIFT ) != 0 );
+				}
 				else if ( sdlEvent.key.keysym.sym == SDLK_F10 )
 				{
 					mHideHUD = !mHideHUD;
@@ -925,6 +900,35 @@ void Game::AddEntity( Entity* entity )
 	}
 }
 //---------------------------------------
+void Game::AddEntities( const std::vector< Entity* >& entities )
+{
+	mEntities.reserve( mEntities.size() + entities.size() );
+	for ( auto itr = entities.begin(); itr != entities.end(); ++itr )
+	{
+		Entity* entity = *itr;
+		entity->LoadAssets();
+		entity->Initialize();
+		entity->InitPhysics( &mPhysicsWorld );
+
+		mEntities.push_back( entity );
+		if ( entity->GetRenderGroup() == Entity::RG_SCENE )
+			mEntitiesSceneGroup.push_back( entity );
+		else if ( entity->GetRenderGroup() == Entity::RG_FOREGROUND )
+			mEntitiesForegroundGroup.push_back( entity );
+		else
+		{
+			WarnCrit( "Entity with no RenderGroup!\n" );
+			assert( 0 );
+		}
+	}
+
+	// Keep entities sorted, once for the lot
+	std::sort( mEntities.begin(), mEntities.end(), []( Entity* A, Entity* B )
+	{
+		return *A < *B;
+	});
+}
+//---------------------------------------
 void Game::DestroyEntities()
 {
 	for ( auto itr = mEntities.begin(); itr != mEntities.end(); ++itr )
@@ -8,6 +8,8 @@
 #pragma once
 
 #include "DungeonGenerator.h"
+#include "DungeonArea.h"
+#include "SpawnManifest.h"
 #include "Window.h"
 #include "Camera.h"
 #include "PhysicsWorld.h"
@@ -18,6 +20,8 @@
 #include "PointLight.h"
 
 #include <glm/glm.hpp>
+#include <string>
+#include <thread>
 
 class Object;
 
@@ -38,6 +42,8 @@ public:
 	// Add an Entity to the game
 	// Entities will have their initialization functions called and be updated/draw
 	void AddEntity( Entity* entity );
+	// Same for many entities at once, they are sorted into place once instead of after each
+	void AddEntities( const std::vector< Entity* >& entities );
 
 	// Create a new light in the level
 	// You still need to add the light to the scene
@@ -55,10 +61,23 @@ private:
 	void EnableMostRelevantLights();
 
 	void GenerateMap();
+	// Generate the floor after the current one on a worker thread
+	void PreGenerateNextFloor();
+	// Block until the floor being generated in the background is done
+	void WaitForNextFloor();
+	// Throw away the background floor, i.e. when the area is reloaded
+	void CancelNextFloor();
+	// Pick new styles and objects for the room at position, or its whole sector,
+	// replacing only the entities and physics bodies that room spawned
+	void RerollRoomAt( const glm::vec3& position, bool wholeSector );
+	// Make the entities of manifest, standing on the tiles of grid
+	void CreateEntities( const SpawnManifest& manifest, TileGrid& grid );
 
 	void HandleEvents();
 
 	void LoadArea( const char* filename );
+	bool LoadAreaInto( int slot, const std::string& filename );
+	void ApplyAreaLighting();
 	void LoadKeys( const char* filename );
 	void LoadPickups( const char* filename );
 	void LoadEnemies( const char* filename );
@@ -71,7 +90,6 @@ private:
 	void RemoveDeadEntities();
 
 	static Game* mInstance;
-	DungeonGenerator mGenerator;
 	Window mWindow;
 	bool mRunning;
 	bool mMinimapIsFullscreen;
@@ -79,8 +97,6 @@ private:
 	bool mHideHUD;
 	bool mHasFocus;
 	float mLoadFadeInTime;
-	int mEndDepth;
-	std::string mNextArea;
 
 	Camera mCamera;
 
@@ -92,10 +108,17 @@ private:
 	std::vector< Entity* > mEntitiesForegroundGroup;
 
 	// Generation
-	std::map< std::string, TileStyle* > mStyleMap;
-	std::map< std::string, TileObject* > mMapObjectMap;
-	std::map< std::string, SpawnList* > mSpawnListMap;
-	std::vector< Useable* > mUseableObjects;
+	// The current floor is played from one generator while the next floor
+	// is generated into the other one on mNextFloorThread
+	DungeonGenerator mGenerators[2];
+	DungeonArea mAreas[2];
+	std::string mAreaFilenames[2];	// Area loaded into each generator
+	int mCurrentGenerator;
+	DungeonGenerator* mGenerator;	// &mGenerators[ mCurrentGenerator ]
+	DungeonArea* mArea;				// &mAreas[ mCurrentGenerator ]
+	std::thread mNextFloorThread;
+	bool mNextFloorPending;			// mNextFloorThread was started for the next floor
+	SpawnManifest mNextFloorManifest;	// Built by mNextFloorThread
 
 	// Lighting
 	Effect mBasicLightingEffect;
@@ -1,14 +1,12 @@
 #include "HashUtil.h"
 
-unsigned int GenerateHash( const char* str )
+uint64_t GenerateHash64( const void* data, size_t size, uint64_t hash )
 {
-	unsigned int hash = 0;
-	while ( *str )
+	const unsigned char* bytes = (const unsigned char*) data;
+	for ( size_t i = 0; i < size; ++i )
 	{
-		hash &= 0x07ffffff;
-		hash *= 31;
-		hash += *str;
-		++str;
+		hash ^= bytes[i];
+		hash *= 1099511628211ULL;
 	}
 	return hash;
-}
\ No newline at end of file
+}
@@ -7,4 +7,9 @@
  
 #pragma once
 
-unsigned int GenerateHash( const char* str );
+#include <stddef.h>
+#include <stdint.h>
+
+// 64 bit FNV-1a, pass the last result as hash to continue hashing more data
+static const uint64_t HASH64_INITIAL = 14695981039346656037ULL;
+uint64_t GenerateHash64( const void* data, size_t size, uint64_t hash=HASH64_INITIAL );
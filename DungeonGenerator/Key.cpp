@@ -27,9 +27,9 @@ void Key::ClearKeyStyles()
 	mKeyStyles.clear();
 }
 //---------------------------------------
-void Key::RandomizeKeyStyles()
+void Key::RandomizeKeyStyles( RNG& rng )
 {
-	std::random_shuffle( mKeyStyles.begin(), mKeyStyles.end() );
+	rng.Shuffle( mKeyStyles.begin(), mKeyStyles.end() );
 }
 //---------------------------------------
 const Key::KeyStyle& Key::GetRandomKeyStyle()
@@ -10,6 +10,7 @@
 #include "Pickup.h"
 
 class PointLight;
+class RNG;
 
 class Key
 	: public Pickup
@@ -34,7 +35,7 @@ public:
 	};
 	static void AddKeyStyle( const KeyStyle& style );
 	static void ClearKeyStyles();
-	static void RandomizeKeyStyles();
+	static void RandomizeKeyStyles( RNG& rng );
 	static const KeyStyle& GetRandomKeyStyle();
 
 	Key( int keyId );
@@ -0,0 +1,375 @@
+#include "LayoutStrategy.h"
+#include "DungeonGenerator.h"
+
+#include <algorithm>
+#include <math.h>
+
+//---------------------------------------
+// LayoutStrategy
+RoomTemplate* LayoutStrategy::GetRoomTemplate( DungeonGenerator& generator )
+{
+	return generator.GetValidRoomTemplate();
+}
+//---------------------------------------
+void LayoutStrategy::GetRoomSizeRange( const DungeonGenerator& generator, const RoomTemplate& tmpl, int& minSizeX, int& maxSizeX, int& minSizeY, int& maxSizeY )
+{
+	generator.GetRoomSizeRange( tmpl, minSizeX, maxSizeX, minSizeY, maxSizeY );
+	minSizeX = std::max( minSizeX, (int) MIN_ROOM_SIZE );
+	minSizeY = std::max( minSizeY, (int) MIN_ROOM_SIZE );
+	maxSizeX = std::max( maxSizeX, minSizeX );
+	maxSizeY = std::max( maxSizeY, minSizeY );
+}
+//---------------------------------------
+void LayoutStrategy::GetLargestRoomSize( const DungeonGenerator& generator, int& w, int& h )
+{
+	int minSizeX, minSizeY;
+	GetRoomSizeRange( generator, generator.mDummyRoomTmpl, minSizeX, w, minSizeY, h );
+	for ( auto itr = generator.mRoomTemplates.begin(); itr != generator.mRoomTemplates.end(); ++itr )
+	{
+		int maxSizeX, maxSizeY;
+		GetRoomSizeRange( generator, **itr, minSizeX, maxSizeX, minSizeY, maxSizeY );
+		w = std::max( w, maxSizeX );
+		h = std::max( h, maxSizeY );
+	}
+}
+//---------------------------------------
+int LayoutStrategy::GetMaxRoomCount( const DungeonGenerator& generator )
+{
+	return generator.mMaxRoomCount;
+}
+//---------------------------------------
+float LayoutStrategy::GetAdjoiningRoomZ( DungeonGenerator& generator, float z )
+{
+	return generator.GetAdjoiningRoomZ( z );
+}
+//---------------------------------------
+Room* LayoutStrategy::AddRoom( DungeonGenerator& generator, RoomTemplate* tmpl, int x, int y, int w, int h, float z )
+{
+	if ( x < 0 || y < 0 || x + w > generator.GetWidth() || y + h > generator.GetHeight() || !generator.CanRoomFitHere( x, y, w, h ) )
+		return 0;
+
+	Room* room = new Room();
+	generator.GenerateRoom( *room, tmpl, w, h );
+	generator.AddRoom( *room, x, y, z );
+	return room;
+}
+//---------------------------------------
+bool LayoutStrategy::ConnectAlongX( DungeonGenerator& generator, int x, int y )
+{
+	return generator.ConnectRooms( x, y, DungeonGenerator::Dir_WEST );
+}
+//---------------------------------------
+bool LayoutStrategy::ConnectAlongY( DungeonGenerator& generator, int x, int y )
+{
+	return generator.ConnectRooms( x, y, DungeonGenerator::Dir_SOUTH );
+}
+//---------------------------------------
+
+
+//---------------------------------------
+// BSPLayout
+void BSPLayout::PlaceRooms( DungeonGenerator& generator )
+{
+	const int maxRooms = GetMaxRoomCount( generator );
+	int w = generator.GetWidth();
+	int h = generator.GetHeight();
+
+	// Split an area that holds about maxRooms average sized rooms, not the whole grid
+	if ( maxRooms > 0 )
+	{
+		int minSizeX, maxSizeX, minSizeY, maxSizeY;
+		GetRoomSizeRange( generator, *GetRoomTemplate( generator ), minSizeX, maxSizeX, minSizeY, maxSizeY );
+		const float side = sqrtf( (float) maxRooms );
+		w = std::min( w, (int) ( side * ( minSizeX + maxSizeX ) * 0.5f ) );
+		h = std::min( h, (int) ( side * ( minSizeY + maxSizeY ) * 0.5f ) );
+	}
+
+	Node root = { ( generator.GetWidth() - w ) / 2, ( generator.GetHeight() - h ) / 2, w, h, Split_NONE, 0 };
+	mNodes.assign( 1, root );
+	mStack.assign( 1, 0 );
+
+	// Depth first so each room is added before the template for the next is picked
+	int roomCount = 0;
+	while ( !mStack.empty() )
+	{
+		const int index = mStack.back();
+		mStack.pop_back();
+		const Node node = mNodes[ index ];
+
+		RoomTemplate* tmpl = GetRoomTemplate( generator );
+		int minSizeX, maxSizeX, minSizeY, maxSizeY;
+		GetRoomSizeRange( generator, *tmpl, minSizeX, maxSizeX, minSizeY, maxSizeY );
+
+		// Split while too big for the template and both halves can still hold a room
+		// A piece too big for one room and too small for two is left as one room
+		const bool splitX = node.w > maxSizeX && node.w >= 2 * minSizeX;
+		const bool splitY = node.h > maxSizeY && node.h >= 2 * minSizeY;
+		if ( splitX || splitY )
+		{
+			Node a = node;
+			Node b = node;
+			a.mSplit = b.mSplit = Split_NONE;
+			if ( splitX && ( !splitY || node.w >= node.h ) )
+			{
+				const int at = generator.GetRNG().RandomInRange( minSizeX, node.w - minSizeX );
+				a.w = at;
+				b.x += at;
+				b.w -= at;
+				mNodes[ index ].mSplit = Split_X;
+				mNodes[ index ].mAt = node.x + at;
+			}
+			else
+			{
+				const int at = generator.GetRNG().RandomInRange( minSizeY, node.h - minSizeY );
+				a.h = at;
+				b.y += at;
+				b.h -= at;
+				mNodes[ index ].mSplit = Split_Y;
+				mNodes[ index ].mAt = node.y + at;
+			}
+			mStack.push_back( (int) mNodes.size() + 1 );
+			mStack.push_back( (int) mNodes.size() );
+			mNodes.push_back( a );
+			mNodes.push_back( b );
+			continue;
+		}
+
+		if ( maxRooms > 0 && roomCount >= maxRooms )
+			continue;
+		if ( AddRoom( generator, tmpl, node.x, node.y, node.w, node.h, 0 ) )
+			++roomCount;
+	}
+
+	for ( int i = 0; i < (int) mNodes.size(); ++i )
+	{
+		if ( mNodes[i].mSplit != Split_NONE )
+			ConnectSplit( generator, i );
+	}
+}
+//---------------------------------------
+void BSPLayout::ConnectSplit( DungeonGenerator& generator, int index )
+{
+	const Node& node = mNodes[ index ];
+	const bool alongX = node.mSplit == Split_X;
+	const int start = alongX ? node.y : node.x;
+	const int end = alongX ? node.y + node.h : node.x + node.w;
+
+	// Walk the split line, a door fits wherever the rooms on both sides have straight wall either side of it
+	mDoors.clear();
+	for ( int i = start; i < end; ++i )
+	{
+		const Tile& first = alongX ? generator.GetTileAt( node.mAt - 1, i ) : generator.GetTileAt( i, node.mAt - 1 );
+		const Tile& second = alongX ? generator.GetTileAt( node.mAt, i ) : generator.GetTileAt( i, node.mAt );
+		const Room* a = first.mRoom;
+		const Room* b = second.mRoom;
+		if ( !a || !b )
+			continue;
+
+		const int aStart = alongX ? a->y : a->x;
+		const int aEnd = aStart + ( alongX ? a->GetHeight() : a->GetWidth() );
+		const int bStart = alongX ? b->y : b->x;
+		const int bEnd = bStart + ( alongX ? b->GetHeight() : b->GetWidth() );
+		if ( i >= std::max( aStart, bStart ) + 2 && i <= std::min( aEnd, bEnd ) - 3 )
+			mDoors.push_back( i );
+	}
+	if ( mDoors.empty() )
+		return;
+
+	const int door = mDoors[ generator.GetRNG().RandomIndex( (unsigned) mDoors.size() ) ];
+	if ( alongX )
+		ConnectAlongX( generator, node.mAt - 1, door );
+	else
+		ConnectAlongY( generator, door, node.mAt - 1 );
+}
+//---------------------------------------
+
+
+//---------------------------------------
+// GraphLayout
+GraphLayout::GraphLayout()
+	: mRoomCount( 0 )
+	, mLoopCount( -1 )
+	, mMaxBranchDepth( 0 )
+{}
+//---------------------------------------
+void GraphLayout::AddFrontier( int cell )
+{
+	const int cx = cell / mCellsY;
+	const int cy = cell % mCellsY;
+	const int nx[4] = { cx - 1, cx + 1, cx, cx };
+	const int ny[4] = { cy, cy, cy - 1, cy + 1 };
+	for ( int n = 0; n < 4; ++n )
+	{
+		if ( nx[n] < 0 || nx[n] >= mCellsX || ny[n] < 0 || ny[n] >= mCellsY )
+			continue;
+		const int next = nx[n] * mCellsY + ny[n];
+		if ( mDepths[ next ] < 0 )
+		{
+			mFrontier.push_back( cell );
+			mFrontier.push_back( next );
+		}
+	}
+}
+//---------------------------------------
+void GraphLayout::PlaceRooms( DungeonGenerator& generator )
+{
+	RNG& rng = generator.GetRNG();
+
+	// Cells hold the largest room with a gap of at least two on every side, room for a corridor
+	int largestW, largestH;
+	GetLargestRoomSize( generator, largestW, largestH );
+	mCellW = largestW + 2;
+	mCellH = largestH + 2;
+	mCellsX = std::max( generator.GetWidth() / mCellW, 1 );
+	mCellsY = std::max( generator.GetHeight() / mCellH, 1 );
+	mOriginX = ( generator.GetWidth() - mCellsX * mCellW ) / 2;
+	mOriginY = ( generator.GetHeight() - mCellsY * mCellH ) / 2;
+
+	const int cellCount = mCellsX * mCellsY;
+	const int maxRooms = GetMaxRoomCount( generator );
+	int roomCount = mRoomCount > 0 ? mRoomCount : maxRooms;
+	if ( roomCount <= 0 || roomCount > cellCount )
+		roomCount = cellCount;
+	// Corridors are rooms too, every room after the first brings one
+	if ( maxRooms > 0 )
+		roomCount = std::min( roomCount, ( maxRooms + 1 ) / 2 );
+	int loopCount = mLoopCount >= 0 ? mLoopCount : roomCount / 8;
+
+	// 1) The graph, a random tree grown out of the middle cell one neighbor at a time
+	mDepths.assign( cellCount, -1 );
+	mParents.assign( cellCount, -1 );
+	mRooms.assign( cellCount, (Room*) 0 );
+	mOrder.clear();
+	mFrontier.clear();
+	mLoops.clear();
+
+	const int first = ( mCellsX / 2 ) * mCellsY + mCellsY / 2;
+	mDepths[ first ] = 0;
+	mOrder.push_back( first );
+	AddFrontier( first );
+	while ( (int) mOrder.size() < roomCount && !mFrontier.empty() )
+	{
+		// Take a random pair out of the frontier
+		const unsigned pair = rng.RandomIndex( (unsigned) mFrontier.size() / 2 );
+		const int from = mFrontier[ pair * 2 ];
+		const int to = mFrontier[ pair * 2 + 1 ];
+		mFrontier[ pair * 2 ] = mFrontier[ mFrontier.size() - 2 ];
+		mFrontier[ pair * 2 + 1 ] = mFrontier.back();
+		mFrontier.resize( mFrontier.size() - 2 );
+
+		if ( mDepths[ to ] >= 0 || ( mMaxBranchDepth > 0 && mDepths[ from ] >= mMaxBranchDepth ) )
+			continue;
+		mDepths[ to ] = mDepths[ from ] + 1;
+		mParents[ to ] = from;
+		mOrder.push_back( to );
+		AddFrontier( to );
+	}
+
+	// Each loop is one more corridor
+	if ( maxRooms > 0 )
+		loopCount = std::max( std::min( loopCount, maxRooms - ( 2 * (int) mOrder.size() - 1 ) ), 0 );
+
+	// Loops join neighboring rooms that the tree did not
+	for ( auto itr = mOrder.begin(); itr != mOrder.end(); ++itr )
+	{
+		const int cell = *itr;
+		const int right = ( cell / mCellsY + 1 < mCellsX ) ? cell + mCellsY : -1;
+		const int down = ( cell % mCellsY + 1 < mCellsY ) ? cell + 1 : -1;
+		const int neighbors[2] = { right, down };
+		for ( int n = 0; n < 2; ++n )
+		{
+			const int next = neighbors[n];
+			if ( next >= 0 && mDepths[ next ] >= 0 && mParents[ next ] != cell && mParents[ cell ] != next )
+			{
+				mLoops.push_back( cell );
+				mLoops.push_back( next );
+			}
+		}
+	}
+	for ( int i = 0; i < loopCount && i < (int) mLoops.size() / 2; ++i )
+	{
+		// Partial shuffle of the pairs, the first loopCount are used
+		const int j = i + (int) rng.RandomIndex( (unsigned) mLoops.size() / 2 - i );
+		std::swap( mLoops[ i * 2 ], mLoops[ j * 2 ] );
+		std::swap( mLoops[ i * 2 + 1 ], mLoops[ j * 2 + 1 ] );
+	}
+	mLoops.resize( std::min( (int) mLoops.size(), loopCount * 2 ) );
+
+	// 2) Rooms, sized by their template and centered in their cell
+	for ( auto itr = mOrder.begin(); itr != mOrder.end(); ++itr )
+	{
+		const int cell = *itr;
+		RoomTemplate* tmpl = GetRoomTemplate( generator );
+		int minSizeX, maxSizeX, minSizeY, maxSizeY;
+		GetRoomSizeRange( generator, *tmpl, minSizeX, maxSizeX, minSizeY, maxSizeY );
+		const int w = rng.RandomInRange( minSizeX, maxSizeX );
+		const int h = rng.RandomInRange( minSizeY, maxSizeY );
+		const int x = mOriginX + ( cell / mCellsY ) * mCellW + ( mCellW - w ) / 2;
+		const int y = mOriginY + ( cell % mCellsY ) * mCellH + ( mCellH - h ) / 2;
+
+		const Room* parent = mParents[ cell ] >= 0 ? mRooms[ mParents[ cell ] ] : 0;
+		const float z = parent ? GetAdjoiningRoomZ( generator, generator.GetTileAt( parent->x, parent->y ).z ) : 0;
+		mRooms[ cell ] = AddRoom( generator, tmpl, x, y, w, h, z );
+	}
+
+	// 3) Doors, the tree then the loops
+	for ( auto itr = mOrder.begin(); itr != mOrder.end(); ++itr )
+	{
+		if ( mParents[ *itr ] >= 0 )
+			Connect( generator, mParents[ *itr ], *itr );
+	}
+	for ( size_t i = 0; i < mLoops.size(); i += 2 )
+		Connect( generator, mLoops[i], mLoops[ i + 1 ] );
+}
+//---------------------------------------
+void GraphLayout::Connect( DungeonGenerator& generator, int a, int b )
+{
+	// a is left of or above b
+	if ( b < a )
+		std::swap( a, b );
+	const Room* first = mRooms[a];
+	const Room* second = mRooms[b];
+	if ( !first || !second )
+		return;
+
+	// Neighbors in the same column are one cell index apart
+	const bool alongX = a / mCellsY != b / mCellsY;
+
+	// Door position shared by both rooms, with straight wall either side of it
+	const int lo = alongX ? std::max( first->y, second->y ) + 2 : std::max( first->x, second->x ) + 2;
+	const int hi = alongX ? std::min( first->y + first->GetHeight(), second->y + second->GetHeight() ) - 3
+		: std::min( first->x + first->GetWidth(), second->x + second->GetWidth() ) - 3;
+	if ( lo > hi )
+		return;
+	const int door = generator.GetRNG().RandomInRange( lo, hi );
+	const float z = generator.GetTileAt( first->x, first->y ).z;
+
+	// Three wide corridor across the gap, at the height of the first room
+	Room* corridor;
+	if ( alongX )
+	{
+		const int x = first->x + first->GetWidth();
+		corridor = AddRoom( generator, GetRoomTemplate( generator ), x, door - 1, second->x - x, 3, z );
+		if ( !corridor )
+			return;
+		ConnectAlongX( generator, x - 1, door );
+		ConnectAlongX( generator, second->x - 1, door );
+	}
+	else
+	{
+		const int y = first->y + first->GetHeight();
+		corridor = AddRoom( generator, GetRoomTemplate( generator ), door - 1, y, 3, second->y - y, z );
+		if ( !corridor )
+			return;
+		ConnectAlongY( generator, door, y - 1 );
+		ConnectAlongY( generator, door, second->y - 1 );
+	}
+
+	// Corridors are styled like the rooms they join but are kept clear
+	for ( int x = corridor->x; x < corridor->x + corridor->GetWidth(); ++x )
+	{
+		for ( int y = corridor->y; y < corridor->y + corridor->GetHeight(); ++y )
+			generator.GetTileAt( x, y ).mBlockObjectSpawn = true;
+	}
+}
+//---------------------------------------
@@ -0,0 +1,131 @@
+/*
+ * Description :
+ *   Room placement without rejection sampling, set with
+ *   DungeonGenerator::SetLayoutStrategy(). A strategy replaces the room
+ *   placement pass and builds the floor with the generator's own AddRoom()
+ *   and ConnectRooms(), so every later pass runs on it unchanged. Both run
+ *   in time proportional to the area they cover and consume the generator's
+ *   RNG, so a seed always gives the same floor.
+ *
+ *   BSPLayout splits the area in two until each piece is room sized. Every
+ *   leaf becomes a room that fills it and every split gets one door between
+ *   its halves, so no room is ever rejected and no space is left between them.
+ *
+ *   GraphLayout first grows a tree of rooms over a lattice of room sized
+ *   cells, with a limit on how deep its branches go, and adds loops between
+ *   neighboring cells. Only then are the rooms placed, sized by their
+ *   RoomTemplate and centered in their cells, with short corridors across
+ *   the gaps between connected rooms. Corridors count against the max room
+ *   count and never hold objects.
+ */
+
+#pragma once
+
+#include <vector>
+
+class DungeonGenerator;
+class RoomTemplate;
+class Room;
+
+class LayoutStrategy
+{
+public:
+	virtual ~LayoutStrategy() {}
+
+	// Add and connect every room of a floor to the cleared generator
+	virtual void PlaceRooms( DungeonGenerator& generator ) = 0;
+
+protected:
+	// First room template whose rules pass
+	static RoomTemplate* GetRoomTemplate( DungeonGenerator& generator );
+	static void GetRoomSizeRange( const DungeonGenerator& generator, const RoomTemplate& tmpl, int& minSizeX, int& maxSizeX, int& minSizeY, int& maxSizeY );
+	// Largest room any template can make
+	static void GetLargestRoomSize( const DungeonGenerator& generator, int& w, int& h );
+	// SetMaxRoomCount(), 0 -> no limit
+	static int GetMaxRoomCount( const DungeonGenerator& generator );
+	// Height for a room reached from one at z, see DungeonGenerator::SetVerticalness()
+	static float GetAdjoiningRoomZ( DungeonGenerator& generator, float z );
+	// Add a w x h room made from tmpl with its top left at x, y
+	// Returns 0 if any of that space is taken
+	static Room* AddRoom( DungeonGenerator& generator, RoomTemplate* tmpl, int x, int y, int w, int h, float z );
+	// Open the wall at x, y and the wall of the room next to it at x + 1, y
+	// Returns true if a door was placed
+	static bool ConnectAlongX( DungeonGenerator& generator, int x, int y );
+	// Same for the room at x, y + 1
+	static bool ConnectAlongY( DungeonGenerator& generator, int x, int y );
+
+	// Rooms need a door tile with a straight wall on either side, so at least 5 tiles
+	static const int MIN_ROOM_SIZE = 5;
+};
+
+//---------------------------------------
+// Binary space partitioning
+// With a max room count only a centered area about big enough for that many rooms is split
+class BSPLayout
+	: public LayoutStrategy
+{
+public:
+	void PlaceRooms( DungeonGenerator& generator );
+
+private:
+	// Door between a room on either side of a split, if any pair overlaps enough
+	void ConnectSplit( DungeonGenerator& generator, int node );
+
+	enum SplitAxis
+	{
+		Split_NONE,
+		Split_X,		// Left and right halves
+		Split_Y,		// Top and bottom halves
+	};
+
+	struct Node
+	{
+		int x, y, w, h;
+		int mSplit;		// SplitAxis
+		int mAt;		// First column or row of the second half
+	};
+
+	std::vector< Node > mNodes;
+	std::vector< int > mStack;
+	std::vector< int > mDoors;		// Door candidates along one split
+};
+
+//---------------------------------------
+// Abstract room graph first, then rooms and corridors
+class GraphLayout
+	: public LayoutStrategy
+{
+public:
+	GraphLayout();
+
+	// Rooms to place, 0 -> the generator's max room count, or as many as the lattice holds
+	// Corridors count against the max room count, so about half of it are rooms
+	void SetRoomCount( int count ) { mRoomCount = count; }
+	// Extra doors between rooms already connected through others, -1 -> one for every eight rooms
+	void SetLoopCount( int count ) { mLoopCount = count; }
+	// Most doors between the first room and any other through the tree, 0 -> no limit
+	void SetMaxBranchDepth( int depth ) { mMaxBranchDepth = depth; }
+
+	void PlaceRooms( DungeonGenerator& generator );
+
+private:
+	// Add the neighbors of cell to the frontier of the tree
+	void AddFrontier( int cell );
+	// Rooms of two neighboring cells, with a corridor between them
+	void Connect( DungeonGenerator& generator, int a, int b );
+
+	int mRoomCount;
+	int mLoopCount;
+	int mMaxBranchDepth;
+
+	// Lattice, cell index is x * mCellsY + y
+	int mCellsX, mCellsY;
+	int mCellW, mCellH;
+	int mOriginX, mOriginY;
+	std::vector< int > mDepths;			// Per cell, -1 if it has no room
+	std::vector< int > mParents;		// Per cell, -1 for the first room
+	std::vector< Room* > mRooms;		// Per cell
+	std::vector< int > mOrder;			// Cells in the order they joined the tree
+	std::vector< int > mFrontier;		// Pairs of cells, one in the tree and a neighbor that may join it
+	std::vector< int > mLoops;			// Pairs of cells
+};
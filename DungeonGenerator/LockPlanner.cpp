@@ -0,0 +1,259 @@
+#include "LockPlanner.h"
+#include "SectorGraph.h"
+#include "DistanceField.h"
+#include "DungeonGenerator.h"
+#include "RNG.h"
+
+#include <algorithm>
+#include <deque>
+
+//---------------------------------------
+LockPlanner::LockPlanner()
+	: mCriticalPathLength( -1 )
+{}
+//---------------------------------------
+void LockPlanner::Clear()
+{
+	mOrder.clear();
+	mKeys.clear();
+	mLockIds.clear();
+	mCriticalPathLength = -1;
+}
+//---------------------------------------
+void LockPlanner::Plan( const SectorGraph& graph, const TileGrid& grid, int startTile, const DistanceField& doorDistances, RNG& rng )
+{
+	Clear();
+
+	const int h = grid.GetHeight();
+	const int sectorCount = graph.GetSectorCount();
+	mLockIds.assign( graph.GetDoorCount(), 0 );
+
+	if ( startTile < 0 || startTile >= grid.GetWidth() * h )
+		return;
+	const Tile& start = grid.GetTileAt( startTile / h, startTile % h );
+	const int startSector = SectorGraph::IsWalkable( start ) ? start.mSectorId : 0;
+	if ( startSector <= 0 || startSector > sectorCount )
+		return;
+
+	// Doors not tried yet from each sector, copies of the graph's rows that shrink as doors are tried
+	std::vector< int > doors;
+	std::vector< int > doorStarts( sectorCount + 1 );
+	std::vector< int > doorCounts( sectorCount + 1 );
+	for ( int i = 0; i <= sectorCount; ++i )
+	{
+		const int* row = graph.GetNeighborDoors( i );
+		doorStarts[i] = (int) doors.size();
+		doorCounts[i] = graph.GetNeighborCount( i );
+		doors.insert( doors.end(), row, row + doorCounts[i] );
+	}
+
+	std::vector< int > orderIndex( sectorCount + 1, -1 );	// Position in mOrder, -1 if not visited
+	mOrder.push_back( startSector );
+	orderIndex[ startSector ] = 0;
+
+	// Depth first, each door is tried once so this is O(sectors + doors)
+	std::vector< int > stack( 1, startSector );
+	while ( !stack.empty() )
+	{
+		const int sector = stack.back();
+		int& count = doorCounts[ sector ];
+
+		// Backtrack
+		if ( count == 0 )
+		{
+			stack.pop_back();
+			continue;
+		}
+
+		// Take a random door out of this sector's row
+		int* row = &doors[ doorStarts[ sector ] ];
+		const unsigned index = rng.RandomIndex( (unsigned) count );
+		const int doorIndex = row[ index ];
+		row[ index ] = row[ --count ];
+
+		const SectorGraph::Door& door = graph.GetDoor( doorIndex );
+		const bool forward = door.mStartSector == sector;
+		const int next = forward ? door.mEndSector : door.mStartSector;
+		if ( next == 0 || orderIndex[ next ] >= 0 )
+			continue;
+
+		// The key goes in the sector entered last, every sector entered so far can be reached without it
+		const int keySector = mOrder.back();
+		Key key = { next, keySector, PickKeyTile( graph, grid, keySector, doorDistances, rng ) };
+		mKeys.push_back( key );
+		mLockIds[ doorIndex ] = next;
+
+		orderIndex[ next ] = (int) mOrder.size();
+		mOrder.push_back( next );
+		stack.push_back( next );
+	}
+
+	// The other doors are never needed to get anywhere, they take the key of the side entered later
+	// Doors with no key on either side, i.e. between the start and a wall, are left open
+	for ( int i = 0; i < graph.GetDoorCount(); ++i )
+	{
+		if ( mLockIds[i] != 0 )
+			continue;
+
+		const SectorGraph::Door& door = graph.GetDoor( i );
+		const int a = door.mStartSector > 0 ? orderIndex[ door.mStartSector ] : -1;
+		const int b = door.mEndSector > 0 ? orderIndex[ door.mEndSector ] : -1;
+		if ( a > 0 || b > 0 )
+			mLockIds[i] = a > b ? door.mStartSector : door.mEndSector;
+	}
+}
+//---------------------------------------
+int LockPlanner::PickKeyTile( const SectorGraph& graph, const TileGrid& grid, int sectorId, const DistanceField& doorDistances, RNG& rng )
+{
+	const int h = grid.GetHeight();
+	const int* tiles = graph.GetTiles( sectorId );
+	const int tileCount = graph.GetTileCount( sectorId );
+
+	// Floors of the sector and how many are at each distance from a door, unreachable ones count as 0
+	mFloors.clear();
+	mDistanceCounts.clear();
+	for ( int i = 0; i < tileCount; ++i )
+	{
+		const int x = tiles[i] / h;
+		const int y = tiles[i] % h;
+		if ( grid.GetTileAt( x, y ).mType != Tile::Tile_FLOOR )
+			continue;
+		const int d = std::max( doorDistances.GetDistance( x, y ), 0 );
+		if ( d >= (int) mDistanceCounts.size() )
+			mDistanceCounts.resize( d + 1, 0 );
+		++mDistanceCounts[d];
+		mFloors.push_back( tiles[i] );
+	}
+	if ( mFloors.empty() )
+		return tileCount > 0 ? tiles[0] : -1;
+
+	// Farthest tenth, every floor at least as far as the tenth farthest one
+	const int candidates = (int) ( mFloors.size() * 0.1f ) + 1;
+	int minDistance = (int) mDistanceCounts.size() - 1;
+	for ( int seen = mDistanceCounts[ minDistance ]; seen < candidates; seen += mDistanceCounts[ minDistance ] )
+		--minDistance;
+
+	int count = 0;
+	for ( auto itr = mFloors.begin(); itr != mFloors.end(); ++itr )
+	{
+		if ( std::max( doorDistances.GetDistance( *itr / h, *itr % h ), 0 ) >= minDistance )
+			mFloors[ count++ ] = *itr;
+	}
+	return mFloors[ rng.RandomIndex( (unsigned) count ) ];
+}
+//---------------------------------------
+bool LockPlanner::Solve( const SectorGraph& graph, const TileGrid& grid, const std::vector< Key >& keys, int startSector, int exitSector )
+{
+	mCriticalPathLength = -1;
+
+	const int sectorCount = graph.GetSectorCount();
+	if ( startSector <= 0 || startSector > sectorCount || exitSector <= 0 || exitSector > sectorCount )
+		return false;
+	const int h = grid.GetHeight();
+
+	// Keys in each sector as CSR
+	std::vector< int > keyOffsets( sectorCount + 2, 0 );
+	for ( auto itr = keys.begin(); itr != keys.end(); ++itr )
+	{
+		if ( itr->mSectorId > 0 && itr->mSectorId <= sectorCount )
+			++keyOffsets[ itr->mSectorId + 1 ];
+	}
+	for ( int i = 1; i <= sectorCount + 1; ++i )
+		keyOffsets[i] += keyOffsets[ i - 1 ];
+	std::vector< int > keyIds( keyOffsets.back() );
+	{
+		std::vector< int > next( keyOffsets.begin(), keyOffsets.end() - 1 );
+		for ( auto itr = keys.begin(); itr != keys.end(); ++itr )
+		{
+			if ( itr->mSectorId > 0 && itr->mSectorId <= sectorCount )
+				keyIds[ next[ itr->mSectorId ]++ ] = itr->mKeyId;
+		}
+	}
+
+	// Each sector's level is the number of doors that have to be unlocked one after the other to reach it
+	// Open doors cost nothing and locked ones cost one, so a 0-1 breadth first search settles every level
+	// Doors reached before their key wait in a list per key, linked through pendingNext
+	std::vector< int > level( sectorCount + 1, -1 );
+	std::vector< bool > settled( sectorCount + 1, false );
+	std::vector< bool > haveKey( sectorCount + 1, false );
+	std::vector< int > pendingHead( sectorCount + 1, -1 );
+	std::vector< int > pendingSector;
+	std::vector< int > pendingNext;
+	std::deque< int > queue;
+
+	level[ startSector ] = 0;
+	queue.push_back( startSector );
+	while ( !queue.empty() )
+	{
+		const int sector = queue.front();
+		queue.pop_front();
+		if ( settled[ sector ] )
+			continue;
+		settled[ sector ] = true;
+		const int current = level[ sector ];
+
+		// Pick up the keys here and open the doors that were waiting on them
+		for ( int i = keyOffsets[ sector ]; i < keyOffsets[ sector + 1 ]; ++i )
+		{
+			const int keyId = keyIds[i];
+			if ( keyId <= 0 || keyId > sectorCount || haveKey[ keyId ] )
+				continue;
+			haveKey[ keyId ] = true;
+			for ( int j = pendingHead[ keyId ]; j >= 0; j = pendingNext[j] )
+			{
+				const int next = pendingSector[j];
+				if ( !settled[ next ] && ( level[ next ] < 0 || level[ next ] > current + 1 ) )
+				{
+					level[ next ] = current + 1;
+					queue.push_back( next );
+				}
+			}
+			pendingHead[ keyId ] = -1;
+		}
+
+		const int* neighbors = graph.GetNeighbors( sector );
+		const int* doors = graph.GetNeighborDoors( sector );
+		for ( int i = 0; i < graph.GetNeighborCount( sector ); ++i )
+		{
+			const int next = neighbors[i];
+			if ( next == 0 || settled[ next ] )
+				continue;
+
+			const int doorTile = graph.GetDoor( doors[i] ).mTile;
+			const Tile& tile = grid.GetTileAt( doorTile / h, doorTile % h );
+			const int lockId = tile.mLocked ? tile.mSectorId : 0;
+			if ( lockId == 0 )
+			{
+				if ( level[ next ] < 0 || level[ next ] > current )
+				{
+					level[ next ] = current;
+					queue.push_front( next );
+				}
+			}
+			else if ( lockId > sectorCount )
+			{
+				// No key can open it
+			}
+			else if ( haveKey[ lockId ] )
+			{
+				if ( level[ next ] < 0 || level[ next ] > current + 1 )
+				{
+					level[ next ] = current + 1;
+					queue.push_back( next );
+				}
+			}
+			else
+			{
+				pendingSector.push_back( next );
+				pendingNext.push_back( pendingHead[ lockId ] );
+				pendingHead[ lockId ] = (int) pendingSector.size() - 1;
+			}
+		}
+	}
+
+	if ( !settled[ exitSector ] )
+		return false;
+	mCriticalPathLength = level[ exitSector ];
+	return true;
+}
+//---------------------------------------
@@ -0,0 +1,64 @@
+/*
+ * Description :
+ *   Lock and key placement over a SectorGraph, linear in sectors and doors.
+ *   Plan() walks the graph depth first from the entrance, choosing the next
+ *   locked door at random. Each sector it enters gets a key, left in the
+ *   sector entered just before it on a floor tile among the farthest tenth
+ *   from the sector's doors, read from the generator's door distance field.
+ *   Solve() replays a floor the way a player would and reports how
+ *   many unlocks in a row it takes to reach the exit.
+ */
+
+#pragma once
+
+#include <vector>
+
+class SectorGraph;
+class TileGrid;
+class RNG;
+class DistanceField;
+
+class LockPlanner
+{
+public:
+	struct Key
+	{
+		int mKeyId;		// Sector the key unlocks
+		int mSectorId;	// Sector the key is placed in
+		int mTile;		// Tile index x * height + y
+	};
+
+	LockPlanner();
+
+	// Plan the locks and keys of graph, starting from startTile, a walkable tile index x * height + y
+	// doorDistances is the walking distance of every tile from the nearest door
+	void Plan( const SectorGraph& graph, const TileGrid& grid, int startTile, const DistanceField& doorDistances, RNG& rng );
+	void Clear();
+
+	// Sectors reachable from the start, in the order they are unlocked
+	const std::vector< int >& GetVisitOrder() const { return mOrder; }
+	const std::vector< Key >& GetKeys() const { return mKeys; }
+	// Key id that opens each locked door of the graph, 0 if no key does and the door should be left open
+	int GetLockId( int door ) const { return mLockIds[ door ]; }
+
+	// Walk a floor as a player would, collecting every key in reach and opening every door they can
+	// Lock ids come from the mSectorId of each locked door tile, 0 for one left open. Key tiles are not used
+	// Returns true if exitSector can be reached from startSector
+	bool Solve( const SectorGraph& graph, const TileGrid& grid, const std::vector< Key >& keys, int startSector, int exitSector );
+	// Doors unlocked one after the other on the way to the exit in the last Solve(), -1 if it failed
+	int GetCriticalPathLength() const { return mCriticalPathLength; }
+
+private:
+	// Random floor tile of sectorId among the farthest tenth from its doors
+	// Any walkable tile of the sector if it has no floors
+	int PickKeyTile( const SectorGraph& graph, const TileGrid& grid, int sectorId, const DistanceField& doorDistances, RNG& rng );
+
+	std::vector< int > mOrder;
+	std::vector< Key > mKeys;
+	std::vector< int > mLockIds;		// Per door of the graph
+	int mCriticalPathLength;
+
+	// Scratch
+	std::vector< int > mFloors;			// Floor tiles of the sector a key is being placed in
+	std::vector< int > mDistanceCounts;	// Floors of that sector at each distance from a door
+};
@@ -1,6 +1,7 @@
 #include "Logger.h"
 
 #include <stdio.h>
+#include <stdlib.h>
 
 #ifdef WIN32
 #   include <Windows.h>
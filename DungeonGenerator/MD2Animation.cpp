@@ -6,7 +6,7 @@
 MD2Animation::MD2Animation( MD2Model* model, int textureIndex )
 	: mModel( model )
 	, mOnCompleteCB( 0 )
-	, mCurrentAnimName( 0 )
+	, mCurrentAnimName( SYMBOL_NONE )
 	, mCurrentFrame( 0 )
 	, mNextFrame( 0 )
 	, mStartFrame( 0 )
@@ -61,10 +61,15 @@ void MD2Animation::Draw( Window* window )
 //---------------------------------------
 void MD2Animation::PlayAnim( const std::string& name, bool loop )
 {
-	PlayAnim( name.c_str(), loop );
+	PlayAnim( SymbolTable::Intern( name ), loop );
 }
 //---------------------------------------
 void MD2Animation::PlayAnim( const char* name, bool loop )
+{
+	PlayAnim( SymbolTable::Intern( name ), loop );
+}
+//---------------------------------------
+void MD2Animation::PlayAnim( Symbol name, bool loop )
 {
 	const MD2Model::MD2AnimInfo* animInfo = mModel->GetAnimationInfo( name );
 	if ( animInfo )
@@ -91,8 +96,8 @@ void MD2Animation::Resume()
 	mIsPlaying = false;
 }
 //---------------------------------------
-bool MD2Animation::IsAnimationPlaying( const char* animName ) const
+bool MD2Animation::IsAnimationPlaying( Symbol animName ) const
 {
-	return mIsPlaying && !strcmp( animName, mCurrentAnimName );
+	return mIsPlaying && animName == mCurrentAnimName;
 }
 //---------------------------------------
\ No newline at end of file
@@ -7,6 +7,8 @@
  
 #pragma once
 
+#include "SymbolTable.h"
+
 #include <string>
 
 class MD2Model;
@@ -18,7 +20,7 @@ public:
 	class OnAnimationCompleteListener
 	{
 	public:
-		virtual void OnAnimationComplete( const char* animName ) = 0;
+		virtual void OnAnimationComplete( Symbol animName ) = 0;
 	};
 
 	MD2Animation( MD2Model* model, int textureIndex=0 );
@@ -27,19 +29,20 @@ public:
 	void Update( float dt );
 	void Draw( Window* window );
 
+	void PlayAnim( Symbol name, bool loop=true );
 	void PlayAnim( const std::string& name, bool loop=true );
 	void PlayAnim( const char* name, bool loop=true );
 	void Pause();
 	void Resume();
 	void SetPlayRate( int rate ) { mRate = rate; }
 	void SetOnCompleteListener( OnAnimationCompleteListener* onCompleteListener ) { mOnCompleteCB = onCompleteListener; }
-	bool IsAnimationPlaying( const char* animName ) const;
+	bool IsAnimationPlaying( Symbol animName ) const;
 	void SetTextureIndex( int index ) { mTextureIndex = index; }
 
 private:
 	MD2Model* mModel;
 	OnAnimationCompleteListener* mOnCompleteCB;
-	const char* mCurrentAnimName;
+	Symbol mCurrentAnimName;
 	int mCurrentFrame;
 	int mNextFrame;
 	int mStartFrame;
@@ -73,6 +73,7 @@ MD2Model::~MD2Model()
 {
 	FreeMD2Data();
 	delete[] mTextures;
+	mAnimInfo.DeleteAll();
 }
 //---------------------------------------
 void MD2Model::FreeMD2Data()
@@ -405,6 +406,7 @@ void MD2Model::CacheAnimInfo()
 	int endFrame = 0;
 	int nFrames = 0;
 	int frameCount = 0;
+	bool hasAnims = false;
 
 	GetFrameName( &mFrames[0], last );
 
@@ -423,10 +425,11 @@ void MD2Model::CacheAnimInfo()
 			printf( "MD2Anim\n name: %s\n frames: %d\n start: %d\n end: %d\n"
 				, last, frameCount, startFrame, endFrame );
 #endif
-			MD2AnimInfo& info = mAnimInfo[ last ];
+			MD2AnimInfo& info = AddAnimInfo( last );
 			info.start = startFrame;
 			info.end = endFrame;
 			info.numFrames = frameCount;
+			hasAnims = true;
 
 			strcpy( last, name );
 			nFrames = 0;
@@ -435,28 +438,34 @@ void MD2Model::CacheAnimInfo()
 		++nFrames;
 	}
 
-	if ( mAnimInfo.size() == 0 )
+	if ( !hasAnims )
 	{
 #if MD2_DEBUG_OUTPUT
 		printf( "MD2Anim\n name: %s\n frames: %d\n start: %d\n end: %d\n"
 			, last, frameCount, startFrame, endFrame );
 #endif
-		MD2AnimInfo& info = mAnimInfo[ last ];
+		MD2AnimInfo& info = AddAnimInfo( last );
 		info.start = frameCount - nFrames;
 		info.end = frameCount - 2;
 		info.numFrames = frameCount;
 	}
 }
 //---------------------------------------
-const MD2Model::MD2AnimInfo* MD2Model::GetAnimationInfo( const std::string& animName )
+MD2Model::MD2AnimInfo& MD2Model::AddAnimInfo( const char* animName )
 {
-	MD2AnimInfo* info = 0;
-	auto found = mAnimInfo.find( animName );
-	if ( found != mAnimInfo.end() )
+	const Symbol name = SymbolTable::Intern( animName );
+	MD2AnimInfo* info = mAnimInfo.Find( name );
+	if ( !info )
 	{
-		info = &found->second;
+		info = new MD2AnimInfo();
+		info->name = name;
+		mAnimInfo.Add( name, info );
 	}
-
-	return info;
+	return *info;
+}
+//---------------------------------------
+const MD2Model::MD2AnimInfo* MD2Model::GetAnimationInfo( Symbol animName ) const
+{
+	return mAnimInfo.Find( animName );
 }
 //---------------------------------------
\ No newline at end of file
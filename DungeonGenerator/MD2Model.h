@@ -7,6 +7,8 @@
  
 #pragma once
 
+#include "SymbolTable.h"
+
 #include <vector>
 #include <map>
 
@@ -90,7 +92,7 @@ private:
 public:
 	struct MD2AnimInfo
 	{
-		char name[16];
+		Symbol name;
 		int start;
 		int end;
 		int numFrames;
@@ -118,7 +120,7 @@ private:
 	unsigned mIdIBO;
 	unsigned mNumIndices;
 	Texture2D** mTextures;
-	std::map< std::string, MD2AnimInfo > mAnimInfo;
+	SymbolMap< MD2AnimInfo > mAnimInfo;
 
 	static std::map< std::string, MD2Model* > mModelRegistry;
 
@@ -126,6 +128,7 @@ private:
 	~MD2Model();
 
 	void CacheAnimInfo();
+	MD2AnimInfo& AddAnimInfo( const char* animName );
 	void FreeMD2Data();
 public:
 	// Creates and registers a new MD2Model
@@ -138,7 +141,7 @@ public:
 	void Draw( int frame, int textureIndex=0 );
 	void DrawInterpolated( int frame1, int frame2, float mix, int textureIndex=0 );
 	
-	const MD2AnimInfo* GetAnimationInfo( const std::string& animName );
+	const MD2AnimInfo* GetAnimationInfo( Symbol animName ) const;
 
 	// Remove the numbers from the frame tag
 	static char* GetFrameName( MD2Frame* frame, char _out_name[16] );
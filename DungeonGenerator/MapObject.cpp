@@ -27,6 +27,8 @@ void MapObject::LoadAssets()
 //---------------------------------------
 void MapObject::InitPhysics( PhysicsWorld* world )
 {
+	Object::InitPhysics( world );
+
 	btCollisionShape* shape = mMesh->GetCollisionShape();
 	if ( !shape )
 		shape = world->GenerateTriangleMeshCollision( mMesh );
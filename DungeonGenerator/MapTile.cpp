@@ -28,6 +28,8 @@ void MapTile::LoadAssets()
 //---------------------------------------
 void MapTile::InitPhysics( PhysicsWorld* world )
 {
+	Object::InitPhysics( world );
+
 	btCollisionShape* shape = mMesh->GetCollisionShape();
 	if ( !shape )
 		shape = world->GenerateTriangleMeshCollision( mMesh );
@@ -0,0 +1,16 @@
+/*
+ * Description :
+ *   Math helpers with no engine dependencies.
+ *   Safe to use from the headless generator library.
+ */
+ 
+#pragma once
+
+#include <stdlib.h>
+
+inline int GetManhattanDistance( int sx, int sy, int ex, int ey)
+{
+	int dx = ex - sx;
+	int dy = ey - sy;
+	return abs( dx ) + abs( dy );
+}
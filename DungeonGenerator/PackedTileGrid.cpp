@@ -0,0 +1,215 @@
+#include "PackedTileGrid.h"
+
+#include <math.h>
+#include <algorithm>
+
+namespace
+{
+	//---------------------------------------
+	// Index of p in palette, adding it if it is new
+	template< typename T >
+	uint16 GetPaletteIndex( T* p, std::vector< T* >& palette )
+	{
+		auto itr = std::find( palette.begin(), palette.end(), p );
+		if ( itr != palette.end() )
+			return (uint16) ( itr - palette.begin() );
+		palette.push_back( p );
+		return (uint16) ( palette.size() - 1 );
+	}
+	//---------------------------------------
+	int16 QuantizeHeight( float z )
+	{
+		const float q = floorf( z * PackedTileGrid::HEIGHT_SCALE + 0.5f );
+		return (int16) std::min( std::max( q, -32768.0f ), 32767.0f );
+	}
+}
+
+//---------------------------------------
+PackedTileGrid::PackedTileGrid()
+	: mWidth( 0 )
+	, mHeight( 0 )
+{
+	Clear();
+}
+//---------------------------------------
+void PackedTileGrid::Resize( int w, int h )
+{
+	Clear();
+	mWidth = w;
+	mHeight = h;
+
+	const size_t count = (size_t) w * h;
+	mTypes.assign( count, (uint8) Tile::Tile_NONE );
+	mSectorIds.assign( count, 0 );
+	mHeights.assign( count, 0 );
+	for ( int i = 0; i < FLAG_COUNT; ++i )
+		mFlags[i].assign( ( count + 63 ) / 64, 0 );
+	mStyles.assign( count, 0 );
+	mObjects.assign( count, 0 );
+	mTemplates.assign( count, 0 );
+	mDoorStyles.assign( count, 0 );
+	mVariants.assign( count, -1 );
+}
+//---------------------------------------
+void PackedTileGrid::Clear()
+{
+	mWidth = mHeight = 0;
+	mTypes.clear();
+	mSectorIds.clear();
+	mHeights.clear();
+	for ( int i = 0; i < FLAG_COUNT; ++i )
+		mFlags[i].clear();
+	mStyles.clear();
+	mObjects.clear();
+	mTemplates.clear();
+	mDoorStyles.clear();
+	mVariants.clear();
+
+	mStylePalette.assign( 1, (TileStyle*) 0 );
+	mObjectPalette.assign( 1, (TileObject*) 0 );
+	mTemplatePalette.assign( 1, (RoomTemplate*) 0 );
+}
+//---------------------------------------
+bool PackedTileGrid::Pack( const TileGrid& grid )
+{
+	Resize( grid.GetWidth(), grid.GetHeight() );
+
+	// Neighboring tiles mostly share a style so remember the last lookup
+	TileStyle* lastStyle = 0;
+	TileObject* lastObject = 0;
+	RoomTemplate* lastTemplate = 0;
+	uint16 lastStyleIndex = 0, lastObjectIndex = 0, lastTemplateIndex = 0;
+
+	bool ok = true;
+	for ( int x = 0; x < mWidth; ++x )
+	{
+		for ( int y = 0; y < mHeight; ++y )
+		{
+			const Tile& tile = grid.GetTileAt( x, y );
+			const int i = GetIndex( x, y );
+
+			ok = ok && tile.mType >= 0 && tile.mType <= 0xFF && tile.mSectorId >= 0 && tile.mSectorId <= 0xFFFF;
+			mTypes[i] = (uint8) tile.mType;
+			mSectorIds[i] = (uint16) tile.mSectorId;
+			mHeights[i] = QuantizeHeight( tile.z );
+			if ( tile.mRevealed )
+				SetFlag( x, y, Flag_REVEALED, true );
+			if ( tile.mLocked )
+				SetFlag( x, y, Flag_LOCKED, true );
+			if ( tile.mBlockObjectSpawn )
+				SetFlag( x, y, Flag_BLOCK_OBJECT_SPAWN, true );
+
+			if ( tile.mStyle != lastStyle )
+			{
+				lastStyle = tile.mStyle;
+				lastStyleIndex = GetPaletteIndex( tile.mStyle, mStylePalette );
+			}
+			if ( tile.mObject != lastObject )
+			{
+				lastObject = tile.mObject;
+				lastObjectIndex = GetPaletteIndex( tile.mObject, mObjectPalette );
+			}
+			if ( tile.mRoomTemplate != lastTemplate )
+			{
+				lastTemplate = tile.mRoomTemplate;
+				lastTemplateIndex = GetPaletteIndex( tile.mRoomTemplate, mTemplatePalette );
+			}
+			mStyles[i] = lastStyleIndex;
+			mObjects[i] = lastObjectIndex;
+			mTemplates[i] = lastTemplateIndex;
+
+			// Only door frames have one
+			if ( tile.mDoorStyle )
+				mDoorStyles[i] = GetPaletteIndex( tile.mDoorStyle, mStylePalette );
+			ok = ok && tile.mObjectVariant >= -0x8000 && tile.mObjectVariant <= 0x7FFF;
+			mVariants[i] = (int16) tile.mObjectVariant;
+		}
+	}
+
+	const size_t maxPalette = 0x10000;
+	return ok && mStylePalette.size() <= maxPalette && mObjectPalette.size() <= maxPalette && mTemplatePalette.size() <= maxPalette;
+}
+//---------------------------------------
+void PackedTileGrid::Unpack( TileGrid& grid ) const
+{
+	grid.Resize( mWidth, mHeight );
+	for ( int x = 0; x < mWidth; ++x )
+	{
+		for ( int y = 0; y < mHeight; ++y )
+			grid.GetTileAt( x, y ) = GetTileAt( x, y );
+	}
+}
+//---------------------------------------
+Tile PackedTileGrid::GetTileAt( int x, int y ) const
+{
+	if ( !IsInBounds( x, y ) )
+		return Tile::NULL_TILE;
+
+	const int i = GetIndex( x, y );
+	Tile tile;
+	tile.SetLocation( x, y );
+	tile.mType = mTypes[i];
+	tile.mSectorId = mSectorIds[i];
+	tile.z = mHeights[i] / (float) HEIGHT_SCALE;
+	tile.mRevealed = GetFlag( x, y, Flag_REVEALED );
+	tile.mLocked = GetFlag( x, y, Flag_LOCKED );
+	tile.mBlockObjectSpawn = GetFlag( x, y, Flag_BLOCK_OBJECT_SPAWN );
+	tile.mStyle = mStylePalette[ mStyles[i] ];
+	tile.mObject = mObjectPalette[ mObjects[i] ];
+	tile.mRoomTemplate = mTemplatePalette[ mTemplates[i] ];
+	tile.mDoorStyle = mStylePalette[ mDoorStyles[i] ];
+	tile.mObjectVariant = mVariants[i];
+	return tile;
+}
+//---------------------------------------
+void PackedTileGrid::SetTileAt( int x, int y, const Tile& tile )
+{
+	if ( !IsInBounds( x, y ) )
+		return;
+
+	const int i = GetIndex( x, y );
+	mTypes[i] = (uint8) tile.mType;
+	mSectorIds[i] = (uint16) tile.mSectorId;
+	mHeights[i] = QuantizeHeight( tile.z );
+	SetFlag( x, y, Flag_REVEALED, tile.mRevealed );
+	SetFlag( x, y, Flag_LOCKED, tile.mLocked );
+	SetFlag( x, y, Flag_BLOCK_OBJECT_SPAWN, tile.mBlockObjectSpawn );
+	mStyles[i] = GetPaletteIndex( tile.mStyle, mStylePalette );
+	mObjects[i] = GetPaletteIndex( tile.mObject, mObjectPalette );
+	mTemplates[i] = GetPaletteIndex( tile.mRoomTemplate, mTemplatePalette );
+	mDoorStyles[i] = GetPaletteIndex( tile.mDoorStyle, mStylePalette );
+	mVariants[i] = (int16) tile.mObjectVariant;
+}
+//---------------------------------------
+bool PackedTileGrid::GetFlag( int x, int y, TileFlag flag ) const
+{
+	const int i = GetIndex( x, y );
+	return ( mFlags[ flag ][ i >> 6 ] >> ( i & 63 ) & 1 ) != 0;
+}
+//---------------------------------------
+void PackedTileGrid::SetFlag( int x, int y, TileFlag flag, bool value )
+{
+	const int i = GetIndex( x, y );
+	const uint64 bit = (uint64) 1 << ( i & 63 );
+	if ( value )
+		mFlags[ flag ][ i >> 6 ] |= bit;
+	else
+		mFlags[ flag ][ i >> 6 ] &= ~bit;
+}
+//---------------------------------------
+size_t PackedTileGrid::GetMemoryUsage() const
+{
+	size_t bytes = mTypes.size() * sizeof( uint8 )
+		+ mSectorIds.size() * sizeof( uint16 )
+		+ mHeights.size() * sizeof( int16 )
+		+ mStyles.size() * sizeof( uint16 )
+		+ mObjects.size() * sizeof( uint16 )
+		+ mTemplates.size() * sizeof( uint16 )
+		+ mDoorStyles.size() * sizeof( uint16 )
+		+ mVariants.size() * sizeof( int16 );
+	for ( int i = 0; i < FLAG_COUNT; ++i )
+		bytes += mFlags[i].size() * sizeof( uint64 );
+	bytes += ( mStylePalette.size() + mObjectPalette.size() + mTemplatePalette.size() ) * sizeof( void* );
+	return bytes;
+}
+//---------------------------------------
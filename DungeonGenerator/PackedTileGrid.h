@@ -0,0 +1,90 @@
+/*
+ * Description :
+ *   Structure of arrays storage for a finished TileGrid.
+ *   Each Tile field lives in its own plane: uint8 type, uint16 sector,
+ *   quantized int16 height, one bit per flag, an int16 spawner variant and
+ *   16 bit ids into palettes of styles, objects and room templates. About
+ *   16 bytes a cell instead of a Tile's 72, and full grid scans only touch
+ *   the planes they read.
+ *   Tile::mRoom is not kept since it is only valid during generation.
+ */
+
+#pragma once
+
+#include "DungeonGenerator.h"
+#include "Types.h"
+
+#include <vector>
+
+class PackedTileGrid
+{
+public:
+	// Heights are stored in steps of 1 / HEIGHT_SCALE
+	static const int HEIGHT_SCALE = 8;
+
+	enum TileFlag
+	{
+		Flag_REVEALED,
+		Flag_LOCKED,
+		Flag_BLOCK_OBJECT_SPAWN,
+		FLAG_COUNT
+	};
+
+	PackedTileGrid();
+
+	// Resize the grid and make every tile empty
+	void Resize( int w, int h );
+	void Clear();
+
+	// Copy every tile of grid
+	// Returns false if a tile does not fit, i.e. a sector id over 65535
+	bool Pack( const TileGrid& grid );
+	// Copy every tile into grid, resizing it to match
+	void Unpack( TileGrid& grid ) const;
+
+	int GetWidth() const { return mWidth; }
+	int GetHeight() const { return mHeight; }
+	bool IsInBounds( int x, int y ) const { return x >= 0 && y >= 0 && x < mWidth && y < mHeight; }
+
+	// Accessor layer
+	// Tiles are built on request, NULL_TILE out of bounds
+	Tile GetTileAt( int x, int y ) const;
+	void SetTileAt( int x, int y, const Tile& tile );
+
+	int GetType( int x, int y ) const { return mTypes[ GetIndex( x, y ) ]; }
+	int GetSectorId( int x, int y ) const { return mSectorIds[ GetIndex( x, y ) ]; }
+	float GetZ( int x, int y ) const { return mHeights[ GetIndex( x, y ) ] / (float) HEIGHT_SCALE; }
+	bool GetFlag( int x, int y, TileFlag flag ) const;
+	void SetFlag( int x, int y, TileFlag flag, bool value );
+	TileStyle* GetStyle( int x, int y ) const { return mStylePalette[ mStyles[ GetIndex( x, y ) ] ]; }
+	TileObject* GetObject( int x, int y ) const { return mObjectPalette[ mObjects[ GetIndex( x, y ) ] ]; }
+	TileStyle* GetDoorStyle( int x, int y ) const { return mStylePalette[ mDoorStyles[ GetIndex( x, y ) ] ]; }
+	int GetObjectVariant( int x, int y ) const { return mVariants[ GetIndex( x, y ) ]; }
+	RoomTemplate* GetRoomTemplate( int x, int y ) const { return mTemplatePalette[ mTemplates[ GetIndex( x, y ) ] ]; }
+
+	// Planes, one value per tile at x * height + y
+	const uint8* GetTypePlane() const { return mTypes.empty() ? 0 : &mTypes[0]; }
+	const uint16* GetSectorPlane() const { return mSectorIds.empty() ? 0 : &mSectorIds[0]; }
+
+	// Bytes held by the planes and palettes
+	size_t GetMemoryUsage() const;
+
+private:
+	int GetIndex( int x, int y ) const { return x * mHeight + y; }
+
+	int mWidth, mHeight;
+	std::vector< uint8 > mTypes;
+	std::vector< uint16 > mSectorIds;
+	std::vector< int16 > mHeights;
+	std::vector< uint64 > mFlags[ FLAG_COUNT ];		// One bit per tile
+	std::vector< uint16 > mStyles;					// Index into mStylePalette
+	std::vector< uint16 > mObjects;					// Index into mObjectPalette
+	std::vector< uint16 > mTemplates;				// Index into mTemplatePalette
+	std::vector< uint16 > mDoorStyles;				// Index into mStylePalette
+	std::vector< int16 > mVariants;
+
+	// Entry 0 is always null
+	std::vector< TileStyle* > mStylePalette;
+	std::vector< TileObject* > mObjectPalette;
+	std::vector< RoomTemplate* > mTemplatePalette;
+};
@@ -79,7 +79,7 @@ void Pickup::LoadPickupTempaltesFromXml( const XmlReader::XmlReaderIterator& xml
 	Entity::LoadTemplatesFromXml< Pickup >( xmlItr );
 }
 //---------------------------------------
-Pickup* Pickup::CreatePickup( const std::string& templateName )
+Pickup* Pickup::CreatePickup( Symbol templateName )
 {
 	return Entity::CreateEntity< Pickup >( templateName );
 }
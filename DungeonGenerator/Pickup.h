@@ -25,7 +25,7 @@ class Pickup
 	friend class PickupFactory;
 public:
 	static void LoadPickupTempaltesFromXml( const XmlReader::XmlReaderIterator& xmlItr );
-	static Pickup* CreatePickup( const std::string& templateName );
+	static Pickup* CreatePickup( Symbol templateName );
 
 	Pickup();
 	virtual ~Pickup();
@@ -1,11 +1,39 @@
 #include "RNG.h"
 
-unsigned long RNG::Seed;
+namespace
+{
+	// SplitMix64 finalizer, spreads nearby seeds and stream ids apart
+	uint64_t Mix( uint64_t x )
+	{
+		x += 0x9E3779B97F4A7C15ULL;
+		x = ( x ^ ( x >> 30 ) ) * 0xBF58476D1CE4E5B9ULL;
+		x = ( x ^ ( x >> 27 ) ) * 0x94D049BB133111EBULL;
+		return x ^ ( x >> 31 );
+	}
+}
 
 //---------------------------------------
-RNG::RNG()
-{}
+RNG::RNG( uint64_t seed, uint64_t stream )
+{
+	SetRandomSeed( seed, stream );
+}
 //---------------------------------------
 RNG::~RNG()
 {}
-//---------------------------------------
\ No newline at end of file
+//---------------------------------------
+void RNG::SetRandomSeed( uint64_t seed, uint64_t stream )
+{
+	mSeed = seed;
+	mStream = stream;
+	mState = 0;
+	mIncrement = ( stream << 1 ) | 1;
+	Rand();
+	mState += seed;
+	Rand();
+}
+//---------------------------------------
+RNG RNG::Split( uint64_t streamId ) const
+{
+	return RNG( Mix( mSeed ^ Mix( streamId ) ), Mix( mStream + streamId + 1 ) );
+}
+//---------------------------------------
@@ -2,62 +2,129 @@
  * Author      : Matthew Johnson
  * Date        : 15/Apr/2013
  * Description :
- *   
+ *   Random number generator (PCG32, 64 bit state, 32 bit output).
+ *   Each generator owns its own RNG so results only depend on the seed.
+ *   Split() derives independent substreams for rooms or worker threads.
  */
  
 #pragma once
 
+#include <stdint.h>
+
 
 class RNG
 {
 public:
+	typedef uint32_t result_type;
+
+	RNG( uint64_t seed=0, uint64_t stream=0 );
 	~RNG();
 
 	// [0, 1]
-	static float RandomUnit()
+	float RandomUnit()
 	{
-		return static_cast< float >( Rand() ) / static_cast< float >( RandMax );
+		return static_cast< float >( Rand() * ( 1.0 / RandMax ) );
 	}
 
 	// [-1, 1]
-	static float RandomUniform()
+	float RandomUniform()
 	{
 		return static_cast< float >( 2 * RandomUnit() - 1 );
 	}
 
 	// [min, max]
 	template< typename TReal >
-	static TReal RandomInRange( TReal min, TReal max )
+	TReal RandomInRange( TReal min, TReal max )
 	{
 		return static_cast< TReal >( min + ( max - min ) * RandomUnit() );
 	}
 
-	static unsigned RandomIndex( unsigned size )
+	// [min, max], every value equally likely
+	int RandomInRange( int min, int max )
+	{
+		return max <= min ? min : min + (int) RandomIndex( (unsigned) ( max - min ) + 1 );
+	}
+	unsigned RandomInRange( unsigned min, unsigned max )
+	{
+		return max <= min ? min : min + RandomIndex( max - min + 1 );
+	}
+
+	// [0, size)
+	unsigned RandomIndex( unsigned size )
 	{
-		return size == 0 ? 0 : Rand() % size;
+		return (unsigned) ( ( (uint64_t) Rand() * size ) >> 32 );
 	}
 
-	static void SetRandomSeed( unsigned long seed )
+	// Fisher-Yates shuffle
+	// Same result on every platform unlike std::random_shuffle
+	template< typename TIter >
+	void Shuffle( TIter first, TIter last )
 	{
-		Seed = seed;
+		for ( unsigned i = (unsigned) ( last - first ); i > 1; --i )
+		{
+			const unsigned j = RandomIndex( i );
+			if ( j != i - 1 )
+			{
+				auto tmp = *( first + ( i - 1 ) );
+				*( first + ( i - 1 ) ) = *( first + j );
+				*( first + j ) = tmp;
+			}
+		}
 	}
 
-	static unsigned long GetSeed()
+	// Restart the sequence
+	void SetRandomSeed( uint64_t seed, uint64_t stream=0 );
+
+	uint64_t GetSeed() const
 	{
-		return Seed;
+		return mSeed;
 	}
 
-	static unsigned int Rand()
+	// Everything needed to continue the sequence later, i.e. from a saved floor
+	struct State
+	{
+		uint64_t mState;
+		uint64_t mIncrement;
+		uint64_t mSeed;
+		uint64_t mStream;
+	};
+	State GetState() const
+	{
+		const State state = { mState, mIncrement, mSeed, mStream };
+		return state;
+	}
+	void SetState( const State& state )
+	{
+		mState = state.mState;
+		mIncrement = state.mIncrement;
+		mSeed = state.mSeed;
+		mStream = state.mStream;
+	}
+
+	// An independent generator for streamId
+	// Depends only on the seed and stream of this RNG, not how much of it has been used,
+	// so the same streamId always gives the same sequence
+	RNG Split( uint64_t streamId ) const;
+
+	uint32_t Rand()
 	{
-		Seed = Seed * 1103515245 + 12345;
-		return (unsigned int) ( Seed / 65536 ) % 32768;
+		const uint64_t old = mState;
+		mState = old * 6364136223846793005ULL + mIncrement;
+		const uint32_t xorShifted = (uint32_t) ( ( ( old >> 18 ) ^ old ) >> 27 );
+		const uint32_t rot = (uint32_t) ( old >> 59 );
+		return ( xorShifted >> rot ) | ( xorShifted << ( ( 32 - rot ) & 31 ) );
 	}
 
-	static const unsigned long RandMax = 32767;
+	// So RNG can be used with the std algorithms
+	result_type operator()() { return Rand(); }
+	static result_type min() { return 0; }
+	static result_type max() { return RandMax; }
 
-protected:
-	RNG();
+	static const uint32_t RandMax = 0xFFFFFFFF;
 
 private:
-	static unsigned long Seed;
+	uint64_t mState;
+	uint64_t mIncrement;	// Must be odd, selects the stream
+	uint64_t mSeed;
+	uint64_t mStream;
 };
@@ -0,0 +1,116 @@
+/*
+ * Description :
+ *   Cell lists of RoomOccupancy, see RoomOccupancy.h.
+ */
+
+#include "RoomOccupancy.h"
+#include "DungeonGenerator.h"
+
+//---------------------------------------
+RoomOccupancy::RoomOccupancy()
+	: mBuilt( false )
+{}
+//---------------------------------------
+void RoomOccupancy::Build( const TileGrid& grid, const Room& room )
+{
+	for ( int i = 0; i < 3; ++i )
+	{
+		for ( auto itr = mLists[i].begin(); itr != mLists[i].end(); ++itr )
+			itr->mCells.clear();
+	}
+
+	for ( int x = room.x; x < room.x + room.GetWidth(); ++x )
+	{
+		for ( int y = room.y; y < room.y + room.GetHeight(); ++y )
+		{
+			const Tile& tile = grid.GetTileAt( x, y );
+			Add( RuleProgram::Match_USAGE, tile.GetUsageId(), x, y );
+			if ( tile.mObject )
+				Add( RuleProgram::Match_OBJECT, tile.mObject->mNameId, x, y );
+			if ( tile.mStyle )
+				Add( RuleProgram::Match_STYLE, tile.mStyle->mNameId, x, y );
+		}
+	}
+	mBuilt = true;
+}
+//---------------------------------------
+void RoomOccupancy::ChangeStyle( int x, int y, const TileStyle* from, const TileStyle* to )
+{
+	if ( !mBuilt || from == to )
+		return;
+	if ( from )
+		Remove( RuleProgram::Match_STYLE, from->mNameId, x, y );
+	if ( to )
+		Add( RuleProgram::Match_STYLE, to->mNameId, x, y );
+}
+//---------------------------------------
+void RoomOccupancy::ChangeObject( int x, int y, const TileObject* from, const TileObject* to )
+{
+	if ( !mBuilt || from == to )
+		return;
+	if ( from )
+		Remove( RuleProgram::Match_OBJECT, from->mNameId, x, y );
+	if ( to )
+		Add( RuleProgram::Match_OBJECT, to->mNameId, x, y );
+}
+//---------------------------------------
+const std::vector< int >* RoomOccupancy::GetCells( int match, int32 key ) const
+{
+	if ( match < RuleProgram::Match_USAGE || match > RuleProgram::Match_STYLE )
+		return 0;
+
+	const std::vector< CellList >& lists = mLists[ match - 1 ];
+	for ( auto itr = lists.begin(); itr != lists.end(); ++itr )
+	{
+		if ( itr->mKey == key )
+			return itr->mCells.empty() ? 0 : &itr->mCells;
+	}
+	return 0;
+}
+//---------------------------------------
+int RoomOccupancy::GetCount( int match, int32 key ) const
+{
+	const std::vector< int >* cells = GetCells( match, key );
+	return cells ? (int) cells->size() / 2 : 0;
+}
+//---------------------------------------
+void RoomOccupancy::Add( int match, int32 key, int x, int y )
+{
+	std::vector< CellList >& lists = GetLists( match );
+	auto itr = lists.begin();
+	while ( itr != lists.end() && itr->mKey != key )
+		++itr;
+	if ( itr == lists.end() )
+	{
+		lists.push_back( CellList() );
+		itr = lists.end() - 1;
+		itr->mKey = key;
+	}
+	itr->mCells.push_back( x );
+	itr->mCells.push_back( y );
+}
+//---------------------------------------
+void RoomOccupancy::Remove( int match, int32 key, int x, int y )
+{
+	std::vector< CellList >& lists = GetLists( match );
+	for ( auto itr = lists.begin(); itr != lists.end(); ++itr )
+	{
+		if ( itr->mKey != key )
+			continue;
+
+		// Order does not matter to the rules, swap the last pair in
+		std::vector< int >& cells = itr->mCells;
+		for ( size_t i = 0; i < cells.size(); i += 2 )
+		{
+			if ( cells[i] == x && cells[ i + 1 ] == y )
+			{
+				cells[i] = cells[ cells.size() - 2 ];
+				cells[ i + 1 ] = cells.back();
+				cells.resize( cells.size() - 2 );
+				return;
+			}
+		}
+		return;
+	}
+}
+//---------------------------------------
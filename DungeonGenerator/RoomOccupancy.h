@@ -0,0 +1,57 @@
+/*
+ * Description :
+ *   What is on the tiles of one room: for each usage, object name and
+ *   style name the room has, the x,y of every tile with it. Built when
+ *   the room's spawn data is generated and kept up to date as styles
+ *   and objects are picked, so "room contains" is a lookup and "distance
+ *   to" only visits the matching tiles instead of scanning the room.
+ */
+
+#pragma once
+
+#include "Types.h"
+
+#include <vector>
+
+class TileGrid;
+class Room;
+struct TileObject;
+struct TileStyle;
+
+class RoomOccupancy
+{
+public:
+	RoomOccupancy();
+
+	// Read every tile of room from grid
+	void Build( const TileGrid& grid, const Room& room );
+	// Stop using the lists, the tiles may change without them
+	void Invalidate() { mBuilt = false; }
+	bool IsBuilt() const { return mBuilt; }
+
+	// The tile at x,y changed from one style or object to another
+	void ChangeStyle( int x, int y, const TileStyle* from, const TileStyle* to );
+	void ChangeObject( int x, int y, const TileObject* from, const TileObject* to );
+
+	// x,y pairs of the tiles with key, match is a RuleProgram::MatchType
+	// 0 if the room has none or match is not one of usage, object or style
+	const std::vector< int >* GetCells( int match, int32 key ) const;
+	int GetCount( int match, int32 key ) const;
+
+private:
+	struct CellList
+	{
+		int32 mKey;
+		std::vector< int > mCells;
+	};
+
+	// Only called with the matches Build() adds
+	std::vector< CellList >& GetLists( int match ) { return mLists[ match - 1 ]; }
+	void Add( int match, int32 key, int x, int y );
+	void Remove( int match, int32 key, int x, int y );
+
+	// By usage, object and style
+	// Lists that empty out are kept, rooms only have a few keys
+	std::vector< CellList > mLists[3];
+	bool mBuilt;
+};
@@ -0,0 +1,258 @@
+#include "RuleProgram.h"
+#include "DungeonGenerator.h"
+#include "MathUtil.h"
+
+#include <algorithm>
+#include <stdlib.h>
+
+namespace
+{
+	// Tile::GetUsageId() by tile type, it only depends on mType
+	class UsageTable
+	{
+	public:
+		UsageTable()
+		{
+			Tile tile;
+			for ( int i = 0; i < TYPE_COUNT; ++i )
+			{
+				tile.mType = i;
+				mUsages[i] = tile.GetUsageId();
+			}
+		}
+
+		int Get( const Tile& tile ) const
+		{
+			return tile.mType >= 0 && tile.mType < TYPE_COUNT ? mUsages[ tile.mType ] : tile.GetUsageId();
+		}
+
+	private:
+		static const int TYPE_COUNT = Tile::Tile_DOOR_WEST + 1;
+		int mUsages[ TYPE_COUNT ];
+	};
+
+	const UsageTable gUsages;
+
+	//---------------------------------------
+	bool Matches( const Tile& tile, int match, const int32* values, int count )
+	{
+		int32 key;
+		if ( match == RuleProgram::Match_USAGE )
+			key = gUsages.Get( tile );
+		else if ( match == RuleProgram::Match_OBJECT && tile.mObject )
+			key = (int32) tile.mObject->mNameId;
+		else if ( match == RuleProgram::Match_STYLE && tile.mStyle )
+			key = (int32) tile.mStyle->mNameId;
+		else
+			return false;
+
+		for ( int i = 0; i < count; ++i )
+		{
+			if ( values[i] == key )
+				return true;
+		}
+		return false;
+	}
+	//---------------------------------------
+	// Tiles of room matching any of values, from its occupancy lists while they are built
+	// Calls visit( x, y ) for each until it returns false, returns false if it did
+	template< typename Visit >
+	bool VisitRoomMatches( const TileGrid& grid, const Room& room, int match, const int32* values, int count, Visit visit )
+	{
+		if ( room.mOccupancy.IsBuilt() && match != RuleProgram::Match_NONE )
+		{
+			for ( int i = 0; i < count; ++i )
+			{
+				const std::vector< int >* cells = room.mOccupancy.GetCells( match, values[i] );
+				if ( !cells )
+					continue;
+				for ( size_t j = 0; j < cells->size(); j += 2 )
+				{
+					if ( !visit( ( *cells )[j], ( *cells )[ j + 1 ] ) )
+						return false;
+				}
+			}
+			return true;
+		}
+
+		const int endX = room.x + room.GetWidth();
+		const int endY = room.y + room.GetHeight();
+		for ( int y = room.y; y < endY; ++y )
+		{
+			for ( int x = room.x; x < endX; ++x )
+			{
+				if ( Matches( grid.GetTileAt( x, y ), match, values, count ) && !visit( x, y ) )
+					return false;
+			}
+		}
+		return true;
+	}
+}
+
+//---------------------------------------
+RuleProgram::RuleProgram()
+	: mReach( 0 )
+	, mState( 0 )
+{}
+//---------------------------------------
+void RuleProgram::Compile( const std::vector< Rule* >& rules )
+{
+	Clear();
+	for ( auto itr = rules.begin(); itr != rules.end(); ++itr )
+	{
+		( *itr )->Compile( *this );
+		mState += ( *itr )->GetStateSize();
+	}
+}
+//---------------------------------------
+void RuleProgram::Clear()
+{
+	mCode.clear();
+	mValues.clear();
+	mOffsets.clear();
+	mReach = 0;
+	mState = 0;
+}
+//---------------------------------------
+void RuleProgram::Emit( int op, const Rule* rule, int match, bool pass )
+{
+	Instruction inst;
+	inst.mOp = (uint8) op;
+	inst.mMatch = (uint8) match;
+	inst.mPass = pass ? 1 : 0;
+	inst.mPad = 0;
+	inst.mState = (uint32) mState;
+	inst.mValueCount = 0;
+	inst.mOffsetCount = 0;
+	inst.mValues = (uint32) mValues.size();
+	inst.mOffsets = (uint32) mOffsets.size() / 2;
+	inst.mMin = 0;
+	inst.mMax = 0;
+	inst.mRule = rule;
+	mCode.push_back( inst );
+}
+//---------------------------------------
+void RuleProgram::SetRange( float min, float max )
+{
+	mCode.back().mMin = min;
+	mCode.back().mMax = max;
+}
+//---------------------------------------
+void RuleProgram::AddValue( int32 value )
+{
+	mValues.push_back( value );
+	++mCode.back().mValueCount;
+}
+//---------------------------------------
+void RuleProgram::AddOffset( int dx, int dy )
+{
+	mOffsets.push_back( (int16) dx );
+	mOffsets.push_back( (int16) dy );
+	++mCode.back().mOffsetCount;
+	mReach = std::max( mReach, std::max( abs( dx ), abs( dy ) ) );
+}
+//---------------------------------------
+bool RuleProgram::Run( Tile* tile, DungeonGenerator& generator, const int32* state ) const
+{
+	const int32* values = mValues.empty() ? 0 : &mValues[0];
+	const int16* offsets = mOffsets.empty() ? 0 : &mOffsets[0];
+
+	for ( auto itr = mCode.begin(); itr != mCode.end(); ++itr )
+	{
+		const Instruction& inst = *itr;
+		const int32* v = values + inst.mValues;
+		bool ok = true;
+
+		switch ( inst.mOp )
+		{
+		case Op_RULE:
+			ok = inst.mRule->IsValid( tile, generator, state + inst.mState );
+			break;
+
+		case Op_RANDOM:
+		{
+			const float r = generator.GetRuleRNG().RandomUnit();
+			ok = inst.mMin > 0 && r <= inst.mMin;
+			break;
+		}
+
+		case Op_USAGE:
+			ok = Matches( *tile, inst.mMatch, v, inst.mValueCount ) == ( inst.mPass != 0 );
+			break;
+
+		case Op_MAX_COUNT:
+			ok = state[ inst.mState ] > 0;
+			break;
+
+		case Op_ADJACENT:
+		{
+			const int16* o = offsets + inst.mOffsets * 2;
+			bool found = false;
+			for ( int i = 0; i < inst.mOffsetCount && !found; ++i, o += 2 )
+				found = Matches( generator.GetTileAt( tile->x + o[0], tile->y + o[1] ), inst.mMatch, v, inst.mValueCount );
+			ok = found == ( inst.mPass != 0 );
+			break;
+		}
+
+		case Op_DISTANCE_FIELD:
+		{
+			if ( gUsages.Get( *tile ) == Tile::Tile_NONE )
+			{
+				ok = false;
+				break;
+			}
+			int nearest = -1;
+			for ( int i = 0; i < inst.mValueCount; ++i )
+			{
+				const int d = generator.GetDistanceField( (DistanceFieldId) v[i] ).GetNearDistance( tile->x, tile->y );
+				if ( d >= 0 && ( nearest < 0 || d < nearest ) )
+					nearest = d;
+			}
+			ok = nearest >= 0 && nearest >= inst.mMin && ( inst.mMax == 0 || nearest <= inst.mMax );
+			break;
+		}
+
+		case Op_DISTANCE:
+		{
+			if ( gUsages.Get( *tile ) == Tile::Tile_NONE )
+			{
+				ok = false;
+				break;
+			}
+			bool found = false;
+			ok = VisitRoomMatches( generator, *tile->mRoom, inst.mMatch, v, inst.mValueCount, [&]( int x, int y )
+			{
+				found = true;
+				const float d = (float) GetManhattanDistance( tile->x, tile->y, x, y );
+				return d >= inst.mMin && ( inst.mMax == 0 || d <= inst.mMax );
+			} );
+			ok = ok && found;
+			break;
+		}
+
+		case Op_DEPTH:
+		{
+			const int depth = generator.GetCurrentDepth();
+			ok = false;
+			for ( int i = 0; i + 1 < inst.mValueCount && !ok; i += 2 )
+				ok = depth >= v[i] && depth <= v[i + 1];
+			break;
+		}
+
+		case Op_ROOM_CONTAINS:
+		{
+			const Room* room = tile->mRoom;
+			bool found = false;
+			if ( room )
+				found = !VisitRoomMatches( generator, *room, inst.mMatch, v, inst.mValueCount, []( int, int ) { return false; } );
+			ok = found == ( inst.mPass != 0 );
+			break;
+		}
+		}
+
+		if ( !ok )
+			return false;
+	}
+	return true;
+}
+//---------------------------------------
@@ -0,0 +1,101 @@
+/*
+ * Description :
+ *   A RuledObject's Rules lowered to a flat list of instructions.
+ *   Each Rule emits its own instructions through Rule::Compile(), match
+ *   values (usages, object and style names, depth ranges) and neighbour
+ *   offsets are copied into two shared pools so Run() never allocates.
+ *
+ *   Run() gives the same result as calling IsValid() on each Rule in
+ *   order and stopping at the first one that fails, including the
+ *   random numbers it draws. Rules without a Compile() of their own
+ *   are called through IsValid() from the program.
+ */
+
+#pragma once
+
+#include "Types.h"
+
+#include <stddef.h>
+#include <vector>
+
+struct Rule;
+struct Tile;
+class DungeonGenerator;
+
+class RuleProgram
+{
+public:
+	enum OpCode
+	{
+		Op_RULE,				// Call mRule->IsValid()
+		Op_RANDOM,				// Random unit <= mMin
+		Op_USAGE,				// Tile itself matches
+		Op_MAX_COUNT,			// Rule_MaxCount has count left
+		Op_ADJACENT,			// A tile at one of the offsets matches
+		Op_DISTANCE_FIELD,		// Nearest distance in the fields listed in values is in range
+		Op_DISTANCE,			// Every matching tile in the room is in range
+		Op_DEPTH,				// Current depth is in one of the min,max pairs in values
+		Op_ROOM_CONTAINS,		// A tile in the room matches
+	};
+
+	// What values are compared against
+	enum MatchType
+	{
+		Match_NONE,
+		Match_USAGE,
+		Match_OBJECT,
+		Match_STYLE,
+	};
+
+	struct Instruction
+	{
+		uint8 mOp;				// OpCode
+		uint8 mMatch;			// MatchType
+		uint8 mPass;			// Result of a match, the result is flipped when nothing matches
+		uint8 mPad;
+		uint16 mValueCount;
+		uint16 mOffsetCount;
+		uint32 mState;			// First state slot of mRule, from the object's first slot
+		uint32 mValues;			// First entry in the value pool
+		uint32 mOffsets;		// First dx,dy pair in the offset pool
+		float mMin, mMax;		// Distance range, or chance for Op_RANDOM
+		const Rule* mRule;		// Rule the instruction came from
+	};
+
+	RuleProgram();
+
+	// Replace the program with rules, which must outlive it
+	void Compile( const std::vector< Rule* >& rules );
+	void Clear();
+
+	// True if every instruction passes at tile of generator
+	// state is the first slot of the object's rules, see RuleState
+	bool Run( Tile* tile, DungeonGenerator& generator, const int32* state ) const;
+
+	// For evaluating the program other ways, see CandidateMasks
+	const std::vector< Instruction >& GetInstructions() const { return mCode; }
+	const int32* GetValues( const Instruction& inst ) const { return mValues.empty() ? 0 : &mValues[0] + inst.mValues; }
+	const int16* GetOffsets( const Instruction& inst ) const { return mOffsets.empty() ? 0 : &mOffsets[0] + inst.mOffsets * 2; }
+	// Farthest any offset reaches from the tile, in x or y
+	int GetReach() const { return mReach; }
+
+	// Used by Rule::Compile()
+	// Values and offsets must be added right after the instruction they belong to
+	void Emit( int op, const Rule* rule, int match=Match_NONE, bool pass=true );
+	void SetRange( float min, float max );
+	void AddValue( int32 value );
+	template< typename T >
+	void AddValues( const std::vector< T >& values )
+	{
+		for ( auto itr = values.begin(); itr != values.end(); ++itr )
+			AddValue( (int32) *itr );
+	}
+	void AddOffset( int dx, int dy );
+
+private:
+	std::vector< Instruction > mCode;
+	std::vector< int32 > mValues;
+	std::vector< int16 > mOffsets;
+	int mReach;
+	int mState;				// Slot of the rule being compiled
+};
@@ -0,0 +1,41 @@
+/*
+ * Description :
+ *   What Rules track while a floor is generated, i.e. how many more
+ *   times a max count may pass. Each DungeonGenerator owns one, Rules
+ *   only hold their definition and read and write their slots here.
+ *
+ *   A RuledObject's Rules use consecutive slots starting at its
+ *   first slot, in the order of its Rules, see Rule::GetStateSize().
+ *   Every slot must be allocated before rules are evaluated, which
+ *   DungeonArea::CompileRules() does when an area loads, since
+ *   Allocate() moves the slots and the pointers rules were given.
+ */
+
+#pragma once
+
+#include "Types.h"
+
+#include <vector>
+
+class RuleState
+{
+public:
+	// Add count slots, returns the first
+	int Allocate( int count )
+	{
+		const int first = (int) mSlots.size();
+		mSlots.resize( first + count );
+		return first;
+	}
+
+	// Drop every slot, i.e. when a new area is loaded
+	void Clear() { mSlots.clear(); }
+
+	// Pointers are only good until the next Allocate() or Clear()
+	// Keep the first slot, not the pointer, across anything that may allocate
+	int32* GetSlots( int first ) { return mSlots.empty() ? 0 : &mSlots[0] + first; }
+	int GetSlotCount() const { return (int) mSlots.size(); }
+
+private:
+	std::vector< int32 > mSlots;
+};
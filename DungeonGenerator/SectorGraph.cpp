@@ -0,0 +1,220 @@
+#include "SectorGraph.h"
+#include "DungeonGenerator.h"
+
+#include <algorithm>
+
+namespace
+{
+	//---------------------------------------
+	// Same as tile.GetUsageId() == Tile::Tile_DOOR_FRAME without the branches
+	inline bool IsDoorFrame( const Tile& tile )
+	{
+		return tile.mType >= Tile::Tile_DOOR_NORTH && tile.mType <= Tile::Tile_DOOR_WEST;
+	}
+}
+
+//---------------------------------------
+SectorGraph::SectorGraph()
+{
+	Clear();
+}
+//---------------------------------------
+void SectorGraph::Clear()
+{
+	mSectorCount = 0;
+	mParents.clear();
+	mLabels.clear();
+	mDoors.clear();
+	mTileOffsets.assign( 2, 0 );
+	mTiles.clear();
+	mOffsets.assign( 2, 0 );
+	mNeighbors.clear();
+	mNeighborDoors.clear();
+}
+//---------------------------------------
+bool SectorGraph::IsWalkable( const Tile& tile )
+{
+	return ( tile.mType > Tile::Tile_NONE && tile.mType < Tile::Tile_WALL ) ||
+		( IsDoorFrame( tile ) && !tile.mLocked );
+}
+//---------------------------------------
+int SectorGraph::Find( int i )
+{
+	// Path halving
+	while ( mParents[i] != i )
+	{
+		mParents[i] = mParents[ mParents[i] ];
+		i = mParents[i];
+	}
+	return i;
+}
+//---------------------------------------
+void SectorGraph::Union( int a, int b )
+{
+	a = Find( a );
+	b = Find( b );
+	// The first tile scanned stays the root so the second scan meets each root first
+	if ( a < b )
+		mParents[b] = a;
+	else if ( b < a )
+		mParents[a] = b;
+}
+//---------------------------------------
+int SectorGraph::GetScanIndex( const TileGrid& grid, int x, int y ) const
+{
+	// Tiles scanned so far hold their scan index + 1 in mSectorId
+	// Anything else there is stale, so the index must point back at this tile
+	const int i = grid.GetTileAt( x, y ).mSectorId - 1;
+	if ( i >= 0 && i < (int) mTiles.size() && mTiles[i] == x * grid.GetHeight() + y )
+		return i;
+	return -1;
+}
+//---------------------------------------
+void SectorGraph::Build( TileGrid& grid )
+{
+	std::vector< Region > regions( 1 );
+	regions[0].x = 0;
+	regions[0].y = 0;
+	regions[0].w = grid.GetWidth();
+	regions[0].h = grid.GetHeight();
+	Build( grid, regions );
+}
+//---------------------------------------
+void SectorGraph::Build( TileGrid& grid, const std::vector< Region >& regions )
+{
+	Clear();
+
+	const int w = grid.GetWidth();
+	const int h = grid.GetHeight();
+
+	// First scan, link each walkable tile to the walkable tiles around it that were already scanned
+	// Only walkable tiles get a slot so the work is proportional to the regions, not the grid
+	for ( auto itr = regions.begin(); itr != regions.end(); ++itr )
+	{
+		const int x0 = std::max( itr->x, 0 ), x1 = std::min( itr->x + itr->w, w );
+		const int y0 = std::max( itr->y, 0 ), y1 = std::min( itr->y + itr->h, h );
+		for ( int x = x0; x < x1; ++x )
+		{
+			for ( int y = y0; y < y1; ++y )
+			{
+				Tile& tile = grid.GetTileAt( x, y );
+				if ( !IsWalkable( tile ) )
+				{
+					if ( tile.mLocked && IsDoorFrame( tile ) )
+					{
+						Door door = { x * h + y, -1, -1, 0, 0 };
+						mDoors.push_back( door );
+					}
+					continue;
+				}
+				// Regions may overlap
+				if ( GetScanIndex( grid, x, y ) >= 0 )
+					continue;
+
+				const int i = (int) mTiles.size();
+				mTiles.push_back( x * h + y );
+				mParents.push_back( i );
+				tile.mSectorId = i + 1;
+
+				const int nx[4] = { x - 1, x + 1, x, x };
+				const int ny[4] = { y, y, y - 1, y + 1 };
+				for ( int n = 0; n < 4; ++n )
+				{
+					if ( nx[n] < 0 || nx[n] >= w || ny[n] < 0 || ny[n] >= h )
+						continue;
+					const int j = GetScanIndex( grid, nx[n], ny[n] );
+					if ( j >= 0 )
+						Union( j, i );
+				}
+			}
+		}
+	}
+
+	// Second scan, number the components in the order their roots were scanned
+	mLabels.resize( mTiles.size() );
+	for ( int i = 0; i < (int) mTiles.size(); ++i )
+	{
+		const int root = Find( i );
+		mLabels[i] = root == i ? ++mSectorCount : mLabels[ root ];
+	}
+	for ( int i = 0; i < (int) mTiles.size(); ++i )
+	{
+		Tile& tile = grid.GetTileAt( mTiles[i] / h, mTiles[i] % h );
+		tile.mSectorId = mLabels[i];
+		if ( tile.mRoom )
+			tile.mRoom->mSectorId = mLabels[i];
+	}
+
+	// Walkable tiles of each sector as CSR, sorted by sector and in scan order within one
+	mTileOffsets.assign( mSectorCount + 2, 0 );
+	for ( auto itr = mLabels.begin(); itr != mLabels.end(); ++itr )
+		++mTileOffsets[ *itr + 1 ];
+	for ( int i = 1; i <= mSectorCount + 1; ++i )
+		mTileOffsets[i] += mTileOffsets[ i - 1 ];
+	{
+		std::vector< int > next( mTileOffsets.begin(), mTileOffsets.end() - 1 );
+		std::vector< int > tiles( mTiles.size() );
+		for ( int i = 0; i < (int) mTiles.size(); ++i )
+			tiles[ next[ mLabels[i] ]++ ] = mTiles[i];
+		mTiles.swap( tiles );
+	}
+
+	// Doors shared by overlapping regions were found twice
+	std::sort( mDoors.begin(), mDoors.end(), []( const Door& a, const Door& b ) { return a.mTile < b.mTile; } );
+	mDoors.erase( std::unique( mDoors.begin(), mDoors.end(), []( const Door& a, const Door& b ) { return a.mTile == b.mTile; } ), mDoors.end() );
+
+	// Sectors on either side of each locked door
+	for ( auto itr = mDoors.begin(); itr != mDoors.end(); ++itr )
+	{
+		Door& door = *itr;
+		const int x = door.mTile / h;
+		const int y = door.mTile % h;
+		int sx = x, sy = y, ex = x, ey = y;
+		switch ( grid.GetTileAt( x, y ).mType )
+		{
+		case Tile::Tile_DOOR_EAST:	++sx; --ex; break;
+		case Tile::Tile_DOOR_WEST:	--sx; ++ex; break;
+		case Tile::Tile_DOOR_NORTH:	++sy; --ey; break;
+		case Tile::Tile_DOOR_SOUTH:	--sy; ++ey; break;
+		default: continue;
+		}
+
+		if ( sx >= 0 && sx < w && sy >= 0 && sy < h )
+		{
+			const Tile& start = grid.GetTileAt( sx, sy );
+			door.mStartTile = sx * h + sy;
+			door.mStartSector = IsWalkable( start ) ? start.mSectorId : 0;
+		}
+		if ( ex >= 0 && ex < w && ey >= 0 && ey < h )
+		{
+			const Tile& end = grid.GetTileAt( ex, ey );
+			door.mEndTile = ex * h + ey;
+			door.mEndSector = IsWalkable( end ) ? end.mSectorId : 0;
+		}
+	}
+
+	// Adjacency as CSR, count each sector's doors then fill the rows
+	mOffsets.assign( mSectorCount + 2, 0 );
+	for ( auto itr = mDoors.begin(); itr != mDoors.end(); ++itr )
+	{
+		++mOffsets[ itr->mStartSector + 1 ];
+		++mOffsets[ itr->mEndSector + 1 ];
+	}
+	for ( int i = 1; i <= mSectorCount + 1; ++i )
+		mOffsets[i] += mOffsets[ i - 1 ];
+
+	mNeighbors.resize( mOffsets.back() );
+	mNeighborDoors.resize( mOffsets.back() );
+	std::vector< int > next( mOffsets.begin(), mOffsets.end() - 1 );
+	for ( int i = 0; i < (int) mDoors.size(); ++i )
+	{
+		const Door& door = mDoors[i];
+		int& a = next[ door.mStartSector ];
+		mNeighbors[a] = door.mEndSector;
+		mNeighborDoors[a++] = i;
+		int& b = next[ door.mEndSector ];
+		mNeighbors[b] = door.mStartSector;
+		mNeighborDoors[b++] = i;
+	}
+}
+//---------------------------------------
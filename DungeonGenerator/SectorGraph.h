@@ -0,0 +1,83 @@
+/*
+ * Description :
+ *   Connected component labelling of a TileGrid into sectors.
+ *   Two scans with union-find, no recursion: the first links each walkable
+ *   tile with its walkable neighbors, the second gives every component a
+ *   sector id in scan order. Locked doors are boundaries between sectors and
+ *   become the edges of the sector graph, which is kept as flat CSR arrays.
+ *   Only walkable tiles are given union-find slots, so scanning just the
+ *   rooms of a large, mostly empty grid costs no more than the rooms do.
+ */
+
+#pragma once
+
+#include <vector>
+
+struct Tile;
+class TileGrid;
+
+class SectorGraph
+{
+public:
+	// A locked door and the sectors on either side of it
+	// Start and end follow the door's facing, tile indices are x * height + y, -1 out of bounds
+	struct Door
+	{
+		int mTile;
+		int mStartTile, mEndTile;
+		int mStartSector, mEndSector;
+	};
+
+	// Rectangle of tiles to scan
+	struct Region
+	{
+		int x, y, w, h;
+	};
+
+	SectorGraph();
+
+	// Set mSectorId of every walkable tile in grid, 1 to GetSectorCount()
+	// Other tiles are left alone. Walkable tiles also write their sector into their room
+	void Build( TileGrid& grid );
+	// Same as above but only scans the given regions, which may overlap
+	// Every walkable tile must be in a region
+	void Build( TileGrid& grid, const std::vector< Region >& regions );
+	void Clear();
+
+	// Floors and unlocked doors
+	static bool IsWalkable( const Tile& tile );
+
+	// Sector ids are 1 to GetSectorCount()
+	int GetSectorCount() const { return mSectorCount; }
+
+	// Walkable tiles of sectorId as indices x * height + y, in scan order
+	int GetTileCount( int sectorId ) const { return mTileOffsets[ sectorId + 1 ] - mTileOffsets[ sectorId ]; }
+	const int* GetTiles( int sectorId ) const { return mTiles.empty() ? 0 : &mTiles[ mTileOffsets[ sectorId ] ]; }
+
+	// Locked doors in grid order
+	int GetDoorCount() const { return (int) mDoors.size(); }
+	const Door& GetDoor( int i ) const { return mDoors[i]; }
+
+	// Sectors one locked door away from sectorId, one entry per door so a sector may repeat
+	// Sector 0 is included for doors that lead off the grid or into a wall
+	int GetNeighborCount( int sectorId ) const { return mOffsets[ sectorId + 1 ] - mOffsets[ sectorId ]; }
+	const int* GetNeighbors( int sectorId ) const { return mNeighbors.empty() ? 0 : &mNeighbors[ mOffsets[ sectorId ] ]; }
+	// Index into the locked doors for each entry of GetNeighbors()
+	const int* GetNeighborDoors( int sectorId ) const { return mNeighborDoors.empty() ? 0 : &mNeighborDoors[ mOffsets[ sectorId ] ]; }
+
+private:
+	int Find( int i );
+	void Union( int a, int b );
+	// Slot of the tile at x, y during the first scan, -1 if it has not been scanned
+	int GetScanIndex( const TileGrid& grid, int x, int y ) const;
+
+	int mSectorCount;
+	std::vector< int > mParents;		// Union-find forest, one slot per walkable tile
+	std::vector< int > mLabels;			// Sector id of each slot
+	std::vector< int > mTileOffsets;	// CSR row starts into mTiles
+	std::vector< int > mTiles;			// Tile index of each slot while scanning, then sorted by sector
+	std::vector< Door > mDoors;
+	std::vector< int > mOffsets;		// CSR row starts, sector id 0 to mSectorCount plus one past the end
+	std::vector< int > mNeighbors;
+	std::vector< int > mNeighborDoors;
+};
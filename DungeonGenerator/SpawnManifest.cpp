@@ -0,0 +1,39 @@
+#include "SpawnManifest.h"
+
+#include <algorithm>
+
+namespace
+{
+	//---------------------------------------
+	template< typename T >
+	uint16 GetPaletteIndex( T* p, std::vector< T* >& palette )
+	{
+		auto itr = std::find( palette.begin(), palette.end(), p );
+		if ( itr != palette.end() )
+			return (uint16) ( itr - palette.begin() );
+		palette.push_back( p );
+		return (uint16) ( palette.size() - 1 );
+	}
+}
+
+//---------------------------------------
+void SpawnManifest::Clear()
+{
+	mKeys.clear();
+	mTiles.clear();
+	mObjects.clear();
+	mDoors.clear();
+	mStylePalette.clear();
+	mObjectPalette.clear();
+}
+//---------------------------------------
+uint16 SpawnManifest::GetStyleId( TileStyle* style )
+{
+	return GetPaletteIndex( style, mStylePalette );
+}
+//---------------------------------------
+uint16 SpawnManifest::GetObjectId( TileObject* object )
+{
+	return GetPaletteIndex( object, mObjectPalette );
+}
+//---------------------------------------
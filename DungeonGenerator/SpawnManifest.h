@@ -0,0 +1,77 @@
+/*
+ * Description :
+ *   Everything a finished floor asks the game to spawn, as plain data.
+ *   DungeonGenerator::BuildSpawnManifest() fills it without touching the
+ *   engine, so it can be built on any thread, and Game::CreateEntities()
+ *   turns it into entities in one go.
+ *
+ *   Each kind of spawn has its own array, in tile order x * height + y.
+ *   Styles and objects are 16 bit ids into the palettes of the manifest,
+ *   which point at the definitions loaded by DungeonArea.
+ */
+
+#pragma once
+
+#include "DungeonGenerator.h"
+#include "Types.h"
+
+#include <vector>
+
+struct SpawnManifest
+{
+	// Tile with a TileStyle, becomes a MapTile
+	struct TileSpawn
+	{
+		int32 x, y;
+		int32 mRoomIndex;
+		uint16 mStyle;
+		uint16 mPad;
+	};
+
+	// TileObject on a tile, attachments follow the object they are attached to
+	struct ObjectSpawn
+	{
+		int32 x, y;
+		glm::vec3 mLocation;	// Tile plus the object's spawn offset
+		int32 mRoomIndex;
+		int32 mParent;			// Index into mObjects of the object this is attached to, -1 if none
+		uint16 mObject;
+		int16 mVariant;			// Entry of a spawner's SpawnList that was picked, -1 for other objects
+	};
+
+	enum DoorLock
+	{
+		Lock_NONE,
+		Lock_KEY,				// Opened by mKeys[ mKey ]
+		Lock_FORCED,			// Locked by its style, no key opens it
+	};
+
+	// Door on a door frame tile
+	struct DoorSpawn
+	{
+		int32 x, y;
+		glm::vec3 mLocation;
+		float mOrientation;		// Degrees
+		int32 mLock;			// DoorLock
+		int32 mKeyId;
+		int32 mKey;				// Index into mKeys, -1 if none
+		Color mColor;
+		uint16 mStyle;
+		uint16 mPad;
+	};
+
+	void Clear();
+	size_t GetSpawnCount() const { return mKeys.size() + mTiles.size() + mObjects.size() + mDoors.size(); }
+
+	// Palette ids, adding the definition the first time it is seen
+	uint16 GetStyleId( TileStyle* style );
+	uint16 GetObjectId( TileObject* object );
+
+	std::vector< KeySpawn > mKeys;		// Ordered by key id
+	std::vector< TileSpawn > mTiles;
+	std::vector< ObjectSpawn > mObjects;
+	std::vector< DoorSpawn > mDoors;
+
+	std::vector< TileStyle* > mStylePalette;
+	std::vector< TileObject* > mObjectPalette;
+};
@@ -0,0 +1,156 @@
+#include "SymbolTable.h"
+#include "HashUtil.h"
+#include "Logger.h"
+
+#include <deque>
+#include <mutex>
+#include <string.h>
+
+namespace
+{
+	// Open addressed table of name hashes, probed linearly
+	// Hashes are only a shortcut, the names are always compared
+	class Table
+	{
+	public:
+		Table()
+			: mCount( 0 )
+		{
+			mSlots.resize( 256 );
+			Insert( "", GenerateHash64( "", 0 ) );
+		}
+
+		Symbol Intern( const char* name )
+		{
+			std::lock_guard< std::mutex > lock( mMutex );
+			const uint64_t hash = GenerateHash64( name, strlen( name ) );
+			Symbol symbol = Lookup( name, hash );
+			if ( symbol == SYMBOL_NONE && *name )
+				symbol = Insert( name, hash );
+			return symbol;
+		}
+
+		Symbol Find( const char* name )
+		{
+			std::lock_guard< std::mutex > lock( mMutex );
+			return Lookup( name, GenerateHash64( name, strlen( name ) ) );
+		}
+
+		const char* GetName( Symbol symbol )
+		{
+			std::lock_guard< std::mutex > lock( mMutex );
+			if ( symbol >= mNames.size() )
+			{
+				WarnFail( "Invalid symbol %u\n", symbol );
+				return "";
+			}
+			return mNames[ symbol ].c_str();
+		}
+
+		uint32 GetCount()
+		{
+			std::lock_guard< std::mutex > lock( mMutex );
+			return (uint32) mNames.size();
+		}
+
+	private:
+		struct Slot
+		{
+			Slot() : mHash( 0 ), mSymbol( SYMBOL_NONE ), mUsed( false ) {}
+			uint64_t mHash;
+			Symbol mSymbol;
+			bool mUsed;
+		};
+
+		Symbol Lookup( const char* name, uint64_t hash ) const
+		{
+			const size_t mask = mSlots.size() - 1;
+			for ( size_t i = (size_t) hash & mask; mSlots[i].mUsed; i = ( i + 1 ) & mask )
+			{
+				if ( mSlots[i].mHash != hash )
+					continue;
+				if ( mNames[ mSlots[i].mSymbol ] == name )
+					return mSlots[i].mSymbol;
+				// Two names with the same 64 bit hash, keep probing so both still work
+				WarnFail( "Symbol hash collision between '%s' and '%s'\n", name, mNames[ mSlots[i].mSymbol ].c_str() );
+			}
+			return SYMBOL_NONE;
+		}
+
+		Symbol Insert( const char* name, uint64_t hash )
+		{
+			// Keep the table at most half full
+			if ( ( mCount + 1 ) * 2 > mSlots.size() )
+				Grow();
+
+			const Symbol symbol = (Symbol) mNames.size();
+			mNames.push_back( name );
+			Place( hash, symbol );
+			return symbol;
+		}
+
+		void Place( uint64_t hash, Symbol symbol )
+		{
+			const size_t mask = mSlots.size() - 1;
+			size_t i = (size_t) hash & mask;
+			while ( mSlots[i].mUsed )
+				i = ( i + 1 ) & mask;
+			mSlots[i].mHash = hash;
+			mSlots[i].mSymbol = symbol;
+			mSlots[i].mUsed = true;
+			++mCount;
+		}
+
+		void Grow()
+		{
+			std::vector< Slot > old( mSlots.size() * 2 );
+			old.swap( mSlots );
+			mCount = 0;
+			for ( auto itr = old.begin(); itr != old.end(); ++itr )
+			{
+				if ( itr->mUsed )
+					Place( itr->mHash, itr->mSymbol );
+			}
+		}
+
+		std::mutex mMutex;
+		std::vector< Slot > mSlots;
+		size_t mCount;
+		std::deque< std::string > mNames;		// Deque so GetName() pointers stay valid
+	};
+
+	//---------------------------------------
+	Table& GetTable()
+	{
+		static Table table;
+		return table;
+	}
+}
+
+//---------------------------------------
+Symbol SymbolTable::Intern( const char* name )
+{
+	return GetTable().Intern( name );
+}
+//---------------------------------------
+void SymbolTable::Intern( const std::vector< std::string >& names, std::vector< Symbol >& symbols )
+{
+	for ( auto itr = names.begin(); itr != names.end(); ++itr )
+		symbols.push_back( Intern( *itr ) );
+}
+//---------------------------------------
+Symbol SymbolTable::Find( const char* name )
+{
+	return GetTable().Find( name );
+}
+//---------------------------------------
+const char* SymbolTable::GetName( Symbol symbol )
+{
+	return GetTable().GetName( symbol );
+}
+//---------------------------------------
+uint32 SymbolTable::GetCount()
+{
+	return GetTable().GetCount();
+}
+//---------------------------------------
@@ -0,0 +1,74 @@
+/*
+ * Description :
+ *   Maps names to small dense ids so they can be compared as integers.
+ *   Names are interned once at load time, after that rules, tiles and
+ *   factories only deal with Symbols.
+ *
+ *   Ids are global and never freed, the same name always gives the
+ *   same Symbol for the life of the process. Interning is thread safe
+ *   since areas may be loaded from several threads at once.
+ */
+ 
+#pragma once
+
+#include "Types.h"
+
+#include <string>
+#include <vector>
+
+typedef uint32 Symbol;
+
+// The empty string, also what Find() gives for names never interned
+static const Symbol SYMBOL_NONE = 0;
+
+class SymbolTable
+{
+public:
+	// Id of name, adding it the first time it is seen
+	static Symbol Intern( const char* name );
+	static Symbol Intern( const std::string& name ) { return Intern( name.c_str() ); }
+	// Intern each name, appending the ids to symbols
+	static void Intern( const std::vector< std::string >& names, std::vector< Symbol >& symbols );
+
+	// Id of name if it was interned, SYMBOL_NONE otherwise
+	static Symbol Find( const char* name );
+	static Symbol Find( const std::string& name ) { return Find( name.c_str() ); }
+
+	// Name of symbol, the pointer stays valid for the life of the process
+	static const char* GetName( Symbol symbol );
+
+	// Number of names interned, all Symbols are less than this
+	static uint32 GetCount();
+};
+
+//---------------------------------------
+// Flat lookup from Symbol to T*, null for names that were not added
+template< typename T >
+class SymbolMap
+{
+public:
+	T* Find( Symbol symbol ) const { return symbol < mItems.size() ? mItems[ symbol ] : 0; }
+	T* Find( const std::string& name ) const { return Find( SymbolTable::Find( name ) ); }
+
+	// Replaces anything already added under symbol
+	void Add( Symbol symbol, T* item )
+	{
+		if ( symbol >= mItems.size() )
+			mItems.resize( symbol + 1, 0 );
+		mItems[ symbol ] = item;
+	}
+	void Add( const std::string& name, T* item ) { Add( SymbolTable::Intern( name ), item ); }
+
+	void Clear() { mItems.clear(); }
+
+	// Delete every item then clear
+	void DeleteAll()
+	{
+		for ( auto itr = mItems.begin(); itr != mItems.end(); ++itr )
+			delete *itr;
+		mItems.clear();
+	}
+
+private:
+	std::vector< T* > mItems;
+};
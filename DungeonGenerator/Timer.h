@@ -0,0 +1,41 @@
+/*
+ * Description :
+ *   Wall clock timer used for profiling generation.
+ *   Does not depend on SDL so it can be used headless.
+ */
+ 
+#pragma once
+
+#include <chrono>
+
+class Timer
+{
+public:
+	Timer()
+	{ Reset(); }
+
+	// Restart the timer from zero
+	void Reset()
+	{
+		mStart = Clock::now();
+	}
+
+	// Time since the last Reset()
+	double GetElapsedMilliseconds() const
+	{
+		return std::chrono::duration< double, std::milli >( Clock::now() - mStart ).count();
+	}
+
+	// Returns the elapsed time and restarts the timer
+	double Lap()
+	{
+		const Clock::time_point now = Clock::now();
+		const double ms = std::chrono::duration< double, std::milli >( now - mStart ).count();
+		mStart = now;
+		return ms;
+	}
+
+private:
+	typedef std::chrono::high_resolution_clock Clock;
+	Clock::time_point mStart;
+};
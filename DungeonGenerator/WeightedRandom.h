@@ -21,7 +21,7 @@ public:
 
 	void Add( T value, float weight=1.0f );
 
-	T Evaluate() const;
+	T Evaluate( RNG& rng ) const;
 	float GetTotalWeight() const { return mTotalWeight; }
 
 private:
@@ -49,9 +49,9 @@ void WeightedRandom< T >::Add( T value, float weight )
 }
 //---------------------------------------
 template< typename T >
-T WeightedRandom< T >::Evaluate() const
+T WeightedRandom< T >::Evaluate( RNG& rng ) const
 {
-	float w = RNG::RandomInRange< float >( 0, mTotalWeight );
+	float w = rng.RandomInRange< float >( 0, mTotalWeight );
 	for ( typename std::vector< std::pair< float, T > >::const_iterator itr = mValues.begin(); itr != mValues.end(); ++itr )
 	{
 		if ( w < itr->first ) return itr->second;
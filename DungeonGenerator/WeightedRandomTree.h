@@ -0,0 +1,115 @@
+/*
+ * Description :
+ *   Like WeightedRandom but the weights are indexed and can be changed
+ *   after they are added. Backed by a Fenwick tree so changing a weight
+ *   and picking a random index are both O(log n).
+ */
+ 
+#pragma once
+
+#include "RNG.h"
+
+#include <vector>
+#include <algorithm>
+
+
+class WeightedRandomTree
+{
+public:
+	WeightedRandomTree();
+
+	// Remove all weights
+	void Clear();
+
+	// Set the weight of index, growing the tree if needed
+	void Set( int index, float weight );
+	float Get( int index ) const { return index < (int) mWeights.size() ? mWeights[ index ] : 0.0f; }
+
+	// Random index with probability weight / total weight
+	// Returns -1 if every weight is zero
+	int Evaluate( RNG& rng ) const;
+	float GetTotalWeight() const { return (float) mTotalWeight; }
+
+private:
+	void Grow( int size );
+
+	std::vector< float > mWeights;
+	std::vector< double > mTree;	// 1 based Fenwick tree of mWeights
+	double mTotalWeight;
+};
+
+//---------------------------------------
+// Implementation
+//---------------------------------------
+inline WeightedRandomTree::WeightedRandomTree()
+	: mTotalWeight( 0 )
+{}
+//---------------------------------------
+inline void WeightedRandomTree::Clear()
+{
+	mWeights.clear();
+	mTree.assign( 1, 0.0 );
+	mTotalWeight = 0;
+}
+//---------------------------------------
+inline void WeightedRandomTree::Set( int index, float weight )
+{
+	if ( index >= (int) mWeights.size() )
+		Grow( std::max( index + 1, (int) mWeights.size() * 2 ) );
+
+	const double delta = (double) weight - mWeights[ index ];
+	mWeights[ index ] = weight;
+	mTotalWeight += delta;
+
+	const int n = (int) mWeights.size();
+	for ( int i = index + 1; i <= n; i += i & -i )
+		mTree[i] += delta;
+}
+//---------------------------------------
+inline int WeightedRandomTree::Evaluate( RNG& rng ) const
+{
+	const int n = (int) mWeights.size();
+	if ( n == 0 || mTotalWeight <= 0 )
+		return -1;
+
+	// Find the first index whose running total is past w
+	double w = rng.RandomInRange< double >( 0, mTotalWeight );
+	int step = 1;
+	while ( step * 2 <= n )
+		step *= 2;
+
+	int pos = 0;
+	for ( ; step > 0; step /= 2 )
+	{
+		if ( pos + step <= n && mTree[ pos + step ] <= w )
+		{
+			pos += step;
+			w -= mTree[ pos ];
+		}
+	}
+
+	// w landed on the very end of the range
+	while ( pos >= n || mWeights[ pos ] <= 0 )
+	{
+		if ( --pos < 0 )
+			return -1;
+	}
+
+	return pos;
+}
+//---------------------------------------
+inline void WeightedRandomTree::Grow( int size )
+{
+	// Rebuild since the parent ranges change with the size
+	// Size doubles so this is amortized O(1) per Set()
+	mWeights.resize( size, 0.0f );
+	mTree.assign( size + 1, 0.0 );
+	for ( int i = 1; i <= size; ++i )
+	{
+		mTree[i] += mWeights[ i - 1 ];
+		const int parent = i + ( i & -i );
+		if ( parent <= size )
+			mTree[ parent ] += mTree[i];
+	}
+}
+//---------------------------------------
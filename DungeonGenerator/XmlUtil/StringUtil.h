@@ -12,6 +12,15 @@
 #include <vector>
 #include <algorithm>
 
+// Stand-ins for the MSVC CRT functions used by the xml utils
+#ifndef _WIN32
+#	include <stdio.h>
+#	include <strings.h>
+#	define _stricmp strcasecmp
+#	define sprintf_s snprintf
+#	define vsprintf_s( buffer, format, args ) vsnprintf( buffer, sizeof( buffer ), format, args )
+#endif
+
 // Helper to make strings
 #define STRINGIFY( S ) #S
 
@@ -50,9 +59,9 @@ public:
 		return !ss.fail();
 	}
 
-	// This specialization prevents an issue where stringstream would break
+	// This overload prevents an issue where stringstream would break
 	// a string up at the first space in the general template
-	template<>
+	// Overload rather than specialize so it compiles outside of MSVC
 	static bool StringToType( const std::string& str, std::string* type )
 	{
 		*type = str;